@@ -0,0 +1,129 @@
+#include "magic_async.h"
+#include "magic_robot.h"
+#include "magic_sdk_version.h"
+
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace magic::dog;
+
+// Global robot instance
+std::unique_ptr<MagicRobot> robot = nullptr;
+
+void signalHandler(int signum) {
+  std::cout << "\nInterrupt signal (" << signum << ") received." << std::endl;
+  if (robot) {
+    robot->Shutdown();
+  }
+  exit(signum);
+}
+
+// Issue call number i of the benchmark mix (read-only RPCs only, so the robot state is unchanged)
+Status blocking_call(int i) {
+  switch (i % 4) {
+    case 0: {
+      GaitMode gait_mode;
+      return robot->GetHighLevelMotionController().GetGait(gait_mode);
+    }
+    case 1: {
+      EulerAngles euler_angles;
+      return robot->GetHighLevelMotionController().GetHeadPosition(euler_angles);
+    }
+    case 2: {
+      FaceExpression face_expression;
+      return robot->GetDisplayController().GetFaceExpression(face_expression);
+    }
+    default: {
+      int volume = 0;
+      return robot->GetAudioController().GetVolume(volume);
+    }
+  }
+}
+
+int main(int argc, char* argv[]) {
+  // Bind SIGINT (Ctrl+C)
+  signal(SIGINT, signalHandler);
+
+  const int count = argc > 1 ? std::atoi(argv[1]) : 32;
+  const int threads = argc > 2 ? std::atoi(argv[2]) : 8;
+
+  std::string local_ip = "192.168.55.10";
+  robot = std::make_unique<MagicRobot>();
+
+  // Configure local IP address for direct network connection and initialize SDK
+  if (!robot->Initialize(local_ip)) {
+    std::cerr << "robot sdk initialize failed." << std::endl;
+    robot->Shutdown();
+    return -1;
+  }
+
+  // Connect to robot
+  auto status = robot->Connect();
+  if (status.code != ErrorCode::OK) {
+    std::cerr << "connect robot failed, code: " << status.code
+              << ", message: " << status.message << std::endl;
+    robot->Shutdown();
+    return -1;
+  }
+
+  // Sequential: each RPC waits for the previous one
+  int failed = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < count; ++i) {
+    if (blocking_call(i).code != ErrorCode::OK) {
+      ++failed;
+    }
+  }
+  auto sequential_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+  std::cout << "sequential: " << count << " RPCs in " << sequential_us << " us, failed: " << failed << std::endl;
+
+  // Concurrent: all RPCs in flight at once, up to `threads` at a time
+  AsyncRpcExecutor executor(threads);
+  std::vector<std::future<Status>> futures;
+  futures.reserve(count);
+  failed = 0;
+  start = std::chrono::steady_clock::now();
+  for (int i = 0; i < count; ++i) {
+    futures.push_back(executor.Submit<Status>([i] { return blocking_call(i); }));
+  }
+  for (auto& future : futures) {
+    if (future.get().code != ErrorCode::OK) {
+      ++failed;
+    }
+  }
+  auto concurrent_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+  std::cout << "concurrent (" << threads << " threads): " << count << " RPCs in " << concurrent_us << " us, failed: " << failed << std::endl;
+
+  const auto rpc = Summarize(executor.GetExecutor().GetRunTime());
+  std::cout << "RPC latency us, p50: " << rpc.p50 / 1000 << ", p99: " << rpc.p99 / 1000 << ", max: " << rpc.max / 1000 << std::endl;
+  if (concurrent_us > 0) {
+    std::cout << "speedup: " << static_cast<double>(sequential_us) / static_cast<double>(concurrent_us) << "x" << std::endl;
+  }
+
+  // Wrapper form, with a completion callback
+  motion::AsyncHighLevelMotionController async_motion(robot->GetHighLevelMotionController(), executor);
+  auto gait = async_motion.GetGaitAsync(5000, [](const RpcResult<GaitMode>& result) {
+    std::cout << "GetGaitAsync completed, code: " << result.status.code << std::endl;
+  });
+  std::cout << "current gait: " << static_cast<int>(gait.get().value) << std::endl;
+
+  // Disconnect from robot
+  status = robot->Disconnect();
+  if (status.code != ErrorCode::OK) {
+    std::cerr << "disconnect robot failed, code: " << status.code
+              << ", message: " << status.message << std::endl;
+    robot->Shutdown();
+    return -1;
+  }
+
+  robot->Shutdown();
+  std::cout << "robot shutdown" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,109 @@
+#include "magic_control_loop.h"
+#include "magic_motion_realtime.h"
+#include "magic_sdk_version.h"
+#include "magic_virtual_robot.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <thread>
+
+using namespace magic::dog;
+using namespace magic::dog::motion;
+
+constexpr double kTargetQ = 0.5;      // Joint position every joint is driven to (rad)
+constexpr double kTolerance = 0.01;   // Allowed final position error (rad)
+
+int main(int argc, char* argv[]) {
+  const uint64_t cycles = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 2000;
+  const int rate_hz = argc > 2 ? std::atoi(argv[2]) : 500;
+  const int cpu = argc > 3 ? std::atoi(argv[3]) : -1;
+  const int rt_priority = argc > 4 ? std::atoi(argv[4]) : 0;
+
+  // Loopback stand-in: leg state at the control rate, joints follow the last command
+  sim::VirtualRobotOptions robot_options;
+  robot_options.leg_state_rate_hz = rate_hz;
+  robot_options.imu_rate_hz = 0;
+  robot_options.odometry_rate_hz = 0;
+  robot_options.laser_scan_rate_hz = 0;
+  robot_options.image_rate_hz = 0;
+  robot_options.audio_rate_hz = 0;
+  sim::VirtualRobot robot(robot_options);
+
+  LegStateMailbox mailbox;
+  robot.SubscribeLegState([&mailbox](const std::shared_ptr<LegState> msg) { mailbox.Update(*msg); });
+  RealtimeLegCommandPublisher publisher([&robot](const LegJointCommand& command) { return robot.PublishLegCommand(command); });
+  robot.Initialize();
+  publisher.Start();
+
+  ControlLoopOptions options;
+  options.period = std::chrono::nanoseconds(1000000000LL / std::max(rate_hz, 1));
+  options.cpu = cpu;
+  options.rt_priority = rt_priority;
+  options.lock_memory = rt_priority > 0;
+  std::cout << "cycles: " << cycles << ", rate: " << rate_hz << " Hz, cpu: " << cpu << ", SCHED_FIFO priority: " << rt_priority
+            << std::endl;
+
+  ControlLoop loop(options);
+  LegState state;
+  LegJointCommand command;
+  std::atomic<bool> done{false};
+  const Status status = loop.Start([&](uint64_t cycle) {
+    if (cycle >= cycles) {
+      done = true;
+      loop.Stop();
+      return;
+    }
+    if (mailbox.Read(state) != RtErrorCode::OK) {
+      return;
+    }
+    command.timestamp = state.timestamp;
+    for (std::size_t i = 0; i < kLegJointNum; ++i) {
+      command.cmd[i].q_des = kTargetQ;
+      command.cmd[i].dq_des = 0.0;
+      command.cmd[i].tau_des = 0.0;
+      command.cmd[i].kp = 200.0;
+      command.cmd[i].kd = 2.0;
+    }
+    publisher.Publish(command);
+  });
+  if (status.code != ErrorCode::OK) {
+    std::cerr << "ControlLoop start failed: " << status.message << std::endl;
+    return 1;
+  }
+  while (!done) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  loop.Stop();
+  publisher.Stop();
+  robot.Shutdown();
+
+  const ControlLoopStats stats = loop.GetStats();
+  const LatencySummary jitter = Summarize(loop.GetWakeupJitter());
+  const LatencySummary step = Summarize(loop.GetStepDuration());
+  std::cout << "loop: cycles " << stats.cycles << ", overruns " << stats.overruns << ", skipped " << stats.skipped_cycles
+            << ", deadline misses " << stats.deadline_misses << std::endl;
+  std::cout << "wake-up jitter: p50 " << jitter.p50 / 1000.0 << " us, p99 " << jitter.p99 / 1000.0 << " us, max "
+            << jitter.max / 1000.0 << " us" << std::endl;
+  std::cout << "step duration:  p50 " << step.p50 / 1000.0 << " us, p99 " << step.p99 / 1000.0 << " us, max " << step.max / 1000.0
+            << " us" << std::endl;
+
+  // The loop closed through the stand-in: every command arrived and the joints settled on the target
+  const RealtimePublisherStats publisher_stats = publisher.GetStats();
+  mailbox.Read(state);
+  double max_error = 0.0;
+  for (std::size_t i = 0; i < kLegJointNum; ++i) {
+    max_error = std::max(max_error, std::abs(state.state[i].q - kTargetQ));
+  }
+  const bool delivered = publisher_stats.sent == publisher_stats.published && robot.GetCommandCount() == publisher_stats.sent;
+  std::cout << "commands: published " << publisher_stats.published << ", dropped " << publisher_stats.dropped
+            << ", received by robot " << robot.GetCommandCount() << std::endl;
+  std::cout << "final joint error " << max_error << " rad" << std::endl;
+  const bool ok = delivered && max_error < kTolerance;
+  std::cout << (ok ? "loopback control loop [ok]" : "loopback control loop [FAIL]") << std::endl;
+  return ok ? 0 : 1;
+}
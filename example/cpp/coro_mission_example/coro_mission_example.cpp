@@ -0,0 +1,184 @@
+#include "magic_coro.h"
+#include "magic_nav_watcher.h"
+#include "magic_sdk_version.h"
+#include "magic_virtual_robot.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace magic::dog;
+using namespace std::chrono_literals;
+
+// Patrol points of a 1 m square, consecutive waypoints with distinct IDs
+NavTarget waypoint(int index) {
+  static const double corners[4][2] = {{1.0, 0.0}, {1.0, 1.0}, {0.0, 1.0}, {0.0, 0.0}};
+  NavTarget target;
+  target.id = index + 1;
+  target.frame_id = "map";
+  target.goal.position = {corners[index % 4][0], corners[index % 4][1], 0.0};
+  target.goal.orientation = {0.0, 0.0, 0.0};
+  return target;
+}
+
+// The blocking sequence SetGait / poll GetGait / sleep, as a coroutine that never blocks the loop thread
+Task<Status> switch_gait(CoroScheduler& scheduler, sim::VirtualRobot& robot, GaitMode gait_mode) {
+  Status status = co_await scheduler.Rpc<Status>([&robot, gait_mode] { return robot.SetGait(gait_mode); });
+  if (status.code != ErrorCode::OK) {
+    co_return status;
+  }
+  for (int i = 0; i < 100; ++i) {
+    const auto result = co_await scheduler.Rpc<RpcResult<GaitMode>>([&robot] {
+      RpcResult<GaitMode> result;
+      result.status = robot.GetGait(result.value);
+      return result;
+    });
+    if (result.status.code == ErrorCode::OK && result.value == gait_mode) {
+      co_return Status{ErrorCode::OK, ""};
+    }
+    co_await scheduler.SleepFor(50ms);
+  }
+  co_return Status{ErrorCode::TIMEOUT, "gait not reached"};
+}
+
+// SetNavTarget followed by status polls until the task ends
+Task<Status> drive_to(CoroScheduler& scheduler, sim::VirtualRobot& robot, const NavTarget& target) {
+  // Calls capturing by value are built outside the co_await expression (GCC 12 mishandles such temporaries there)
+  std::function<Status()> set_target = [&robot, target] { return robot.SetNavTarget(target); };
+  Status status = co_await scheduler.Rpc<Status>(std::move(set_target));
+  if (status.code != ErrorCode::OK) {
+    co_return status;
+  }
+  while (true) {
+    co_await scheduler.SleepFor(50ms);
+    const auto result = co_await scheduler.Rpc<RpcResult<NavStatus>>([&robot] {
+      RpcResult<NavStatus> result;
+      result.status = robot.GetNavTaskStatus(result.value);
+      return result;
+    });
+    if (result.status.code != ErrorCode::OK) {
+      co_return result.status;
+    }
+    if (result.value.id == target.id && slam::IsNavTaskFinished(result.value.status)) {
+      co_return result.value.status == NavStatusType::END_SUCCESS
+                    ? Status{ErrorCode::OK, ""}
+                    : Status{ErrorCode::SERVICE_ERROR, "nav target " + std::to_string(target.id) + " failed"};
+    }
+  }
+}
+
+Task<void> mission(CoroScheduler& scheduler, sim::VirtualRobot& robot, int waypoints, std::atomic<bool>& done) {
+  Status status = co_await switch_gait(scheduler, robot, GaitMode::GAIT_DOWN_CLIMB_STAIRS);
+  std::cout << "gait switch: " << (status.code == ErrorCode::OK ? "ok" : status.message) << std::endl;
+  for (int i = 0; i < waypoints && status.code == ErrorCode::OK; ++i) {
+    status = co_await drive_to(scheduler, robot, waypoint(i));
+    std::cout << "waypoint " << i + 1 << "/" << waypoints << ": " << (status.code == ErrorCode::OK ? "reached" : status.message)
+              << std::endl;
+  }
+  done = true;
+}
+
+// Awaitable "next message" reads on the odometry stream
+Task<void> telemetry(MessageChannel<Odometry>& odometry, std::atomic<bool>& done, uint64_t& samples) {
+  while (!done) {
+    const auto message = co_await odometry.Next();
+    if (message) {
+      ++samples;
+    }
+  }
+}
+
+// Lightweight periodic tasks sharing the loop thread with the mission
+Task<void> watchdog(CoroScheduler& scheduler, std::atomic<bool>& done, uint64_t& ticks) {
+  while (!done) {
+    co_await scheduler.SleepFor(100ms);
+    ++ticks;
+  }
+}
+
+// Counts destructions of unfinished tasks' frames at shutdown
+struct FrameGuard {
+  std::atomic<int>& destroyed;
+  ~FrameGuard() { destroyed.fetch_add(1); }
+};
+
+Task<void> slow_rpc(CoroScheduler& scheduler, std::atomic<int>& destroyed) {
+  FrameGuard guard{destroyed};
+  co_await scheduler.Rpc<bool>([] {
+    std::this_thread::sleep_for(300ms);
+    return true;
+  });
+  co_await scheduler.SleepFor(1h);
+}
+
+Task<void> long_sleep(CoroScheduler& scheduler, std::atomic<int>& destroyed) {
+  FrameGuard guard{destroyed};
+  co_await scheduler.SleepFor(1h);
+}
+
+int main(int argc, char* argv[]) {
+  const int waypoints = argc > 1 ? std::atoi(argv[1]) : 4;
+  const int tasks = argc > 2 ? std::atoi(argv[2]) : 1000;
+
+  sim::VirtualRobotOptions robot_options;
+  robot_options.leg_state_rate_hz = 0;
+  robot_options.imu_rate_hz = 0;
+  robot_options.laser_scan_rate_hz = 0;
+  robot_options.image_rate_hz = 0;
+  robot_options.audio_rate_hz = 0;
+  robot_options.nav_speed = 2.0;
+  sim::VirtualRobot robot(robot_options);
+  robot.Initialize();
+
+  AsyncRpcExecutor rpc_executor(4);
+  {
+    CoroScheduler scheduler(rpc_executor);
+    MessageChannel<Odometry> odometry(scheduler);
+    robot.SubscribeOdometry(odometry.Callback());
+
+    std::atomic<bool> done{false};
+    uint64_t samples = 0;
+    std::vector<uint64_t> ticks(static_cast<std::size_t>(tasks), 0);
+    scheduler.Spawn(mission(scheduler, robot, waypoints, done));
+    scheduler.Spawn(telemetry(odometry, done, samples));
+    for (auto& count : ticks) {
+      scheduler.Spawn(watchdog(scheduler, done, count));
+    }
+    const auto start = std::chrono::steady_clock::now();
+    scheduler.Run();
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    robot.UnsubscribeOdometry();
+
+    uint64_t total_ticks = 0;
+    for (const uint64_t count : ticks) {
+      total_ticks += count;
+    }
+    std::cout << "mission + telemetry + " << tasks << " watchdog tasks on one loop thread: " << seconds << " s, "
+              << samples << " odometry samples, " << total_ticks << " watchdog ticks, " << scheduler.GetFailedTaskCount()
+              << " failed tasks" << std::endl;
+  }
+
+  // Shutdown with tasks still suspended: the destructor waits for the in-flight RPC, then destroys both frames
+  std::atomic<int> destroyed{0};
+  {
+    CoroScheduler scheduler(rpc_executor);
+    scheduler.Spawn(slow_rpc(scheduler, destroyed));
+    scheduler.Spawn(long_sleep(scheduler, destroyed));
+    std::thread stopper([&scheduler] {
+      std::this_thread::sleep_for(50ms);
+      scheduler.Stop();
+    });
+    scheduler.Run();
+    stopper.join();
+    std::cout << "stopped with " << scheduler.GetTaskCount() << " unfinished tasks" << std::endl;
+  }
+  std::cout << "unfinished task frames destroyed at shutdown: " << destroyed << "/2" << std::endl;
+  robot.Shutdown();
+  return destroyed == 2 ? 0 : 1;
+}
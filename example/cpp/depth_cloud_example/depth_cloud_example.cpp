@@ -0,0 +1,155 @@
+#include "magic_depth_cloud.h"
+#include "magic_sdk_version.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+
+using namespace magic::dog;
+using namespace magic::dog::sensor;
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int32_t kWidth = 640;
+constexpr int32_t kHeight = 480;
+
+CameraInfo make_camera_info() {
+  CameraInfo info{};
+  info.header.stamp = 0;
+  info.header.frame_id = "depth_optical";
+  info.width = kWidth;
+  info.height = kHeight;
+  info.distortion_model = "plumb_bob";
+  info.D = {0.08, -0.12, 0.001, -0.0005, 0.02};
+  info.K = {385.0, 0.0, 321.5, 0.0, 385.0, 238.7, 0.0, 0.0, 1.0};
+  info.R = {1, 0, 0, 0, 1, 0, 0, 0, 1};
+  info.P = {385.0, 0.0, 321.5, 0.0, 0.0, 385.0, 238.7, 0.0, 0.0, 0.0, 1.0, 0.0};
+  return info;
+}
+
+// Synthetic 16UC1 depth (mm): tilted floor with a box, holes every 13th pixel
+Image make_depth() {
+  Image depth{};
+  depth.header.stamp = 0;
+  depth.header.frame_id = "depth_optical";
+  depth.width = kWidth;
+  depth.height = kHeight;
+  depth.encoding = "16UC1";
+  depth.is_bigendian = false;
+  depth.step = kWidth * 2;
+  depth.data.resize(static_cast<std::size_t>(depth.step) * kHeight);
+  for (int32_t v = 0; v < kHeight; ++v) {
+    for (int32_t u = 0; u < kWidth; ++u) {
+      uint16_t mm = static_cast<uint16_t>(1500 + 5 * (kHeight - v) + (u > 250 && u < 400 && v > 150 && v < 300 ? -600 : 0));
+      if ((u + v * kWidth) % 13 == 0) {
+        mm = 0;
+      }
+      std::memcpy(depth.data.data() + v * depth.step + u * 2, &mm, 2);
+    }
+  }
+  return depth;
+}
+
+// Baseline: per-pixel division and distortion inversion every frame
+void naive_project(const Image& depth, const CameraInfo& info, PointCloud2& out) {
+  SetPointLayout<PointXYZ>(out, static_cast<std::size_t>(depth.width) * depth.height);
+  out.height = depth.height;
+  out.width = depth.width;
+  out.row_step = depth.width * out.point_step;
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  for (int32_t v = 0; v < depth.height; ++v) {
+    for (int32_t u = 0; u < depth.width; ++u) {
+      uint16_t mm;
+      std::memcpy(&mm, depth.data.data() + v * depth.step + u * 2, 2);
+      PointXYZ point{nan, nan, nan};
+      if (mm != 0) {
+        double x;
+        double y;
+        detail::UndistortNormalized((u - info.K[2]) / info.K[0], (v - info.K[5]) / info.K[4], info.D, x, y);
+        const float z = mm * 0.001f;
+        point = {static_cast<float>(x * z), static_cast<float>(y * z), z};
+      }
+      std::memcpy(out.data.data() + (static_cast<std::size_t>(v) * depth.width + u) * sizeof(PointXYZ), &point, sizeof(point));
+    }
+  }
+}
+
+// Largest distance (px) between a pixel and the projection of its point through the distortion model
+double max_reprojection_error(const PointCloud2& cloud, const CameraInfo& info, int32_t decimation) {
+  const PointCloudView<PointXYZ> view(cloud);
+  const double k1 = info.D[0], k2 = info.D[1], p1 = info.D[2], p2 = info.D[3], k3 = info.D[4];
+  double error = 0.0;
+  for (int32_t row = 0; row < cloud.height; ++row) {
+    for (int32_t column = 0; column < cloud.width; ++column) {
+      const PointXYZ point = view[static_cast<std::size_t>(row) * cloud.width + column];
+      if (std::isnan(point.z)) {
+        continue;
+      }
+      const double x = point.x / point.z;
+      const double y = point.y / point.z;
+      const double r2 = x * x + y * y;
+      const double radial = 1.0 + k1 * r2 + k2 * r2 * r2 + k3 * r2 * r2 * r2;
+      const double xd = x * radial + 2.0 * p1 * x * y + p2 * (r2 + 2.0 * x * x);
+      const double yd = y * radial + p1 * (r2 + 2.0 * y * y) + 2.0 * p2 * x * y;
+      const double du = info.K[0] * xd + info.K[2] - column * decimation;
+      const double dv = info.K[4] * yd + info.K[5] - row * decimation;
+      error = std::max(error, std::sqrt(du * du + dv * dv));
+    }
+  }
+  return error;
+}
+
+template <typename F>
+double time_ms(int frames, F&& f) {
+  const auto start = Clock::now();
+  for (int n = 0; n < frames; ++n) {
+    f();
+  }
+  return std::chrono::duration<double, std::milli>(Clock::now() - start).count() / frames;
+}
+
+int main(int argc, char* argv[]) {
+  const int frames = argc > 1 ? std::atoi(argv[1]) : 300;
+  const std::size_t threads = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 4;
+
+  const CameraInfo info = make_camera_info();
+  const Image depth = make_depth();
+  PointCloud2 cloud;
+  std::cout << "depth: " << kWidth << "x" << kHeight << " 16UC1, frames: " << frames << std::endl;
+
+  const double naive_ms = time_ms(std::max(frames / 10, 1), [&] { naive_project(depth, info, cloud); });
+  std::cout << "naive per-pixel undistort:  " << naive_ms << " ms/frame, reprojection error "
+            << max_reprojection_error(cloud, info, 1) << " px" << std::endl;
+
+  struct Case {
+    const char* name;
+    int32_t decimation;
+    std::size_t threads;
+    bool organized;
+  };
+  for (const Case& c : {Case{"ray table, 1 thread:       ", 1, 1, true}, Case{"ray table, N threads:      ", 1, threads, true},
+                        Case{"ray table, decimation 2:   ", 2, 1, true}, Case{"ray table, dense output:   ", 1, 1, false}}) {
+    DepthCloudOptions options;
+    options.decimation = c.decimation;
+    options.threads = c.threads;
+    options.organized = c.organized;
+    DepthCloudProjector projector(options);
+    const auto build_start = Clock::now();
+    const Status status = projector.SetCameraInfo(info);
+    const double build_ms = std::chrono::duration<double, std::milli>(Clock::now() - build_start).count();
+    if (status.code != ErrorCode::OK) {
+      std::cerr << "SetCameraInfo failed: " << status.message << std::endl;
+      return 1;
+    }
+    const double ms = time_ms(frames, [&] { projector.Project(depth, cloud); });
+    std::cout << c.name << ms << " ms/frame (" << 1000.0 / ms << " fps), " << cloud.width * cloud.height << " points";
+    if (c.organized) {
+      std::cout << ", reprojection error " << max_reprojection_error(cloud, info, c.decimation) << " px";
+    }
+    std::cout << ", table build " << build_ms << " ms" << std::endl;
+  }
+  return 0;
+}
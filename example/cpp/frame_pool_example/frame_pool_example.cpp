@@ -0,0 +1,124 @@
+#include "magic_frame_pool.h"
+#include "magic_realtime.h"
+#include "magic_sdk_version.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+using namespace magic::dog;
+
+using Clock = std::chrono::steady_clock;
+
+// Heap allocations made while g_count_allocations is set (kept out of line so the compiler does not pair the
+// inlined malloc/free with new/delete)
+bool g_count_allocations = false;
+std::atomic<uint64_t> g_allocations{0};
+
+[[gnu::noinline]] void* operator new(std::size_t size) {
+  if (g_count_allocations) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+  }
+  if (void* p = std::malloc(size == 0 ? 1 : size)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+[[gnu::noinline]] void operator delete(void* p) noexcept { std::free(p); }
+[[gnu::noinline]] void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+struct Result {
+  LatencyHistogram frame;  // Per-frame copy time (ns)
+  double ns_per_frame = 0.0;
+  double mallocs_per_frame = 0.0;
+  uint64_t exhausted = 0;
+};
+
+// Keep a copy of each delivered frame in a queue of queue_depth frames, as a synchronizer or worker queue would
+template <typename Copy>
+void run(const std::shared_ptr<Image>& msg, int frames, std::size_t queue_depth, Copy&& copy, Result& result) {
+  std::vector<std::shared_ptr<Image>> queue(queue_depth);
+  g_allocations = 0;
+  g_count_allocations = true;
+  const auto start = Clock::now();
+  for (int n = 0; n < frames; ++n) {
+    msg->header.stamp = n;
+    const int64_t begin = SteadyNowNs();
+    auto image = copy(*msg);
+    result.frame.Record(SteadyNowNs() - begin);
+    if (!image) {
+      ++result.exhausted;
+      continue;
+    }
+    if (queue_depth > 0) {
+      queue[n % queue_depth] = std::move(image);
+    }
+  }
+  const auto end = Clock::now();
+  g_count_allocations = false;
+  result.ns_per_frame = std::chrono::duration<double, std::nano>(end - start).count() / frames;
+  result.mallocs_per_frame = static_cast<double>(g_allocations) / frames;
+}
+
+void print_result(const char* name, const Result& result, std::size_t bytes) {
+  const LatencySummary s = Summarize(result.frame);
+  std::cout << name << result.ns_per_frame / 1000.0 << " us/frame, " << bytes / result.ns_per_frame << " GB/s, copy p99 "
+            << s.p99 / 1000.0 << " us, max " << s.max / 1000.0 << " us, " << result.mallocs_per_frame << " mallocs/frame";
+  if (result.exhausted > 0) {
+    std::cout << ", " << result.exhausted << " frames dropped (pool exhausted)";
+  }
+  std::cout << std::endl;
+}
+
+void bench(const char* name, int32_t width, int32_t height, const std::string& encoding, int frames,
+           std::size_t queue_depth) {
+  const int32_t bytes_per_pixel = ImageBytesPerPixel(encoding);
+  auto msg = std::make_shared<Image>();
+  msg->header.frame_id = "camera_link";
+  msg->width = width;
+  msg->height = height;
+  msg->encoding = encoding;
+  msg->step = width * bytes_per_pixel;
+  msg->data.assign(static_cast<std::size_t>(msg->step) * static_cast<std::size_t>(height), 0x5A);
+  const std::size_t bytes = msg->data.size();
+  std::cout << name << " (" << bytes / 1024 << " KiB):" << std::endl;
+
+  // Upper bound: memcpy into one preallocated buffer
+  std::vector<uint8_t> target(bytes);
+  const auto start = Clock::now();
+  for (int n = 0; n < frames; ++n) {
+    msg->data[0] = static_cast<uint8_t>(n);
+    std::memcpy(target.data(), msg->data.data(), bytes);
+  }
+  const double memcpy_ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / frames;
+  std::cout << "  memcpy (bound):      " << memcpy_ns / 1000.0 << " us/frame, " << bytes / memcpy_ns << " GB/s ("
+            << static_cast<int>(target[0]) << ")" << std::endl;
+
+  Result copy_result;
+  run(msg, frames, queue_depth, [](const Image& source) { return std::make_shared<Image>(source); }, copy_result);
+  print_result("  make_shared copy:    ", copy_result, bytes);
+
+  // One buffer per queued frame plus the one being filled
+  ImagePool pool(queue_depth + 1, width, height, bytes_per_pixel);
+  Result pool_result;
+  run(msg, frames, queue_depth, [&](const Image& source) { return pool.CopyFrom(source); }, pool_result);
+  print_result("  ImagePool::CopyFrom: ", pool_result, bytes);
+}
+
+int main(int argc, char* argv[]) {
+  const int frames = argc > 1 ? std::atoi(argv[1]) : 2000;
+  const std::size_t queue_depth = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 2;
+  std::cout << "frames: " << frames << ", queue depth: " << queue_depth << std::endl;
+
+  bench("640x480 rgb8", 640, 480, "rgb8", frames, queue_depth);
+  bench("1280x720 rgb8", 1280, 720, "rgb8", frames, queue_depth);
+  bench("640x480 16UC1 depth", 640, 480, "16UC1", frames, queue_depth);
+  return 0;
+}
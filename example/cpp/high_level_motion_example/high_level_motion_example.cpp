@@ -1,3 +1,4 @@
+#include "magic_gait_watcher.h"
 #include "magic_robot.h"
 #include "magic_sdk_version.h"
 
@@ -16,6 +17,7 @@ using namespace magic::dog;
 
 // Global variables
 std::unique_ptr<MagicRobot> robot = nullptr;
+std::unique_ptr<motion::GaitWatcher> gait_watcher = nullptr;
 std::atomic<bool> running(true);
 
 void signalHandler(int signum) {
@@ -140,13 +142,10 @@ bool change_gait_to_down_climb_stairs() {
       }
 
       // Wait for gait switch to complete
-      while (current_gait != GaitMode::GAIT_DOWN_CLIMB_STAIRS) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
-        status = high_controller.GetGait(current_gait);
-        if (status.code != ErrorCode::OK) {
-          std::cerr << "Failed to get gait during transition: " << status.message << std::endl;
-          return false;
-        }
+      status = gait_watcher->WaitForGait(GaitMode::GAIT_DOWN_CLIMB_STAIRS);
+      if (status.code != ErrorCode::OK) {
+        std::cerr << "Failed to wait for gait transition: " << status.message << std::endl;
+        return false;
       }
     }
     std::cout << "Gait changed to down climb stairs" << std::endl;
@@ -235,6 +234,10 @@ int main(int argc, char* argv[]) {
     return -1;
   }
 
+  // Shared gait watcher, queries the gait only while a transition is awaited
+  gait_watcher = std::make_unique<motion::GaitWatcher>(robot->GetHighLevelMotionController());
+  gait_watcher->Start();
+
   std::cout << "Program started, please use keys to control robot..." << std::endl;
 
   while (running) {
@@ -321,6 +324,8 @@ int main(int argc, char* argv[]) {
     }
   }
 
+  gait_watcher.reset();
+
   // Disconnect from robot
   status = robot->Disconnect();
   if (status.code != ErrorCode::OK) {
@@ -0,0 +1,130 @@
+#include "magic_joint_simd.h"
+#include "magic_sdk_version.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+
+using namespace magic::dog;
+using namespace magic::dog::motion;
+
+using Clock = std::chrono::steady_clock;
+
+constexpr double kTorqueLimit = 30.0;
+
+// Poses from low_level_motion_example: base height 0.2 m and 0.3 m
+LegJointCommand make_pose(const double (&leg)[3]) {
+  LegJointCommand command{};
+  for (std::size_t i = 0; i < kLegJointNum; ++i) {
+    command.cmd[i].q_des = leg[i % 3];
+    command.cmd[i].kp = 50.0;
+    command.cmd[i].kd = 0.5;
+  }
+  return command;
+}
+
+LegState make_state() {
+  LegState state{};
+  for (std::size_t i = 0; i < kLegJointNum; ++i) {
+    state.state[i].q = 0.1 * static_cast<double>(i % 3);
+    state.state[i].dq = 0.01 * static_cast<double>(i);
+  }
+  return state;
+}
+
+// Baseline: the same control step written directly against the AoS wire types
+void aos_step(const LegJointCommand& from, const LegJointCommand& to, double t, const LegState& state,
+              LegJointCommand& command, double (&tau)[kLegJointNum]) {
+  for (std::size_t i = 0; i < kLegJointNum; ++i) {
+    command.cmd[i].q_des = from.cmd[i].q_des + t * (to.cmd[i].q_des - from.cmd[i].q_des);
+    command.cmd[i].dq_des = 0.0;
+    command.cmd[i].tau_des = 0.0;
+    command.cmd[i].kp = from.cmd[i].kp;
+    command.cmd[i].kd = from.cmd[i].kd;
+    const double torque = command.cmd[i].tau_des + command.cmd[i].kp * (command.cmd[i].q_des - state.state[i].q) +
+                          command.cmd[i].kd * (command.cmd[i].dq_des - state.state[i].dq);
+    tau[i] = std::clamp(torque, -kTorqueLimit, kTorqueLimit);
+  }
+}
+
+int main(int argc, char* argv[]) {
+  const long cycles = argc > 1 ? std::atol(argv[1]) : 10000000;
+
+  const double j1[] = {0.0000, 1.0477, -2.0944};
+  const double j2[] = {0.0000, 0.7231, -1.4455};
+  const LegJointCommand from = make_pose(j1);
+  const LegJointCommand to = make_pose(j2);
+  const LegState state = make_state();
+
+  // AoS
+  LegJointCommand command{};
+  double aos_tau[kLegJointNum];
+  double checksum_aos = 0.0;
+  auto start = Clock::now();
+  for (long n = 0; n < cycles; ++n) {
+    aos_step(from, to, static_cast<double>(n % 1000) / 1000.0, state, command, aos_tau);
+    checksum_aos += aos_tau[n % kLegJointNum];
+  }
+  const double aos_ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / cycles;
+
+  // SoA kernels, with the poses and the state already in SoA form
+  LegCommandSoA from_soa;
+  LegCommandSoA to_soa;
+  LegCommandSoA command_soa;
+  LegStateSoA state_soa;
+  ToSoA(from, from_soa);
+  ToSoA(to, to_soa);
+  ToSoA(from, command_soa);
+  ToSoA(state, state_soa);
+  JointArray soa_tau;
+  double checksum_soa = 0.0;
+  start = Clock::now();
+  for (long n = 0; n < cycles; ++n) {
+    JointLerp(from_soa.q_des, to_soa.q_des, static_cast<double>(n % 1000) / 1000.0, command_soa.q_des);
+    JointPdTorque(command_soa, state_soa, soa_tau);
+    JointClampSymmetric(soa_tau, kTorqueLimit);
+    checksum_soa += soa_tau[n % kLegJointNum];
+  }
+  const double soa_ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / cycles;
+
+  // SoA kernels including the per-cycle conversion from the received state and to the wire command
+  double checksum_convert = 0.0;
+  start = Clock::now();
+  for (long n = 0; n < cycles; ++n) {
+    ToSoA(state, state_soa);
+    JointLerp(from_soa.q_des, to_soa.q_des, static_cast<double>(n % 1000) / 1000.0, command_soa.q_des);
+    JointPdTorque(command_soa, state_soa, soa_tau);
+    JointClampSymmetric(soa_tau, kTorqueLimit);
+    FromSoA(command_soa, command);
+    checksum_convert += soa_tau[n % kLegJointNum];
+  }
+  const double convert_ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / cycles;
+
+  // Agreement of the last cycle, and the clamp's NaN handling
+  double max_difference = 0.0;
+  for (std::size_t i = 0; i < kLegJointNum; ++i) {
+    max_difference = std::max(max_difference, std::abs(aos_tau[i] - soa_tau[i]));
+  }
+  JointArray nan_values;
+  nan_values[0] = std::numeric_limits<double>::quiet_NaN();
+  JointClampSymmetric(nan_values, kTorqueLimit);
+
+#if defined(__AVX2__)
+  const char* kernels = "AVX2";
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  const char* kernels = "NEON";
+#else
+  const char* kernels = "scalar";
+#endif
+  std::cout << "cycles: " << cycles << ", joints: " << static_cast<int>(kLegJointNum) << ", kernels: " << kernels << std::endl;
+  std::cout << "AoS lerp + PD + clamp:            " << aos_ns << " ns/cycle" << std::endl;
+  std::cout << "SoA lerp + PD + clamp:            " << soa_ns << " ns/cycle (" << aos_ns / soa_ns << "x)" << std::endl;
+  std::cout << "SoA incl. ToSoA/FromSoA:          " << convert_ns << " ns/cycle (" << aos_ns / convert_ns << "x)" << std::endl;
+  std::cout << "max torque difference AoS/SoA:    " << max_difference << " Nm" << std::endl;
+  std::cout << "JointClamp(NaN) -> " << nan_values[0] << " (lower limit)" << std::endl;
+  std::cout << "checksums: " << checksum_aos << " / " << checksum_soa << " / " << checksum_convert << std::endl;
+  return 0;
+}
@@ -0,0 +1,144 @@
+#include "magic_laser_scan.h"
+#include "magic_realtime.h"
+#include "magic_scan_deskew.h"
+#include "magic_sdk_version.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <numbers>
+#include <random>
+#include <vector>
+
+using namespace magic::dog;
+using namespace magic::dog::sensor;
+
+constexpr int kBeams = 1440;  // 360 deg / 0.25 deg
+
+// Synthetic room scan: walls 2-8 m away, some dropouts
+LaserScan make_scan(std::mt19937& rng) {
+  const LaserScanUnits units;
+  LaserScan scan;
+  scan.header.stamp = 0;
+  scan.header.frame_id = "laser";
+  scan.angle_min = static_cast<int32_t>(std::lround(-std::numbers::pi / units.angle));
+  scan.angle_max = static_cast<int32_t>(std::lround((std::numbers::pi - 2.0 * std::numbers::pi / kBeams) / units.angle));
+  scan.angle_increment = static_cast<int32_t>(std::lround(2.0 * std::numbers::pi / kBeams / units.angle));
+  scan.time_increment = 0;
+  scan.scan_time = static_cast<int32_t>(std::lround(0.1 / units.time));
+  scan.range_min = static_cast<int32_t>(std::lround(0.05 / units.range));
+  scan.range_max = static_cast<int32_t>(std::lround(30.0 / units.range));
+  std::uniform_real_distribution<double> noise(-0.01, 0.01);
+  for (int i = 0; i < kBeams; ++i) {
+    const double angle = -std::numbers::pi + 2.0 * std::numbers::pi * i / kBeams;
+    const double wall = std::min(4.0 / std::max(std::abs(std::cos(angle)), 1e-3), 3.0 / std::max(std::abs(std::sin(angle)), 1e-3));
+    scan.ranges.push_back(i % 97 == 0 ? 0.0 : std::min(wall, 8.0) + noise(rng));
+    scan.intensities.push_back(100.0);
+  }
+  return scan;
+}
+
+// Robot driving at 1 m/s while turning at 1 rad/s: odometry at 50 Hz and gyro at 500 Hz over [0, 2 s]
+void fill_motion(slam::OdometryBuffer& odometry, ImuBuffer& imu) {
+  for (int64_t stamp = 0; stamp <= 2000000000; stamp += 2000000) {
+    const double t = static_cast<double>(stamp) * 1e-9;
+    if (stamp % 20000000 == 0) {
+      Odometry sample{};
+      sample.header.stamp = stamp;
+      sample.position = {std::sin(t), 1.0 - std::cos(t), 0.0};
+      sample.orientation = {std::cos(0.5 * t), 0.0, 0.0, std::sin(0.5 * t)};
+      sample.linear_velocity = {1.0, 0.0, 0.0};
+      sample.angular_velocity = {0.0, 0.0, 1.0};
+      odometry.Update(sample);
+    }
+    imu.Update(ImuSample{stamp, {0.0, 0.0, 1.0}});
+  }
+}
+
+// Deskew the scan `count` times, timing each Process() call after a first one that sizes the buffers
+LatencySummary time_deskew(const LaserScan& scan, ScanDeskewer& deskewer, int count, bool& compensated) {
+  LatencyHistogram histogram;
+  DeskewedScan out;
+  deskewer.Process(scan, out);
+  for (int n = 0; n < count; ++n) {
+    const int64_t start = SteadyNowNs();
+    deskewer.Process(scan, out);
+    histogram.Record(SteadyNowNs() - start);
+  }
+  compensated = out.compensated;
+  return Summarize(histogram);
+}
+
+int main(int argc, char* argv[]) {
+  const int count = argc > 1 ? std::atoi(argv[1]) : 10000;
+
+  std::mt19937 rng(42);
+  LaserScan scan = make_scan(rng);
+  const LaserScanGeometry geometry = MakeLaserScanGeometry(scan);
+  using Clock = std::chrono::steady_clock;
+
+  // Baseline: double ranges, trig per beam
+  std::vector<double> xd(kBeams);
+  std::vector<double> yd(kBeams);
+  double checksum_double = 0.0;
+  auto start = Clock::now();
+  for (int n = 0; n < count; ++n) {
+    for (int i = 0; i < kBeams; ++i) {
+      const double angle = geometry.angle_min + static_cast<double>(geometry.angle_increment) * i;
+      const double r = scan.ranges[i];
+      const bool valid = r >= geometry.range_min && r <= geometry.range_max;
+      xd[i] = valid ? r * std::cos(angle) : NAN;
+      yd[i] = valid ? r * std::sin(angle) : NAN;
+    }
+    checksum_double += std::isnan(xd[n % kBeams]) ? 0.0 : xd[n % kBeams];
+  }
+  const double double_us = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / count;
+
+  // Compact: pooled float32 scan, cached trig table, SIMD conversion
+  LaserScanPool pool(4, kBeams);
+  ScanTrigTable table;
+  LaserPoints points;
+  double checksum_float = 0.0;
+  double convert_total_us = 0.0;
+  start = Clock::now();
+  for (int n = 0; n < count; ++n) {
+    auto convert_start = Clock::now();
+    auto compact = pool.CopyFrom(scan);
+    convert_total_us += std::chrono::duration<double, std::micro>(Clock::now() - convert_start).count();
+    ScanToCartesian(*compact, table, points);
+    checksum_float += std::isnan(points.x[n % kBeams]) ? 0.0 : points.x[n % kBeams];
+  }
+  const double float_us = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / count;
+
+  // Accuracy of the float path against the double path
+  double max_error = 0.0;
+  for (int i = 0; i < kBeams; ++i) {
+    if (!std::isnan(xd[i])) {
+      max_error = std::max({max_error, std::abs(points.x[i] - xd[i]), std::abs(points.y[i] - yd[i])});
+    }
+  }
+
+  std::cout << "scans: " << count << ", beams: " << kBeams << std::endl;
+  std::cout << "double + per-beam trig: " << double_us << " us/scan, " << kBeams * 16 << " bytes of ranges+intensities" << std::endl;
+  std::cout << "float32 + trig table:   " << float_us << " us/scan (of which narrowing copy " << convert_total_us / count
+            << " us), " << kBeams * 8 << " bytes of ranges+intensities" << std::endl;
+  std::cout << "speedup: " << double_us / float_us << "x, max point error: " << max_error << " m" << std::endl;
+  std::cout << "checksums: " << checksum_double << " / " << checksum_float << std::endl;
+
+  // Deskewing the same scan, taken at 1 s during the motion, against the 1 ms per scan budget
+  scan.header.stamp = 1000000000;
+  slam::OdometryBuffer odometry;
+  ImuBuffer imu;
+  fill_motion(odometry, imu);
+  ScanDeskewer odometry_deskewer(odometry);
+  ScanDeskewer imu_deskewer(odometry, &imu);
+  for (auto [name, deskewer] : {std::pair{"deskew (odometry):      ", &odometry_deskewer}, std::pair{"deskew (odometry + IMU):", &imu_deskewer}}) {
+    bool compensated = false;
+    const LatencySummary s = time_deskew(scan, *deskewer, count, compensated);
+    std::cout << name << " p50 " << s.p50 / 1000.0 << " us, p99 " << s.p99 / 1000.0 << " us, max " << s.max / 1000.0
+              << " us per scan (compensated: " << (compensated ? "yes" : "no") << "; target < 1 ms: "
+              << (s.p99 < 1000000 ? "met" : "missed") << ")" << std::endl;
+  }
+  return 0;
+}
@@ -0,0 +1,153 @@
+#include "magic_motion_realtime.h"
+#include "magic_sdk_version.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+
+using namespace magic::dog;
+using namespace magic::dog::motion;
+
+// Heap allocations made by threads that set g_count_allocations (kept out of line so the compiler does not pair
+// the inlined malloc/free with new/delete)
+thread_local bool g_count_allocations = false;
+std::atomic<uint64_t> g_allocations{0};
+
+[[gnu::noinline]] void* operator new(std::size_t size) {
+  if (g_count_allocations) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+  }
+  if (void* p = std::malloc(size == 0 ? 1 : size)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+[[gnu::noinline]] void operator delete(void* p) noexcept { std::free(p); }
+[[gnu::noinline]] void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+// Baseline: the SDK callback path, one shared_ptr per message, latest pointer kept under a mutex
+class CallbackLatest {
+ public:
+  CallbackLatest() {
+    callback_ = [this](const std::shared_ptr<LegState> msg) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      latest_ = msg;
+    };
+  }
+
+  void Update(const LegState& state) { callback_(std::make_shared<LegState>(state)); }
+
+  bool Read(LegState& state) {
+    std::shared_ptr<LegState> msg;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      msg = latest_;
+    }
+    if (!msg) {
+      return false;
+    }
+    state = *msg;
+    return true;
+  }
+
+ private:
+  std::function<void(const std::shared_ptr<LegState>)> callback_;
+  std::mutex mutex_;
+  std::shared_ptr<LegState> latest_;
+};
+
+struct Result {
+  LatencyHistogram control_read;  // Control thread read latency (ns)
+  uint64_t second_reads = 0;      // Reads completed by the contending reader
+  uint64_t writes = 0;            // Samples published
+  uint64_t write_allocations = 0; // Heap allocations on the writer thread
+};
+
+// Writer at writer_hz (0: unthrottled) and a contending reader, while the control thread times reads for `duration`
+template <typename Update, typename Read>
+void run(std::chrono::milliseconds duration, int writer_hz, Update&& update, Read&& read, Result& result) {
+  std::atomic<bool> done{false};
+  g_allocations = 0;
+
+  std::thread writer([&] {
+    LegState state{};
+    const auto period = std::chrono::nanoseconds(writer_hz > 0 ? 1000000000LL / writer_hz : 0);
+    auto next = std::chrono::steady_clock::now();
+    g_count_allocations = true;
+    while (!done.load(std::memory_order_relaxed)) {
+      state.timestamp = SteadyNowNs();
+      for (std::size_t i = 0; i < kLegJointNum; ++i) {
+        state.state[i].q = 0.001 * static_cast<double>(result.writes % 1000);
+      }
+      update(state);
+      ++result.writes;
+      if (writer_hz > 0) {
+        next += period;
+        std::this_thread::sleep_until(next);
+      }
+    }
+    g_count_allocations = false;
+    result.write_allocations = g_allocations;
+  });
+
+  std::thread second_reader([&] {
+    LegState state;
+    while (!done.load(std::memory_order_relaxed)) {
+      read(state);
+      ++result.second_reads;
+    }
+  });
+
+  LegState state;
+  while (!read(state)) {
+    std::this_thread::yield();
+  }
+  const int64_t end = SteadyNowNs() + std::chrono::nanoseconds(duration).count();
+  for (int64_t start = SteadyNowNs(); start < end; start = SteadyNowNs()) {
+    read(state);
+    result.control_read.Record(SteadyNowNs() - start);
+  }
+  done = true;
+  writer.join();
+  second_reader.join();
+}
+
+void print_result(const char* name, const Result& result) {
+  const LatencySummary s = Summarize(result.control_read);
+  std::cout << name << s.count << " reads, p50 " << s.p50 << " ns, p99 " << s.p99 << " ns, p99.9 " << s.p999 << " ns, max " << s.max
+            << " ns; second reader " << result.second_reads << " reads; writer " << result.writes << " samples, "
+            << static_cast<double>(result.write_allocations) / static_cast<double>(std::max<uint64_t>(result.writes, 1))
+            << " mallocs/sample" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+  const std::chrono::milliseconds duration(argc > 1 ? std::atoi(argv[1]) * 1000 : 3000);
+  const int writer_hz = argc > 2 ? std::atoi(argv[2]) : 500;
+  std::cout << "duration: " << duration.count() / 1000 << " s per path, writer: " << (writer_hz > 0 ? std::to_string(writer_hz) + " Hz" : "unthrottled")
+            << ", plus one contending reader" << std::endl;
+
+  CallbackLatest callback_latest;
+  Result callback_result;
+  run(
+      duration, writer_hz, [&](const LegState& state) { callback_latest.Update(state); },
+      [&](LegState& state) { return callback_latest.Read(state); }, callback_result);
+
+  LegStateMailbox mailbox;
+  Result mailbox_result;
+  run(
+      duration, writer_hz, [&](const LegState& state) { mailbox.Update(state); },
+      [&](LegState& state) { return mailbox.Read(state) == RtErrorCode::OK; }, mailbox_result);
+
+  print_result("shared_ptr callback: ", callback_result);
+  print_result("LegStateMailbox:     ", mailbox_result);
+  return 0;
+}
@@ -1,3 +1,6 @@
+#include "magic_control_loop.h"
+#include "magic_gait_watcher.h"
+#include "magic_motion_realtime.h"
 #include "magic_robot.h"
 #include "magic_sdk_version.h"
 #include "magic_type.h"
@@ -6,7 +9,6 @@
 #include <csignal>
 #include <iostream>
 #include <memory>
-#include <mutex>
 #include <chrono>
 #include <thread>
 #include <cstdlib>
@@ -55,6 +57,10 @@ int main() {
     std::cout << "Getting high level motion controller" << std::endl;
     auto& high_controller = robot->GetHighLevelMotionController();
     
+    // Gait transitions are awaited through one shared watcher instead of a GetGait polling loop
+    motion::GaitWatcher gait_watcher(high_controller);
+    gait_watcher.Start();
+    
     std::cout << "Setting motion mode to passive" << std::endl;
     status = high_controller.SetGait(GaitMode::GAIT_PASSIVE);
     if (status.code != ErrorCode::OK) {
@@ -64,15 +70,11 @@ int main() {
     }
     
     std::cout << "Waiting for motion mode to change to passive" << std::endl;
-    GaitMode current_mode = GaitMode::GAIT_UNKNOWN;
-    while (current_mode != GaitMode::GAIT_PASSIVE) {
-        status = high_controller.GetGait(current_mode);
-        if (status.code != ErrorCode::OK) {
-            std::cerr << "Failed to get gait: " << status.message << std::endl;
-            robot->Shutdown();
-            return -1;
-        }
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    status = gait_watcher.WaitForGait(GaitMode::GAIT_PASSIVE, 10000);
+    if (status.code != ErrorCode::OK) {
+        std::cerr << "Failed to wait for passive gait: " << status.message << std::endl;
+        robot->Shutdown();
+        return -1;
     }
     
     std::this_thread::sleep_for(std::chrono::seconds(2));
@@ -86,14 +88,12 @@ int main() {
     }
     
     std::cout << "Waiting for motion mode to change to low level" << std::endl;
-    while (current_mode != GaitMode::GAIT_LOWLEVL_SDK) {
-        status = high_controller.GetGait(current_mode);
-        if (status.code != ErrorCode::OK) {
-            std::cerr << "Failed to get gait: " << status.message << std::endl;
-            robot->Shutdown();
-            return -1;
-        }
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    status = gait_watcher.WaitForGait(GaitMode::GAIT_LOWLEVL_SDK, 10000);
+    gait_watcher.Stop();
+    if (status.code != ErrorCode::OK) {
+        std::cerr << "Failed to wait for low level gait: " << status.message << std::endl;
+        robot->Shutdown();
+        return -1;
     }
     
     std::this_thread::sleep_for(std::chrono::seconds(2));
@@ -101,31 +101,18 @@ int main() {
     std::cout << "Getting low level motion controller" << std::endl;
     auto& low_controller = robot->GetLowLevelMotionController();
     
-    bool is_had_receive_leg_state = false;
-    std::mutex mut;
-    LegState receive_state;
-    int count = 0;
-    
-    auto leg_state_callback = [&](const std::shared_ptr<LegState> msg) {
-        if (!is_had_receive_leg_state) {
-            std::lock_guard<std::mutex> guard(mut);
-            is_had_receive_leg_state = true;
-            receive_state = *msg;
-        }
-        if (count % 1000 == 0) {
-            std::cout << "Received leg state data." << std::endl;
-        }
-        count++;
-    };
-    
-    low_controller.SubscribeLegState(leg_state_callback);
+    // Latest leg state is polled from the control loop, no mutex or shared_ptr copies needed
+    motion::LegStateMailbox leg_state_mailbox;
+    leg_state_mailbox.Attach(low_controller);
     
     std::cout << "Waiting to receive leg state data" << std::endl;
-    while (!is_had_receive_leg_state) {
+    LegState receive_state;
+    while (leg_state_mailbox.Read(receive_state) != RtErrorCode::OK) {
         std::this_thread::sleep_for(std::chrono::milliseconds(2));
     }
     
     std::this_thread::sleep_for(std::chrono::seconds(10));
+    leg_state_mailbox.Read(receive_state);
     
     // Joint angles for different poses
     double j1[] = {0.0000, 1.0477, -2.0944};  // base height 0.2
@@ -139,15 +126,23 @@ int main() {
         receive_state.state[9].q, receive_state.state[10].q, receive_state.state[11].q
     };
     
+    // Commands are queued without allocation and sent from a separate thread. The sender polls every 200 us so
+    // Publish() makes no syscall on the control thread; poll_interval = 0 wakes it per command instead
+    motion::RealtimePublisherOptions publisher_options;
+    publisher_options.poll_interval = std::chrono::microseconds(200);
+    motion::RealtimeLegCommandPublisher publisher(low_controller, publisher_options);
+    publisher.Start();
+    
     LegJointCommand command;
     int cnt = 0;
     
     std::cout << "Starting joint control loop..." << std::endl;
     
-    // 计算第一个周期的时间点
-    auto interval = std::chrono::milliseconds(2);
-    auto next_cycle = std::chrono::steady_clock::now() + interval;
-    while (true) {
+    // 2ms period (500Hz), see ControlLoopOptions for CPU pinning, RT priority and memory locking
+    motion::ControlLoopOptions loop_options;
+    loop_options.period = std::chrono::milliseconds(2);
+    motion::ControlLoop control_loop(loop_options);
+    status = control_loop.Start([&](uint64_t) {
         double t;
         
         if (cnt < 1000) {
@@ -178,12 +173,21 @@ int main() {
             command.cmd[i].kd = 1.2;
         }
         
-        low_controller.PublishLegCommand(command);
-        // 精确休眠到下一个周期
-        std::this_thread::sleep_until(next_cycle);
-        // 更新下一个周期的时间点
-        next_cycle += interval;
+        publisher.Publish(command);
         cnt++;
+    });
+    if (status.code != ErrorCode::OK) {
+        std::cerr << "Failed to start control loop: " << status.message << std::endl;
+        robot->Shutdown();
+        return -1;
+    }
+    
+    while (control_loop.IsRunning()) {
+        std::this_thread::sleep_for(std::chrono::seconds(5));
+        auto loop_stats = control_loop.GetStats();
+        std::cout << "Control loop cycles: " << loop_stats.cycles
+                  << ", overruns: " << loop_stats.overruns
+                  << ", jitter p99: " << control_loop.GetWakeupJitter().Percentile(99) << " ns" << std::endl;
     }
     
     // Disconnect from robot
@@ -0,0 +1,204 @@
+#include "magic_map.h"
+#include "magic_robot.h"
+#include "magic_sdk_version.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace magic::dog;
+using namespace magic::dog::slam;
+
+// Read a binary (P5) PGM file into the SDK structure
+bool load_pgm(const std::string& path, MapInfo& info) {
+  std::ifstream file(path, std::ios::binary);
+  MapImageData& image = info.map_meta_data.map_image_data;
+  file >> image.type;
+  // Skip comment lines between header fields
+  auto next_field = [&file](uint32_t& value) {
+    file >> std::ws;
+    while (file.peek() == '#') {
+      std::string comment;
+      std::getline(file, comment);
+      file >> std::ws;
+    }
+    file >> value;
+  };
+  next_field(image.width);
+  next_field(image.height);
+  next_field(image.max_gray_value);
+  file.get();
+  if (!file || image.type != "P5" || image.max_gray_value > 255) {
+    std::cerr << path << ": not an 8-bit binary PGM file" << std::endl;
+    return false;
+  }
+  image.image.resize(static_cast<std::size_t>(image.width) * image.height);
+  file.read(reinterpret_cast<char*>(image.image.data()), static_cast<std::streamsize>(image.image.size()));
+  if (!file) {
+    std::cerr << path << ": truncated image" << std::endl;
+    return false;
+  }
+  info.map_name = path;
+  return true;
+}
+
+// Synthetic size x size site map (0.05 m cells): unknown surroundings, a building of free rooms behind 3-cell
+// walls with doorways, scattered obstacles, and speckle along the walls as left by laser mapping
+MapInfo make_synthetic_map(uint32_t size) {
+  constexpr uint8_t kFree = 254, kOccupied = 0, kUnknown = 205;
+  MapInfo info;
+  info.map_name = "synthetic site map";
+  info.map_meta_data.resolution = 0.05;
+  MapImageData& image = info.map_meta_data.map_image_data;
+  image.type = "P5";
+  image.width = size;
+  image.height = size;
+  image.max_gray_value = 255;
+  image.image.assign(static_cast<std::size_t>(size) * size, kUnknown);
+  auto at = [&image, size](uint32_t x, uint32_t y) -> uint8_t& { return image.image[static_cast<std::size_t>(y) * size + x]; };
+  uint64_t seed = 0x2545F4914F6CDD1Dull;
+  auto random = [&seed](uint32_t range) {
+    seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+    return static_cast<uint32_t>((seed >> 33) % range);
+  };
+
+  // Building footprint in the middle 80%, split into rooms of 40-160 cells (2-8 m)
+  const uint32_t lo = size / 10, hi = size - size / 10;
+  for (uint32_t y = lo; y < hi; ++y) {
+    std::fill(&at(lo, y), &at(lo, y) + (hi - lo), kFree);
+  }
+  std::vector<uint32_t> walls_x{lo}, walls_y{lo};
+  while (walls_x.back() + 200 < hi) {
+    walls_x.push_back(walls_x.back() + 40 + random(120));
+  }
+  while (walls_y.back() + 200 < hi) {
+    walls_y.push_back(walls_y.back() + 40 + random(120));
+  }
+  walls_x.push_back(hi - 3);
+  walls_y.push_back(hi - 3);
+  for (const uint32_t wx : walls_x) {
+    for (uint32_t y = lo; y < hi; ++y) {
+      const bool doorway = wx != lo && wx != hi - 3 && (y - lo) % 97 < 18;
+      for (uint32_t t = 0; t < 3 && !doorway; ++t) {
+        at(wx + t, y) = kOccupied;
+      }
+    }
+  }
+  for (const uint32_t wy : walls_y) {
+    for (uint32_t x = lo; x < hi; ++x) {
+      const bool doorway = wy != lo && wy != hi - 3 && (x - lo) % 89 < 18;
+      for (uint32_t t = 0; t < 3 && !doorway; ++t) {
+        at(x, wy + t) = kOccupied;
+      }
+    }
+  }
+  // Furniture-sized obstacles
+  for (uint32_t i = 0; i < size / 4; ++i) {
+    const uint32_t x = lo + random(hi - lo - 20), y = lo + random(hi - lo - 20);
+    const uint32_t w = 4 + random(16), h = 4 + random(16);
+    for (uint32_t dy = 0; dy < h; ++dy) {
+      std::fill(&at(x, y + dy), &at(x, y + dy) + w, kOccupied);
+    }
+  }
+  // Mapping noise: 1 in 8 cells next to a wall flips to unknown or occupied
+  for (uint32_t y = lo + 2; y + 2 < hi; ++y) {
+    for (uint32_t x = lo + 2; x + 2 < hi; ++x) {
+      if (at(x, y) == kFree && (at(x - 2, y) == kOccupied || at(x + 2, y) == kOccupied || at(x, y - 2) == kOccupied ||
+                                at(x, y + 2) == kOccupied) && random(8) == 0) {
+        at(x, y) = random(2) == 0 ? kUnknown : kOccupied;
+      }
+    }
+  }
+  return info;
+}
+
+// Fetch all maps from the robot
+bool load_robot_maps(std::vector<MapInfo>& maps) {
+  MagicRobot robot;
+  if (!robot.InitializeGrpcOnly("192.168.55.10", SdkFeature::SlamNavigation)) {
+    std::cerr << "robot sdk initialize failed." << std::endl;
+    return false;
+  }
+  auto status = robot.Connect();
+  if (status.code != ErrorCode::OK) {
+    std::cerr << "connect robot failed, code: " << status.code
+              << ", message: " << status.message << std::endl;
+    robot.Shutdown();
+    return false;
+  }
+  AllMapInfo all_map_info;
+  status = robot.GetSlamNavController().GetAllMapInfo(all_map_info);
+  if (status.code != ErrorCode::OK) {
+    std::cerr << "get all map info failed, code: " << status.code
+              << ", message: " << status.message << std::endl;
+  }
+  maps = all_map_info.map_infos;
+  robot.Disconnect();
+  robot.Shutdown();
+  return status.code == ErrorCode::OK;
+}
+
+// Encode and decode one map, repeating until at least 200 ms elapsed
+void benchmark(const MapInfo& info) {
+  using Clock = std::chrono::steady_clock;
+  const MapImageData& image = info.map_meta_data.map_image_data;
+  const double raw_mb = static_cast<double>(image.image.size()) / 1e6;
+
+  EncodedMapImage encoded;
+  int encode_rounds = 0;
+  auto start = Clock::now();
+  do {
+    encoded = EncodedMapImage::Encode(image, MapImageEncoding::RLE);
+    ++encode_rounds;
+  } while (Clock::now() - start < std::chrono::milliseconds(200));
+  const double encode_s = std::chrono::duration<double>(Clock::now() - start).count() / encode_rounds;
+
+  MapImageData decoded;
+  Status status;
+  int decode_rounds = 0;
+  start = Clock::now();
+  do {
+    status = encoded.Decode(decoded);
+    ++decode_rounds;
+  } while (Clock::now() - start < std::chrono::milliseconds(200));
+  const double decode_s = std::chrono::duration<double>(Clock::now() - start).count() / decode_rounds;
+
+  const bool round_trip = status.code == ErrorCode::OK && decoded.image == image.image;
+  std::cout << std::fixed << std::setprecision(1) << info.map_name << " (" << image.width << "x" << image.height << ")"
+            << "\n  raw: " << image.image.size() << " bytes, rle: " << encoded.data.size() << " bytes, ratio: "
+            << static_cast<double>(image.image.size()) / std::max<std::size_t>(encoded.data.size(), 1) << "x"
+            << "\n  encode: " << raw_mb / encode_s << " MB/s, decode: " << raw_mb / decode_s << " MB/s"
+            << "\n  round trip: " << (round_trip ? "ok" : "MISMATCH") << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+  std::vector<MapInfo> maps;
+  if (argc > 1 && std::string(argv[1]) == "--synthetic") {
+    maps.push_back(make_synthetic_map(argc > 2 ? static_cast<uint32_t>(std::atoi(argv[2])) : 2000));
+  } else if (argc > 1) {
+    for (int i = 1; i < argc; ++i) {
+      MapInfo info;
+      if (load_pgm(argv[i], info)) {
+        maps.push_back(std::move(info));
+      }
+    }
+  } else if (!load_robot_maps(maps)) {
+    return -1;
+  }
+
+  if (maps.empty()) {
+    std::cerr << "no maps to benchmark" << std::endl;
+    return -1;
+  }
+  for (const auto& info : maps) {
+    benchmark(info);
+  }
+  return 0;
+}
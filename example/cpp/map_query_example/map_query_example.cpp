@@ -0,0 +1,124 @@
+#include "magic_map_query.h"
+#include "magic_sdk_version.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace magic::dog;
+using namespace magic::dog::slam;
+
+using Clock = std::chrono::steady_clock;
+
+// Synthetic size x size map (0.05 m cells, rotated origin): free rooms on a 4 m grid of occupied walls with doorways,
+// unknown border
+MapMetaData make_map(uint32_t size) {
+  MapMetaData meta;
+  meta.resolution = 0.05;
+  meta.origin.position = {-0.025 * size, -0.025 * size, 0.0};
+  meta.origin.orientation = {0.0, 0.0, 0.3};
+  MapImageData& image = meta.map_image_data;
+  image.type = "P5";
+  image.width = size;
+  image.height = size;
+  image.max_gray_value = 255;
+  image.image.assign(static_cast<std::size_t>(size) * size, 254);
+  for (uint32_t y = 0; y < size; ++y) {
+    for (uint32_t x = 0; x < size; ++x) {
+      uint8_t& pixel = image.image[static_cast<std::size_t>(y) * size + x];
+      if (x < 10 || y < 10 || x >= size - 10 || y >= size - 10) {
+        pixel = 205;
+      } else if ((x % 80 < 2 && y % 80 > 20) || (y % 80 < 2 && x % 80 > 20)) {
+        pixel = 0;
+      }
+    }
+  }
+  return meta;
+}
+
+// Poses spread over and around the map, every 1000th one not finite or beyond the int32 cell range
+std::vector<MapPoint> make_points(std::size_t count, double half_extent) {
+  std::mt19937 rng(7);
+  std::uniform_real_distribution<double> uniform(-1.2 * half_extent, 1.2 * half_extent);
+  std::vector<MapPoint> points(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    points[i] = {uniform(rng), uniform(rng)};
+    if (i % 3000 == 0) {
+      points[i].x = std::numeric_limits<double>::quiet_NaN();
+    } else if (i % 3000 == 1000) {
+      points[i].y = std::numeric_limits<double>::infinity();
+    } else if (i % 3000 == 2000) {
+      points[i].x = 1e12;
+    }
+  }
+  return points;
+}
+
+// Run a batch query repeatedly and return queries per second
+template <typename Query>
+double throughput(std::size_t count, int rounds, const Query& query) {
+  query();  // Warm-up, sizes the output
+  const auto start = Clock::now();
+  for (int i = 0; i < rounds; ++i) {
+    query();
+  }
+  return static_cast<double>(count) * rounds / std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+int main(int argc, char* argv[]) {
+  const std::size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100000;
+  const int rounds = argc > 2 ? std::atoi(argv[2]) : 20;
+  const uint32_t size = argc > 3 ? static_cast<uint32_t>(std::atoi(argv[3])) : 1000;
+
+  const MapMetaData meta = make_map(size);
+  const std::vector<MapPoint> points = make_points(count, 0.025 * size);
+  std::vector<NavTarget> targets(count);
+  std::vector<MapRay> rays(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    targets[i].goal.position = {points[i].x, points[i].y, 0.0};
+    rays[i] = {points[i].x, points[i].y, 0.001 * static_cast<double>(i), 10.0};
+  }
+  std::cout << "map: " << size << "x" << size << " cells, poses per batch: " << count << ", rounds: " << rounds << std::endl;
+
+  bool ok = true;
+  for (const std::size_t threads : {std::size_t(1), std::size_t(0)}) {
+    OccupancyGridOptions options;
+    options.threads = threads;
+    OccupancyGrid grid(options);
+    const auto load_start = Clock::now();
+    if (grid.Load(meta).code != ErrorCode::OK) {
+      std::cerr << "map load failed" << std::endl;
+      return 1;
+    }
+    const double load_ms = std::chrono::duration<double, std::milli>(Clock::now() - load_start).count();
+
+    std::vector<CellOccupancy> occupancy;
+    std::vector<float> distances;
+    std::vector<uint8_t> free;
+    std::vector<float> ranges;
+    const double occupancy_rate = throughput(count, rounds, [&] { grid.QueryOccupancy(points, occupancy); });
+    const double distance_rate = throughput(count, rounds, [&] { grid.QueryDistance(points, distances); });
+    const double target_rate = throughput(count, rounds, [&] { grid.CheckNavTargets(targets, 0.3, free); });
+    const double ray_rate = throughput(count, rounds / 4 + 1, [&] { grid.CastRays(rays, ranges); });
+
+    const unsigned workers = threads != 0 ? static_cast<unsigned>(threads) : std::max(1u, std::thread::hardware_concurrency());
+    std::cout << std::fixed << std::setprecision(2) << workers << " thread(s), load " << load_ms << " ms, poses/s:"
+              << "\n  occupancy:   " << occupancy_rate / 1e6 << " M"
+              << "\n  distance:    " << distance_rate / 1e6 << " M"
+              << "\n  nav targets: " << target_rate / 1e6 << " M"
+              << "\n  rays (10 m): " << ray_rate / 1e6 << " M" << std::endl;
+
+    // Poses that are not finite or far outside the map are rejected, not converted
+    for (std::size_t i = 0; i < count; i += 1000) {
+      ok = ok && occupancy[i] == CellOccupancy::UNKNOWN && distances[i] == 0.0f && free[i] == 0 && ranges[i] == 10.0f;
+    }
+  }
+  std::cout << (ok ? "non-finite and out-of-range poses rejected [ok]" : "non-finite and out-of-range poses [FAIL]") << std::endl;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,160 @@
+#include "magic_gait_watcher.h"
+#include "magic_nav_mission.h"
+#include "magic_nav_watcher.h"
+#include "magic_sdk_version.h"
+#include "magic_virtual_robot.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace magic::dog;
+using namespace magic::dog::slam;
+
+// Stand-in with only the navigation simulation running
+sim::VirtualRobotOptions nav_robot_options(double speed) {
+  sim::VirtualRobotOptions options;
+  options.leg_state_rate_hz = 0;
+  options.imu_rate_hz = 0;
+  options.odometry_rate_hz = 0;
+  options.laser_scan_rate_hz = 0;
+  options.image_rate_hz = 0;
+  options.audio_rate_hz = 0;
+  options.nav_speed = speed;
+  return options;
+}
+
+// Patrol around a 1 m square, consecutive waypoints with distinct IDs
+std::vector<NavTarget> patrol(int waypoints) {
+  static const double corners[4][2] = {{1.0, 0.0}, {1.0, 1.0}, {0.0, 1.0}, {0.0, 0.0}};
+  std::vector<NavTarget> targets;
+  for (int i = 0; i < waypoints; ++i) {
+    NavTarget target;
+    target.id = i + 1;
+    target.frame_id = "map";
+    target.goal.position = {corners[i % 4][0], corners[i % 4][1], 0.0};
+    target.goal.orientation = {0.0, 0.0, 0.0};
+    targets.push_back(target);
+  }
+  return targets;
+}
+
+void print_run(const char* name, sim::VirtualRobot& robot, double seconds) {
+  const LatencySummary idle = Summarize(robot.GetNavIdleTime());
+  std::cout << name << seconds << " s, idle at waypoint p50 " << idle.p50 / 1e6 << " ms, max " << idle.max / 1e6
+            << " ms, GetNavTaskStatus calls " << robot.GetNavStatusQueryCount() << std::endl;
+}
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char* argv[]) {
+  const int waypoints = argc > 1 ? std::atoi(argv[1]) : 8;
+  const int client_poll_ms = argc > 2 ? std::atoi(argv[2]) : 100;
+  const double speed = argc > 3 ? std::atof(argv[3]) : 1.5;
+  const std::vector<NavTarget> targets = patrol(waypoints);
+  std::cout << "waypoints: " << waypoints << " on a 1 m square at " << speed << " m/s" << std::endl;
+
+  // Gait switch before navigating, awaited through GaitWatcher on the stand-in
+  {
+    sim::VirtualRobot robot(nav_robot_options(speed));
+    robot.Initialize();
+    motion::GaitWatcher gait_watcher(robot.MakeGaitSource());
+    gait_watcher.Start();
+    const auto start = std::chrono::steady_clock::now();
+    robot.SetGait(GaitMode::GAIT_DOWN_CLIMB_STAIRS);
+    const Status status = gait_watcher.WaitForGait(GaitMode::GAIT_DOWN_CLIMB_STAIRS, 5000);
+    std::cout << "gait switch:      " << (status.code == ErrorCode::OK ? "reached" : status.message) << " after "
+              << seconds_since(start) * 1000.0 << " ms, GetGait calls " << robot.GetGaitQueryCount() << std::endl;
+  }
+
+  // Baseline: one target at a time, the client polls the status and sends the next target when it sees the end
+  {
+    sim::VirtualRobot robot(nav_robot_options(speed));
+    robot.Initialize();
+    const auto start = std::chrono::steady_clock::now();
+    for (const NavTarget& target : targets) {
+      robot.SetNavTarget(target);
+      NavStatus status{};
+      do {
+        std::this_thread::sleep_for(std::chrono::milliseconds(client_poll_ms));
+        robot.GetNavTaskStatus(status);
+      } while (!IsNavTaskFinished(status.status));
+    }
+    print_run("client polling:   ", robot, seconds_since(start));
+  }
+
+  // NavMission: the next target goes out as soon as the watcher reports the end of the previous one
+  {
+    sim::VirtualRobot robot(nav_robot_options(speed));
+    robot.Initialize();
+    NavStatusWatcher watcher(robot.MakeNavStatusSource(), robot.MakeLocalizationSource());
+    watcher.Start();
+    NavMission mission(robot.MakeNavTargetSink(), robot.MakeNavCancelSink(), watcher);
+    std::vector<NavWaypoint> mission_waypoints;
+    for (const NavTarget& target : targets) {
+      // A non-waiting action (e.g. TTS) runs while the robot drives on
+      mission_waypoints.push_back({target, {{"announce", [] {
+                                               std::this_thread::sleep_for(std::chrono::milliseconds(200));
+                                               return Status{ErrorCode::OK, ""};
+                                             },
+                                             false}}});
+    }
+    const auto start = std::chrono::steady_clock::now();
+    mission.Start(std::move(mission_waypoints));
+    const Status status = mission.Wait(600000);
+    if (status.code != ErrorCode::OK) {
+      std::cerr << "nav mission failed: " << status.message << std::endl;
+      return 1;
+    }
+    print_run("NavMission:       ", robot, seconds_since(start));
+  }
+
+  // Cancel while the next target is being sent: the robot must end up stopped, with the cancel after the target
+  {
+    sim::VirtualRobot robot(nav_robot_options(speed));
+    robot.Initialize();
+    NavStatusWatcher watcher(robot.MakeNavStatusSource(), robot.MakeLocalizationSource());
+    watcher.Start();
+    // A slow link: the target reaches the robot 50 ms after the call
+    auto send_target = robot.MakeNavTargetSink();
+    NavMission mission(
+        [&send_target](const NavTarget& target) {
+          std::this_thread::sleep_for(std::chrono::milliseconds(50));
+          return send_target(target);
+        },
+        robot.MakeNavCancelSink(), watcher);
+    std::vector<NavWaypoint> mission_waypoints;
+    for (const NavTarget& target : patrol(2)) {
+      mission_waypoints.push_back({target, {}});
+    }
+    std::thread canceller;
+    mission.Start(std::move(mission_waypoints), [&mission, &canceller](const MissionEvent& event) {
+      if (event.type == MissionEventType::WAYPOINT_REACHED && event.waypoint_index == 0) {
+        // The mission thread is about to send waypoint 2; cancel in the middle of that send
+        canceller = std::thread([&mission] {
+          std::this_thread::sleep_for(std::chrono::milliseconds(20));
+          mission.Cancel();
+        });
+      }
+    });
+    const Status status = mission.Wait(600000);
+    if (canceller.joinable()) {
+      canceller.join();
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    NavStatus nav_status{};
+    robot.GetNavTaskStatus(nav_status);
+    const bool stopped = status.code == ErrorCode::SERVICE_ERROR && nav_status.status != NavStatusType::RUNNING;
+    std::cout << "cancel during send: targets " << robot.GetNavTargetCount() << ", cancels " << robot.GetNavCancelCount()
+              << ", robot " << (nav_status.status == NavStatusType::RUNNING ? "still driving" : "stopped")
+              << (stopped ? " [ok]" : " [FAIL]") << std::endl;
+    if (!stopped) {
+      return 1;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,154 @@
+#include "magic_point_cloud.h"
+#include "magic_sdk_version.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+
+using namespace magic::dog;
+using namespace magic::dog::sensor;
+
+using Clock = std::chrono::steady_clock;
+
+// Synthetic XYZI cloud: ground plane and walls within 20 m, every 20th point NaN
+PointCloud2 make_cloud(std::size_t count) {
+  PointCloud2 cloud;
+  cloud.header.stamp = 0;
+  cloud.header.frame_id = "lidar";
+  SetPointLayout<PointXYZI>(cloud, count);
+  cloud.is_dense = false;
+  std::mt19937 rng(42);
+  std::uniform_real_distribution<float> uniform(-20.0f, 20.0f);
+  std::uniform_real_distribution<float> height(0.0f, 3.0f);
+  const MutablePointCloudView<PointXYZI> view(cloud);
+  for (std::size_t i = 0; i < count; ++i) {
+    PointXYZI point{uniform(rng), uniform(rng), i % 3 == 0 ? 0.0f : height(rng), static_cast<float>(i % 256)};
+    if (i % 20 == 0) {
+      point.y = std::numeric_limits<float>::quiet_NaN();
+    }
+    view.Set(i, point);
+  }
+  return cloud;
+}
+
+// Baseline field access: look the field up by name and decode its datatype for every point
+float read_field(const PointCloud2& cloud, std::size_t index, const std::string& name) {
+  for (const auto& field : cloud.fields) {
+    if (field.name != name) {
+      continue;
+    }
+    const uint8_t* p = cloud.data.data() + index * cloud.point_step + field.offset;
+    switch (static_cast<PointFieldType>(field.datatype)) {
+      case PointFieldType::FLOAT32: {
+        float value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+      }
+      case PointFieldType::FLOAT64: {
+        double value;
+        std::memcpy(&value, p, sizeof(value));
+        return static_cast<float>(value);
+      }
+      default:
+        return std::numeric_limits<float>::quiet_NaN();
+    }
+  }
+  return std::numeric_limits<float>::quiet_NaN();
+}
+
+// Baseline crop / NaN removal on top of read_field
+std::size_t generic_filter(const PointCloud2& in, const CropBox& box, PointCloud2& out) {
+  const std::size_t count = static_cast<std::size_t>(in.width) * in.height;
+  out.data.resize(in.data.size());
+  std::size_t kept = 0;
+  for (std::size_t i = 0; i < count; ++i) {
+    const float x = read_field(in, i, "x");
+    const float y = read_field(in, i, "y");
+    const float z = read_field(in, i, "z");
+    if (std::isnan(x) || std::isnan(y) || std::isnan(z)) {
+      continue;
+    }
+    const bool inside = x >= box.min[0] && x <= box.max[0] && y >= box.min[1] && y <= box.max[1] && z >= box.min[2] &&
+                        z <= box.max[2];
+    if (inside != box.negative) {
+      std::memcpy(out.data.data() + kept * in.point_step, in.data.data() + i * in.point_step, in.point_step);
+      ++kept;
+    }
+  }
+  out.data.resize(kept * in.point_step);
+  return kept;
+}
+
+template <typename F>
+double time_us(int rounds, F&& f) {
+  const auto start = Clock::now();
+  for (int n = 0; n < rounds; ++n) {
+    f();
+  }
+  return std::chrono::duration<double, std::micro>(Clock::now() - start).count() / rounds;
+}
+
+int main(int argc, char* argv[]) {
+  const std::size_t points = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+  const int rounds = argc > 2 ? std::atoi(argv[2]) : 50;
+
+  const PointCloud2 cloud = make_cloud(points);
+  const double mpts = static_cast<double>(points) / 1e6;
+  std::cout << "points: " << points << ", point_step: " << cloud.point_step << ", rounds: " << rounds << std::endl;
+
+  // Field access
+  double sum_generic = 0.0;
+  const double generic_read_us = time_us(rounds, [&] {
+    for (std::size_t i = 0; i < points; ++i) {
+      sum_generic += read_field(cloud, i, "x") + read_field(cloud, i, "intensity");
+    }
+  });
+  double sum_view = 0.0;
+  const double view_read_us = time_us(rounds, [&] {
+    for (const PointXYZI& point : PointCloudView<PointXYZI>(cloud)) {
+      sum_view += point.x + point.intensity;
+    }
+  });
+  std::cout << "read x+intensity   generic: " << mpts / generic_read_us * 1e6 << " Mpts/s, view: "
+            << mpts / view_read_us * 1e6 << " Mpts/s (" << generic_read_us / view_read_us << "x)" << std::endl;
+
+  // NaN removal
+  PointCloud2 out_generic;
+  PointCloud2 out_fast;
+  std::size_t kept_generic = 0;
+  const double generic_nan_us = time_us(rounds, [&] { kept_generic = generic_filter(cloud, CropBox(), out_generic); });
+  const double fast_nan_us = time_us(rounds, [&] { RemoveNaNPoints<PointXYZI>(cloud, out_fast); });
+  std::cout << "remove NaN         generic: " << mpts / generic_nan_us * 1e6 << " Mpts/s, SIMD: "
+            << mpts / fast_nan_us * 1e6 << " Mpts/s (" << generic_nan_us / fast_nan_us << "x), kept " << out_fast.width
+            << (out_fast.data == out_generic.data && kept_generic == static_cast<std::size_t>(out_fast.width) ? " [match]" : " [MISMATCH]")
+            << std::endl;
+
+  // Crop box
+  CropBox box;
+  box.min = {-5.0f, -5.0f, 0.1f};
+  box.max = {5.0f, 5.0f, 2.0f};
+  const double generic_crop_us = time_us(rounds, [&] { kept_generic = generic_filter(cloud, box, out_generic); });
+  const double fast_crop_us = time_us(rounds, [&] { CropPointCloud<PointXYZI>(cloud, box, out_fast); });
+  std::cout << "crop box           generic: " << mpts / generic_crop_us * 1e6 << " Mpts/s, SIMD: "
+            << mpts / fast_crop_us * 1e6 << " Mpts/s (" << generic_crop_us / fast_crop_us << "x), kept " << out_fast.width
+            << (out_fast.data == out_generic.data && kept_generic == static_cast<std::size_t>(out_fast.width) ? " [match]" : " [MISMATCH]")
+            << std::endl;
+
+  // Voxel grid
+  for (const float leaf : {0.05f, 0.2f, 1.0f}) {
+    VoxelGridOptions options;
+    options.leaf_size = leaf;
+    VoxelGridFilter<PointXYZI> voxel(options);
+    const double voxel_us = time_us(rounds, [&] { voxel.Apply(cloud, out_fast); });
+    std::cout << "voxel grid " << leaf << " m: " << mpts / voxel_us * 1e6 << " Mpts/s, " << voxel_us / 1000.0
+              << " ms/cloud, " << out_fast.width << " voxels" << std::endl;
+  }
+
+  std::cout << "checksums: " << sum_generic << " / " << sum_view << std::endl;
+  return 0;
+}
@@ -0,0 +1,160 @@
+#include "magic_control_loop.h"
+#include "magic_motion_realtime.h"
+#include "magic_sdk_version.h"
+#include "magic_virtual_robot.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <thread>
+#include <vector>
+
+using namespace magic::dog;
+using namespace magic::dog::motion;
+
+// Heap allocations made by threads that set g_count_allocations (kept out of line so the compiler does not pair
+// the inlined malloc/free with new/delete)
+thread_local bool g_count_allocations = false;
+std::atomic<uint64_t> g_allocations{0};
+
+[[gnu::noinline]] void* operator new(std::size_t size) {
+  if (g_count_allocations) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+  }
+  if (void* p = std::malloc(size == 0 ? 1 : size)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+[[gnu::noinline]] void operator delete(void* p) noexcept { std::free(p); }
+[[gnu::noinline]] void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+// Stand-in transport: serialize into a fresh message buffer, as a socket-backed publisher does, and deliver the
+// command to the virtual robot
+Status send_to_transport(sim::VirtualRobot& robot, const LegJointCommand& command) {
+  std::vector<uint8_t> message(kLegJointCommandWireSize);
+  LegJointCommandWire wire;
+  SerializeLegJointCommand(command, wire);
+  std::memcpy(message.data(), wire.data(), wire.size());
+  static volatile uint8_t last_byte;
+  last_byte = message.back();
+  (void)last_byte;
+  return robot.PublishLegCommand(command);
+}
+
+void fill_command(uint64_t cycle, LegJointCommand& command) {
+  command.timestamp = SteadyNowNs();
+  for (std::size_t i = 0; i < kLegJointNum; ++i) {
+    command.cmd[i].q_des = 0.01 * static_cast<double>((cycle + i) % 100);
+    command.cmd[i].dq_des = 0.0;
+    command.cmd[i].tau_des = 0.0;
+    command.cmd[i].kp = 50.0;
+    command.cmd[i].kd = 0.5;
+  }
+}
+
+void print_summary(const char* name, const LatencyHistogram& histogram, uint64_t allocations) {
+  const LatencySummary s = Summarize(histogram);
+  std::cout << name << "calls " << s.count << ", mallocs " << allocations << ", p50 " << s.p50 << " ns, p99 " << s.p99
+            << " ns, p99.9 " << s.p999 << " ns, max " << s.max << " ns" << std::endl;
+}
+
+// Run `publish` once per cycle on a ControlLoop thread, timing every call and counting its heap allocations
+template <typename F>
+bool run(uint64_t cycles, const ControlLoopOptions& options, LatencyHistogram& latency, uint64_t& allocations, F&& publish) {
+  ControlLoop loop(options);
+  LegJointCommand command;
+  std::atomic<bool> done{false};
+  g_allocations = 0;
+  const Status status = loop.Start([&](uint64_t cycle) {
+    if (cycle >= cycles) {
+      done = true;
+      loop.Stop();
+      return;
+    }
+    fill_command(cycle, command);
+    g_count_allocations = true;
+    const int64_t start = SteadyNowNs();
+    publish(command);
+    const int64_t elapsed = SteadyNowNs() - start;
+    g_count_allocations = false;
+    latency.Record(elapsed);
+  });
+  if (status.code != ErrorCode::OK) {
+    std::cerr << "ControlLoop start failed: " << status.message << std::endl;
+    return false;
+  }
+  while (!done) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  loop.Stop();
+  allocations = g_allocations;
+  return true;
+}
+
+int main(int argc, char* argv[]) {
+  const uint64_t cycles = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 5000;
+  const int rate_hz = argc > 2 ? std::atoi(argv[2]) : 500;
+  const int rt_priority = argc > 3 ? std::atoi(argv[3]) : 0;
+
+  ControlLoopOptions options;
+  options.period = std::chrono::nanoseconds(1000000000LL / std::max(rate_hz, 1));
+  options.rt_priority = rt_priority;
+  options.lock_memory = rt_priority > 0;
+  std::cout << "cycles: " << cycles << ", rate: " << rate_hz << " Hz, SCHED_FIFO priority: " << rt_priority << std::endl;
+
+  // Command sink: the in-process robot stand-in, with only the leg state stream running
+  sim::VirtualRobotOptions robot_options;
+  robot_options.imu_rate_hz = 0;
+  robot_options.odometry_rate_hz = 0;
+  robot_options.laser_scan_rate_hz = 0;
+  robot_options.image_rate_hz = 0;
+  robot_options.audio_rate_hz = 0;
+  robot_options.nav_rate_hz = 0;
+  sim::VirtualRobot robot(robot_options);
+  robot.Initialize();
+  const auto transport = [&robot](const LegJointCommand& command) { return send_to_transport(robot, command); };
+  uint64_t expected_commands = 0;
+
+  // Baseline: Status-returning transport call on the control thread
+  LatencyHistogram direct_latency;
+  uint64_t direct_allocations = 0;
+  if (!run(cycles, options, direct_latency, direct_allocations, [&](const LegJointCommand& command) { transport(command); })) {
+    return 1;
+  }
+  expected_commands += direct_latency.Count();
+
+  // Real-time publish mode: the same transport runs on the publisher's sender thread, polling (default) or woken on publish
+  uint64_t rt_allocations = 0;
+  print_summary("direct send:             ", direct_latency, direct_allocations);
+  for (const int64_t poll_us : {200, 0}) {
+    RealtimePublisherOptions publisher_options;
+    publisher_options.poll_interval = std::chrono::microseconds(poll_us);
+    RealtimeLegCommandPublisher publisher(transport, publisher_options);
+    publisher.Start();
+    LatencyHistogram latency;
+    uint64_t allocations = 0;
+    if (!run(cycles, options, latency, allocations, [&](const LegJointCommand& command) { publisher.Publish(command); })) {
+      return 1;
+    }
+    publisher.Stop();
+    rt_allocations += allocations;
+    expected_commands += publisher.GetStats().sent;
+    print_summary(poll_us == 0 ? "publisher, wake sender:  " : "publisher, poll 200 us:  ", latency, allocations);
+    const RealtimePublisherStats stats = publisher.GetStats();
+    std::cout << "  published " << stats.published << ", dropped " << stats.dropped << ", sent " << stats.sent
+              << ", send failures " << stats.send_failures << std::endl;
+  }
+  robot.Shutdown();
+  const bool delivered = robot.GetCommandCount() == expected_commands;
+  std::cout << "virtual robot received " << robot.GetCommandCount() << "/" << expected_commands << " commands"
+            << (delivered ? " [ok]" : " [FAIL]") << std::endl;
+  std::cout << (rt_allocations == 0 ? "zero heap allocations in Publish() [ok]" : "heap allocations in Publish() [FAIL]")
+            << std::endl;
+  return rt_allocations == 0 && delivered ? 0 : 1;
+}
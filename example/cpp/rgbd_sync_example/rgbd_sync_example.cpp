@@ -0,0 +1,97 @@
+#include "magic_realtime.h"
+#include "magic_rgbd_sync.h"
+#include "magic_sdk_version.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace magic::dog;
+using namespace magic::dog::sensor;
+
+constexpr std::size_t kStreams = 4;        // Color, depth, color info, depth info
+constexpr std::size_t kFrameHistory = 256;  // Frames whose arrival times are kept
+
+// Arrival time of each stream's message per frame, to measure the delay the synchronizer adds
+std::array<std::array<std::atomic<int64_t>, kStreams>, kFrameHistory> g_arrival{};
+
+int main(int argc, char* argv[]) {
+  const int seconds = argc > 1 ? std::atoi(argv[1]) : 5;
+  const double rate_hz = argc > 2 ? std::atof(argv[2]) : 30.0;
+  const int depth_drop_percent = argc > 3 ? std::atoi(argv[3]) : 2;
+  const int64_t period_ns = static_cast<int64_t>(1e9 / rate_hz);
+  const int64_t frames = static_cast<int64_t>(seconds * rate_hz);
+  const int64_t start_ns = SteadyNowNs() + 100000000;
+
+  LatencyHistogram sync_latency;  // Last member arrival -> bundle callback
+  LatencyHistogram bundle_age;    // Color stamp -> bundle callback
+  int64_t max_skew_ns = 0;
+  RgbdSyncOptions options;
+  options.tolerance_ns = period_ns / 3;
+  RgbdSynchronizer sync(
+      [&](const RgbdBundle& bundle) {
+        const int64_t now = SteadyNowNs();
+        const std::size_t frame = static_cast<std::size_t>((bundle.stamp - start_ns + period_ns / 2) / period_ns) % kFrameHistory;
+        int64_t last_arrival = 0;
+        for (const auto& arrival : g_arrival[frame]) {
+          last_arrival = std::max(last_arrival, arrival.load(std::memory_order_relaxed));
+        }
+        sync_latency.Record(now - last_arrival);
+        bundle_age.Record(now - bundle.stamp);
+        max_skew_ns = std::max(max_skew_ns, bundle.max_skew_ns);
+      },
+      options);
+
+  // One thread per stream: message k is captured at start + k * period (+/- jitter) and delivered 1-5 ms later
+  auto run_stream = [&](std::size_t stream, int64_t jitter_ns, int drop_percent) {
+    std::mt19937 rng(static_cast<uint32_t>(stream + 1));
+    std::uniform_int_distribution<int64_t> jitter(-jitter_ns, jitter_ns);
+    std::uniform_int_distribution<int64_t> delay(1000000, 5000000);
+    std::uniform_int_distribution<int> percent(0, 99);
+    for (int64_t k = 0; k < frames; ++k) {
+      const int64_t stamp = start_ns + k * period_ns + jitter(rng);
+      const int64_t arrival = std::max(stamp, start_ns + k * period_ns) + delay(rng);
+      std::this_thread::sleep_for(std::chrono::nanoseconds(arrival - SteadyNowNs()));
+      if (percent(rng) < drop_percent) {
+        continue;
+      }
+      g_arrival[k % kFrameHistory][stream].store(SteadyNowNs(), std::memory_order_relaxed);
+      if (stream < 2) {
+        auto image = std::make_shared<Image>();
+        image->header.stamp = stamp;
+        stream == 0 ? sync.AddColor(image) : sync.AddDepth(image);
+      } else {
+        auto info = std::make_shared<CameraInfo>();
+        info->header.stamp = stamp;
+        stream == 2 ? sync.AddColorInfo(info) : sync.AddDepthInfo(info);
+      }
+    }
+  };
+  std::vector<std::thread> threads;
+  threads.emplace_back(run_stream, 0, 0, 0);
+  threads.emplace_back(run_stream, 1, 2000000, depth_drop_percent);
+  threads.emplace_back(run_stream, 2, 0, 0);
+  threads.emplace_back(run_stream, 3, 2000000, 0);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  const LatencySummary added = Summarize(sync_latency);
+  const LatencySummary age = Summarize(bundle_age);
+  std::cout << "frames: " << frames << " at " << rate_hz << " Hz, tolerance " << options.tolerance_ns / 1e6 << " ms, depth drop "
+            << depth_drop_percent << "%" << std::endl;
+  std::cout << "bundles: " << sync.GetBundleCount() << ", unmatched: " << sync.GetUnmatchedCount()
+            << ", overflow: " << sync.GetOverflowCount() << ", max skew " << max_skew_ns / 1e6 << " ms" << std::endl;
+  std::cout << "added latency (last member -> callback): p50 " << added.p50 / 1000.0 << " us, p99 " << added.p99 / 1000.0
+            << " us, max " << added.max / 1000.0 << " us" << std::endl;
+  std::cout << "bundle age (color stamp -> callback):    p50 " << age.p50 / 1e6 << " ms, p99 " << age.p99 / 1e6 << " ms, max "
+            << age.max / 1e6 << " ms" << std::endl;
+  return 0;
+}
@@ -0,0 +1,338 @@
+#include "magic_realtime.h"
+#include "magic_sdk_version.h"
+#include "magic_shm_transport.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace magic::dog;
+
+constexpr int32_t kImageWidth = 640;
+constexpr int32_t kImageHeight = 480;
+constexpr std::size_t kImageBytes = static_cast<std::size_t>(kImageWidth) * kImageHeight * 3;
+constexpr std::size_t kUdpChunk = 60000;  // Payload bytes per datagram, as LCM fragments large messages
+
+struct LegMessage {
+  int64_t send_ns;
+  uint64_t seq;
+  LegState state;
+};
+
+struct UdpFragment {
+  uint64_t frame;
+  int64_t send_ns;
+  uint32_t offset;
+  uint32_t total;
+};
+
+// Reader-side statistics, printed by the reader process
+struct ReaderStats {
+  LatencyHistogram latency;
+  uint64_t received = 0;
+  uint64_t dropped = 0;
+  int64_t first_send_ns = 0;
+  int64_t last_receive_ns = 0;
+  uint64_t checksum = 0;
+
+  void Print(const char* name, uint64_t sent, std::size_t bytes_per_message) const {
+    const LatencySummary s = Summarize(latency);
+    std::cout << name << "received " << received << "/" << sent << ", dropped " << dropped << ", latency p50 "
+              << s.p50 / 1000.0 << " us, p99 " << s.p99 / 1000.0 << " us, p99.9 " << s.p999 / 1000.0 << " us";
+    if (bytes_per_message > 0 && last_receive_ns > first_send_ns) {
+      const double seconds = static_cast<double>(last_receive_ns - first_send_ns) / 1e9;
+      std::cout << ", " << received / seconds << " msg/s, " << received * bytes_per_message / seconds / 1e6 << " MB/s";
+    }
+    std::cout << std::endl;
+  }
+
+  void Record(int64_t send_ns) {
+    const int64_t now = SteadyNowNs();
+    if (received == 0) {
+      first_send_ns = send_ns;
+    }
+    latency.Record(now - send_ns);
+    last_receive_ns = now;
+    ++received;
+  }
+};
+
+// Touch every cache line of a payload, as a consumer parsing it would
+uint64_t touch(const uint8_t* data, std::size_t size) {
+  uint64_t sum = 0;
+  for (std::size_t i = 0; i < size; i += 64) {
+    sum += data[i];
+  }
+  return sum;
+}
+
+// Run reader(ready_fd) in a forked process; returns after the reader signalled readiness through the pipe
+template <typename Reader>
+pid_t spawn_reader(Reader&& reader, int32_t& ready_value) {
+  int fds[2];
+  if (pipe(fds) != 0) {
+    return -1;
+  }
+  const pid_t pid = fork();
+  if (pid == 0) {
+    close(fds[0]);
+    const int code = reader(fds[1]);
+    std::cout.flush();
+    _exit(code);
+  }
+  close(fds[1]);
+  if (read(fds[0], &ready_value, sizeof(ready_value)) != sizeof(ready_value)) {
+    ready_value = -1;
+  }
+  close(fds[0]);
+  return pid;
+}
+
+void signal_ready(int fd, int32_t value) {
+  if (write(fd, &value, sizeof(value)) != sizeof(value)) {
+    _exit(1);
+  }
+  close(fd);
+}
+
+int wait_reader(pid_t pid) {
+  int status = 0;
+  waitpid(pid, &status, 0);
+  return WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+}
+
+int udp_receiver(int& port) {
+  const int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  const int buffer = 8 << 20;
+  setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &buffer, sizeof(buffer));
+  timeval timeout{1, 0};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+  socklen_t length = sizeof(address);
+  getsockname(fd, reinterpret_cast<sockaddr*>(&address), &length);
+  port = ntohs(address.sin_port);
+  return fd;
+}
+
+int udp_sender(int port) {
+  const int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  const int buffer = 8 << 20;
+  setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &buffer, sizeof(buffer));
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = htons(static_cast<uint16_t>(port));
+  connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+  return fd;
+}
+
+// Send `count` leg states at rate_hz through `send`
+template <typename Send>
+void send_leg_states(uint64_t count, int rate_hz, Send&& send) {
+  LegMessage message{};
+  const auto period = std::chrono::nanoseconds(1000000000LL / std::max(rate_hz, 1));
+  auto next = std::chrono::steady_clock::now();
+  for (uint64_t i = 0; i < count; ++i) {
+    next += period;
+    std::this_thread::sleep_until(next);
+    message.seq = i;
+    message.send_ns = SteadyNowNs();
+    send(message);
+  }
+}
+
+int main(int argc, char* argv[]) {
+  const uint64_t leg_messages = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 5000;
+  const int leg_rate_hz = argc > 2 ? std::atoi(argv[2]) : 1000;
+  const uint64_t images = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 300;
+  const std::string prefix = "/magicdog_shm_bench_" + std::to_string(getpid());
+  std::cout << "LegState: " << leg_messages << " at " << leg_rate_hz << " Hz (" << sizeof(LegMessage)
+            << " bytes); images: " << images << " x " << kImageWidth << "x" << kImageHeight << " rgb8 back-to-back"
+            << std::endl;
+  int32_t ready = 0;
+
+  // LegState over shared memory
+  {
+    shm::ShmTopicWriter writer;
+    shm::ShmTopicOptions options;
+    options.name = prefix + "_leg";
+    options.slot_count = 64;
+    options.slot_size = sizeof(LegMessage);
+    const Status status = writer.Create(options);
+    if (status.code != ErrorCode::OK) {
+      std::cerr << status.message << std::endl;
+      return 1;
+    }
+    const pid_t pid = spawn_reader(
+        [&](int ready_fd) {
+          shm::ShmTopicReader reader;
+          if (reader.Open(options.name).code != ErrorCode::OK) {
+            return 1;
+          }
+          signal_ready(ready_fd, 0);
+          ReaderStats stats;
+          LegMessage message{};
+          // Sequential reads, so every message counts as delivered or dropped as with UDP
+          while (message.seq + 1 < leg_messages && reader.WaitForData(1000)) {
+            while (shm::ReadNextMessage(reader, message)) {
+              stats.Record(message.send_ns);
+            }
+          }
+          stats.dropped = leg_messages - stats.received;
+          stats.Print("shm LegState:        ", leg_messages, 0);
+          return 0;
+        },
+        ready);
+    send_leg_states(leg_messages, leg_rate_hz, [&](const LegMessage& message) { shm::WriteMessage(writer, message); });
+    wait_reader(pid);
+    writer.Unlink();
+  }
+
+  // LegState over UDP loopback
+  {
+    const pid_t pid = spawn_reader(
+        [&](int ready_fd) {
+          int port = 0;
+          const int fd = udp_receiver(port);
+          signal_ready(ready_fd, port);
+          ReaderStats stats;
+          LegMessage message{};
+          while (message.seq + 1 < leg_messages && recv(fd, &message, sizeof(message), 0) == sizeof(message)) {
+            stats.Record(message.send_ns);
+          }
+          stats.dropped = leg_messages - stats.received;
+          stats.Print("UDP LegState:        ", leg_messages, 0);
+          close(fd);
+          return 0;
+        },
+        ready);
+    const int fd = udp_sender(ready);
+    send_leg_states(leg_messages, leg_rate_hz, [&](const LegMessage& message) { send(fd, &message, sizeof(message), 0); });
+    wait_reader(pid);
+    close(fd);
+  }
+
+  Image image{};
+  image.width = kImageWidth;
+  image.height = kImageHeight;
+  image.step = kImageWidth * 3;
+  image.encoding = "rgb8";
+  image.data.assign(kImageBytes, 0x5A);
+
+  // Images over shared memory, read in place
+  {
+    shm::ShmTopicWriter writer;
+    shm::ShmTopicOptions options;
+    options.name = prefix + "_image";
+    options.slot_count = 4;
+    options.slot_size = shm::ShmImageSlotSize(kImageWidth, kImageHeight, 3);
+    const Status status = writer.Create(options);
+    if (status.code != ErrorCode::OK) {
+      std::cerr << status.message << std::endl;
+      return 1;
+    }
+    const pid_t pid = spawn_reader(
+        [&](int ready_fd) {
+          shm::ShmTopicReader reader;
+          if (reader.Open(options.name).code != ErrorCode::OK) {
+            return 1;
+          }
+          signal_ready(ready_fd, 0);
+          ReaderStats stats;
+          uint64_t last = 0;
+          int64_t stamp = 0;
+          uint64_t frame = 0;
+          const auto visit = [&](const shm::ShmImageView& view) {
+            stats.checksum += touch(view.data, view.header->data_size);
+            stamp = view.header->stamp;
+            frame = std::strtoull(view.header->frame_id, nullptr, 10);
+          };
+          while (last + 1 < images && reader.WaitForData(1000)) {
+            while (shm::ReadNextImage(reader, visit)) {
+              stats.Record(stamp);
+              last = frame;
+            }
+          }
+          stats.dropped = images - stats.received;
+          stats.Print("shm image:           ", images, kImageBytes);
+          return 0;
+        },
+        ready);
+    for (uint64_t i = 0; i < images; ++i) {
+      image.header.frame_id = std::to_string(i);
+      image.header.stamp = SteadyNowNs();
+      shm::WriteImage(writer, image);
+    }
+    wait_reader(pid);
+    writer.Unlink();
+  }
+
+  // Images over UDP loopback, fragmented and reassembled
+  {
+    const pid_t pid = spawn_reader(
+        [&](int ready_fd) {
+          int port = 0;
+          const int fd = udp_receiver(port);
+          signal_ready(ready_fd, port);
+          ReaderStats stats;
+          std::vector<uint8_t> datagram(sizeof(UdpFragment) + kUdpChunk);
+          std::vector<uint8_t> frame(kImageBytes);
+          uint64_t current = 0;
+          std::size_t filled = 0;
+          uint64_t last = 0;
+          while (last + 1 < images) {
+            const ssize_t size = recv(fd, datagram.data(), datagram.size(), 0);
+            if (size < static_cast<ssize_t>(sizeof(UdpFragment))) {
+              break;
+            }
+            UdpFragment fragment;
+            std::memcpy(&fragment, datagram.data(), sizeof(fragment));
+            if (fragment.frame != current) {
+              current = fragment.frame;
+              filled = 0;
+            }
+            const std::size_t chunk = static_cast<std::size_t>(size) - sizeof(UdpFragment);
+            std::memcpy(frame.data() + fragment.offset, datagram.data() + sizeof(UdpFragment), chunk);
+            filled += chunk;
+            if (filled == fragment.total) {
+              stats.checksum += touch(frame.data(), frame.size());
+              stats.Record(fragment.send_ns);
+              last = fragment.frame;
+            }
+          }
+          stats.dropped = images - stats.received;
+          stats.Print("UDP image:           ", images, kImageBytes);
+          close(fd);
+          return 0;
+        },
+        ready);
+    const int fd = udp_sender(ready);
+    std::vector<uint8_t> datagram(sizeof(UdpFragment) + kUdpChunk);
+    for (uint64_t i = 0; i < images; ++i) {
+      UdpFragment fragment{i, SteadyNowNs(), 0, static_cast<uint32_t>(kImageBytes)};
+      for (std::size_t offset = 0; offset < kImageBytes; offset += kUdpChunk) {
+        const std::size_t chunk = std::min(kUdpChunk, kImageBytes - offset);
+        fragment.offset = static_cast<uint32_t>(offset);
+        std::memcpy(datagram.data(), &fragment, sizeof(fragment));
+        std::memcpy(datagram.data() + sizeof(fragment), image.data.data() + offset, chunk);
+        send(fd, datagram.data(), sizeof(fragment) + chunk, 0);
+      }
+    }
+    wait_reader(pid);
+    close(fd);
+  }
+  return 0;
+}
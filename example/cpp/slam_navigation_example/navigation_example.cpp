@@ -1,3 +1,5 @@
+#include "magic_gait_watcher.h"
+#include "magic_nav_watcher.h"
 #include "magic_robot.h"
 #include "magic_sdk_version.h"
 
@@ -23,6 +25,10 @@ std::atomic<bool> running(true);
 std::string current_slam_mode = "IDLE";
 NavMode current_nav_mode = NavMode::IDLE;
 int odometry_counter = 0;
+std::unique_ptr<motion::GaitWatcher> gaitWatcher = nullptr;
+std::unique_ptr<slam::NavStatusWatcher> navWatcher = nullptr;
+std::atomic<int32_t> navTargetId(0);  // ID of the last target sent, 0 once result reporting stops
+std::thread navResultThread;           // Reports the result of the last target
 
 void signalHandler(int signum) {
   std::cout << "Interrupt signal (" << signum << ") received.\n";
@@ -177,6 +183,39 @@ void switchToNavigationMode() {
   }
 }
 
+// Stop reporting the previous target's result
+void stopNavResultReport() {
+  navTargetId = 0;
+  if (navResultThread.joinable()) {
+    navResultThread.join();
+  }
+}
+
+// Print the end of a navigation task without polling GetNavTaskStatus
+void startNavResultReport(int32_t targetId, const slam::NavResultMark& mark) {
+  stopNavResultReport();
+  navTargetId = targetId;
+  navResultThread = std::thread([targetId, mark] {
+    // Wait in slices with the same mark, until the result arrives or another target replaces this one
+    while (navTargetId.load() == targetId) {
+      NavStatus result;
+      auto status = navWatcher->WaitForNavResult(targetId, result, 500, mark);
+      if (status.code == ErrorCode::TIMEOUT) {
+        continue;
+      }
+      if (status.code != ErrorCode::OK) {
+        std::cerr << "Failed to wait for navigation result: " << status.message << std::endl;
+      } else if (result.status == NavStatusType::END_SUCCESS) {
+        std::cout << "Navigation target " << targetId << " reached" << std::endl;
+      } else {
+        std::cout << "Navigation target " << targetId << " ended, status: " << static_cast<int>(result.status)
+                  << ", message: " << result.message << std::endl;
+      }
+      break;
+    }
+  });
+}
+
 void setNavigationTarget(double x, double y, double yaw) {
   try {
     // Get SLAM navigation controller
@@ -194,16 +233,26 @@ void setNavigationTarget(double x, double y, double yaw) {
       std::cerr << "Failed to set gait to slow: " << status.message << std::endl;
       return;
     }
+
+    // Wait for gait switch to complete
+    status = gaitWatcher->WaitForGait(GaitMode::GAIT_DOWN_CLIMB_STAIRS);
+    if (status.code != ErrorCode::OK) {
+      std::cerr << "Failed to wait for gait transition: " << status.message << std::endl;
+      return;
+    }
     std::cout << "Successfully set gait to slow" << std::endl;
 
-    // Create target goal
+    // Create target goal, each target gets a new ID
     NavTarget targetGoal;
-    targetGoal.id = 1;
+    targetGoal.id = navTargetId.load() + 1;
     targetGoal.frame_id = "map";
 
     targetGoal.goal.position = {x, y, 0.0};
     targetGoal.goal.orientation = {0.0, 0.0, yaw};
 
+    // Mark the status stream before sending, so that only this task's end is reported
+    const slam::NavResultMark mark = navWatcher->MarkNavResult();
+
     // Set target goal
     status = controller.SetNavTarget(targetGoal);
     if (status.code != ErrorCode::OK) {
@@ -211,6 +260,7 @@ void setNavigationTarget(double x, double y, double yaw) {
                 << ", message: " << status.message << std::endl;
       return;
     }
+    startNavResultReport(targetGoal.id, mark);
 
     std::cout << "Successfully set navigation target: position=("
               << targetGoal.goal.position[0] << ", " << targetGoal.goal.position[1] << ", "
@@ -507,6 +557,12 @@ int main(int argc, char* argv[]) {
 
     std::cout << "Successfully initialized SLAM navigation controller" << std::endl;
 
+    // Shared watchers, query the gait and navigation status only while a transition or result is awaited
+    gaitWatcher = std::make_unique<motion::GaitWatcher>(robot->GetHighLevelMotionController());
+    gaitWatcher->Start();
+    navWatcher = std::make_unique<slam::NavStatusWatcher>(slamNavController);
+    navWatcher->Start();
+
     // Main loop
     while (running.load()) {
       try {
@@ -623,6 +679,9 @@ int main(int argc, char* argv[]) {
   // Clean up resources
   try {
     std::cout << "Clean up resources" << std::endl;
+    stopNavResultReport();
+    navWatcher.reset();
+    gaitWatcher.reset();
 
     // Close SLAM navigation controller
     auto& slamNavController = robot->GetSlamNavController();
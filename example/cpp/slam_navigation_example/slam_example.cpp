@@ -1,3 +1,4 @@
+#include "magic_gait_watcher.h"
 #include "magic_robot.h"
 #include "magic_sdk_version.h"
 
@@ -22,6 +23,7 @@ using namespace std;
 
 // Global variables
 std::unique_ptr<MagicRobot> robot = nullptr;
+std::unique_ptr<motion::GaitWatcher> gaitWatcher = nullptr;
 std::atomic<bool> running(true);
 std::string current_slam_mode = "IDLE";
 NavMode current_nav_mode = NavMode::IDLE;
@@ -266,14 +268,10 @@ bool changeGaitToDownClimbStairs() {
       }
 
       // Wait for gait switch to complete
-      while (currentGait != GaitMode::GAIT_DOWN_CLIMB_STAIRS) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
-        status = highController.GetGait(currentGait);
-        if (status.code != ErrorCode::OK) {
-          std::cerr << "Failed to get gait during transition: " << status.message << std::endl;
-          return false;
-        }
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      status = gaitWatcher->WaitForGait(GaitMode::GAIT_DOWN_CLIMB_STAIRS);
+      if (status.code != ErrorCode::OK) {
+        std::cerr << "Failed to wait for gait transition: " << status.message << std::endl;
+        return false;
       }
     }
 
@@ -376,6 +374,10 @@ int main(int argc, char* argv[]) {
       return -1;
     }
 
+    // Shared gait watcher, queries the gait only while a transition is awaited
+    gaitWatcher = std::make_unique<motion::GaitWatcher>(robot->GetHighLevelMotionController());
+    gaitWatcher->Start();
+
     // Initialize SLAM navigation controller
     auto& slamNavController = robot->GetSlamNavController();
     if (!slamNavController.Initialize()) {
@@ -510,6 +512,7 @@ int main(int argc, char* argv[]) {
   // Clean up resources
   try {
     std::cout << "Clean up resources" << std::endl;
+    gaitWatcher.reset();
 
     // Close SLAM navigation controller
     auto& slamNavController = robot->GetSlamNavController();
@@ -0,0 +1,374 @@
+#pragma once
+
+#include "magic_audio.h"
+#include "magic_dispatch.h"
+#include "magic_display.h"
+#include "magic_motion.h"
+#include "magic_slam_navigation.h"
+#include "magic_type.h"
+
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace magic::dog {
+
+/************************************************************
+ *                       Async RPC core                     *
+ ************************************************************/
+
+/**
+ * @brief Status and output value of an RPC with an output parameter.
+ */
+template <typename T>
+struct RpcResult {
+  Status status{ErrorCode::OK, ""};  ///< RPC status
+  T value{};                         ///< Output value, valid when status.code is OK
+};
+
+/// Completion callback, called on an executor thread before the future becomes ready.
+template <typename R>
+using RpcCompletion = std::function<void(const R&)>;
+
+/**
+ * @class AsyncRpcExecutor
+ * @brief Runs blocking SDK RPCs on a pool of completion threads.
+ *
+ * Each call occupies one pool thread for its duration, so up to GetThreadCount() independent requests are in flight
+ * at once over the same gRPC channel instead of being serialized by the caller. The executor's queue latency and run
+ * time histograms give per-call scheduling delay and RPC latency.
+ */
+class AsyncRpcExecutor final : public NonCopyable {
+ public:
+  /**
+   * @brief Start the completion threads.
+   * @param threads Maximum number of concurrent RPCs.
+   */
+  explicit AsyncRpcExecutor(std::size_t threads = 4) : executor_(ExecutorOptions{"rpc", threads, {}, SCHED_OTHER, 0}) {}
+
+  /**
+   * @brief Run a blocking call on a completion thread.
+   * @param call Function performing the RPC.
+   * @param done Optional completion callback, called on the completion thread.
+   * @return Future for the result of call.
+   */
+  template <typename R>
+  std::future<R> Submit(std::function<R()> call, RpcCompletion<R> done = nullptr) {
+    auto promise = std::make_shared<std::promise<R>>();
+    std::future<R> future = promise->get_future();
+    executor_.Post([call = std::move(call), done = std::move(done), promise]() {
+      try {
+        R result = call();
+        if (done) {
+          done(result);
+        }
+        promise->set_value(std::move(result));
+      } catch (...) {
+        promise->set_exception(std::current_exception());
+      }
+    });
+    return future;
+  }
+
+  /// Number of completion threads.
+  std::size_t GetThreadCount() const { return executor_.GetThreadCount(); }
+
+  /// Underlying executor, for queue latency and RPC duration histograms.
+  const Executor& GetExecutor() const { return executor_; }
+
+ private:
+  Executor executor_;  // Completion threads
+};
+
+/************************************************************
+ *                  Async controller wrappers               *
+ ************************************************************/
+
+namespace motion {
+
+/**
+ * @class AsyncHighLevelMotionController
+ * @brief Future-based variants of the HighLevelMotionController RPCs.
+ *
+ * Every method returns immediately; the optional completion callback runs on the executor thread before the future
+ * becomes ready. The controller and executor must outlive all pending calls.
+ */
+class AsyncHighLevelMotionController final : public NonCopyable {
+ public:
+  AsyncHighLevelMotionController(HighLevelMotionController& controller, AsyncRpcExecutor& executor)
+      : controller_(controller), executor_(executor) {}
+
+  std::future<Status> SetGaitAsync(GaitMode gait_mode, int timeout_ms = 5000, RpcCompletion<Status> done = nullptr) {
+    return executor_.Submit<Status>([this, gait_mode, timeout_ms] { return controller_.SetGait(gait_mode, timeout_ms); }, std::move(done));
+  }
+
+  std::future<RpcResult<GaitMode>> GetGaitAsync(int timeout_ms = 5000, RpcCompletion<RpcResult<GaitMode>> done = nullptr) {
+    return executor_.Submit<RpcResult<GaitMode>>([this, timeout_ms] {
+      RpcResult<GaitMode> result;
+      result.status = controller_.GetGait(result.value, timeout_ms);
+      return result;
+    },
+                                                 std::move(done));
+  }
+
+  std::future<Status> ExecuteTrickAsync(TrickAction trick_action, int timeout_ms = 5000, RpcCompletion<Status> done = nullptr) {
+    return executor_.Submit<Status>([this, trick_action, timeout_ms] { return controller_.ExecuteTrick(trick_action, timeout_ms); }, std::move(done));
+  }
+
+  std::future<RpcResult<AllGaitSpeedRatio>> GetAllGaitSpeedRatioAsync(int timeout_ms = 5000, RpcCompletion<RpcResult<AllGaitSpeedRatio>> done = nullptr) {
+    return executor_.Submit<RpcResult<AllGaitSpeedRatio>>([this, timeout_ms] {
+      RpcResult<AllGaitSpeedRatio> result;
+      result.status = controller_.GetAllGaitSpeedRatio(result.value, timeout_ms);
+      return result;
+    },
+                                                          std::move(done));
+  }
+
+  std::future<Status> SetGaitSpeedRatioAsync(GaitMode gait_mode, const GaitSpeedRatio& gait_speed_ratio, int timeout_ms = 5000, RpcCompletion<Status> done = nullptr) {
+    return executor_.Submit<Status>([this, gait_mode, gait_speed_ratio, timeout_ms] { return controller_.SetGaitSpeedRatio(gait_mode, gait_speed_ratio, timeout_ms); }, std::move(done));
+  }
+
+  std::future<RpcResult<bool>> GetHeadMotorEnabledAsync(int timeout_ms = 5000, RpcCompletion<RpcResult<bool>> done = nullptr) {
+    return executor_.Submit<RpcResult<bool>>([this, timeout_ms] {
+      RpcResult<bool> result;
+      result.status = controller_.GetHeadMotorEnabled(result.value, timeout_ms);
+      return result;
+    },
+                                             std::move(done));
+  }
+
+  std::future<Status> EnableHeadMotorAsync(int timeout_ms = 5000, RpcCompletion<Status> done = nullptr) {
+    return executor_.Submit<Status>([this, timeout_ms] { return controller_.EnableHeadMotor(timeout_ms); }, std::move(done));
+  }
+
+  std::future<Status> DisableHeadMotorAsync(int timeout_ms = 5000, RpcCompletion<Status> done = nullptr) {
+    return executor_.Submit<Status>([this, timeout_ms] { return controller_.DisableHeadMotor(timeout_ms); }, std::move(done));
+  }
+
+  std::future<RpcResult<EulerAngles>> GetHeadPositionAsync(int timeout_ms = 5000, RpcCompletion<RpcResult<EulerAngles>> done = nullptr) {
+    return executor_.Submit<RpcResult<EulerAngles>>([this, timeout_ms] {
+      RpcResult<EulerAngles> result;
+      result.status = controller_.GetHeadPosition(result.value, timeout_ms);
+      return result;
+    },
+                                                    std::move(done));
+  }
+
+  std::future<Status> SetHeadPositionAsync(const EulerAngles& euler_angles, int timeout_ms = 5000, RpcCompletion<Status> done = nullptr) {
+    return executor_.Submit<Status>([this, euler_angles, timeout_ms] { return controller_.SetHeadPosition(euler_angles, timeout_ms); }, std::move(done));
+  }
+
+ private:
+  HighLevelMotionController& controller_;
+  AsyncRpcExecutor& executor_;
+};
+
+}  // namespace motion
+
+namespace audio {
+
+/**
+ * @class AsyncAudioController
+ * @brief Future-based variants of the AudioController RPCs, see AsyncHighLevelMotionController.
+ */
+class AsyncAudioController final : public NonCopyable {
+ public:
+  AsyncAudioController(AudioController& controller, AsyncRpcExecutor& executor)
+      : controller_(controller), executor_(executor) {}
+
+  std::future<Status> SwitchTtsVoiceModelAsync(TtsType tts_type, int timeout_ms = 5000, RpcCompletion<Status> done = nullptr) {
+    return executor_.Submit<Status>([this, tts_type, timeout_ms] { return controller_.SwitchTtsVoiceModel(tts_type, timeout_ms); }, std::move(done));
+  }
+
+  std::future<RpcResult<GetSpeechConfig>> GetVoiceConfigAsync(int timeout_ms = 5000, RpcCompletion<RpcResult<GetSpeechConfig>> done = nullptr) {
+    return executor_.Submit<RpcResult<GetSpeechConfig>>([this, timeout_ms] {
+      RpcResult<GetSpeechConfig> result;
+      result.status = controller_.GetVoiceConfig(result.value, timeout_ms);
+      return result;
+    },
+                                                        std::move(done));
+  }
+
+  std::future<Status> SetVoiceConfigAsync(const SetSpeechConfig& config, int timeout_ms = 5000, RpcCompletion<Status> done = nullptr) {
+    return executor_.Submit<Status>([this, config, timeout_ms] { return controller_.SetVoiceConfig(config, timeout_ms); }, std::move(done));
+  }
+
+  std::future<Status> PlayAsync(const TtsCommand& cmd, int timeout_ms = 5000, RpcCompletion<Status> done = nullptr) {
+    return executor_.Submit<Status>([this, cmd, timeout_ms] { return controller_.Play(cmd, timeout_ms); }, std::move(done));
+  }
+
+  std::future<Status> StopAsync(int timeout_ms = 5000, RpcCompletion<Status> done = nullptr) {
+    return executor_.Submit<Status>([this, timeout_ms] { return controller_.Stop(timeout_ms); }, std::move(done));
+  }
+
+  std::future<Status> SetVolumeAsync(int volume, int timeout_ms = 5000, RpcCompletion<Status> done = nullptr) {
+    return executor_.Submit<Status>([this, volume, timeout_ms] { return controller_.SetVolume(volume, timeout_ms); }, std::move(done));
+  }
+
+  std::future<RpcResult<int>> GetVolumeAsync(int timeout_ms = 5000, RpcCompletion<RpcResult<int>> done = nullptr) {
+    return executor_.Submit<RpcResult<int>>([this, timeout_ms] {
+      RpcResult<int> result;
+      result.status = controller_.GetVolume(result.value, timeout_ms);
+      return result;
+    },
+                                            std::move(done));
+  }
+
+  std::future<Status> ControlVoiceStreamAsync(bool enable_raw_data, bool enable_bf_data, int timeout_ms = 5000, RpcCompletion<Status> done = nullptr) {
+    return executor_.Submit<Status>([this, enable_raw_data, enable_bf_data, timeout_ms] { return controller_.ControlVoiceStream(enable_raw_data, enable_bf_data, timeout_ms); }, std::move(done));
+  }
+
+  std::future<Status> ControlSpeechIOAsync(bool enable_data, int timeout_ms = 5000, RpcCompletion<Status> done = nullptr) {
+    return executor_.Submit<Status>([this, enable_data, timeout_ms] { return controller_.ControlSpeechIO(enable_data, timeout_ms); }, std::move(done));
+  }
+
+ private:
+  AudioController& controller_;
+  AsyncRpcExecutor& executor_;
+};
+
+}  // namespace audio
+
+namespace display {
+
+/**
+ * @class AsyncDisplayController
+ * @brief Future-based variants of the DisplayController RPCs, see AsyncHighLevelMotionController.
+ */
+class AsyncDisplayController final : public NonCopyable {
+ public:
+  AsyncDisplayController(DisplayController& controller, AsyncRpcExecutor& executor)
+      : controller_(controller), executor_(executor) {}
+
+  std::future<RpcResult<std::vector<FaceExpression>>> GetAllFaceExpressionsAsync(int timeout_ms = 5000, RpcCompletion<RpcResult<std::vector<FaceExpression>>> done = nullptr) {
+    return executor_.Submit<RpcResult<std::vector<FaceExpression>>>([this, timeout_ms] {
+      RpcResult<std::vector<FaceExpression>> result;
+      result.status = controller_.GetAllFaceExpressions(result.value, timeout_ms);
+      return result;
+    },
+                                                                    std::move(done));
+  }
+
+  std::future<Status> SetFaceExpressionAsync(int expression_id, int timeout_ms = 5000, RpcCompletion<Status> done = nullptr) {
+    return executor_.Submit<Status>([this, expression_id, timeout_ms] { return controller_.SetFaceExpression(expression_id, timeout_ms); }, std::move(done));
+  }
+
+  std::future<RpcResult<FaceExpression>> GetFaceExpressionAsync(int timeout_ms = 5000, RpcCompletion<RpcResult<FaceExpression>> done = nullptr) {
+    return executor_.Submit<RpcResult<FaceExpression>>([this, timeout_ms] {
+      RpcResult<FaceExpression> result;
+      result.status = controller_.GetFaceExpression(result.value, timeout_ms);
+      return result;
+    },
+                                                       std::move(done));
+  }
+
+ private:
+  DisplayController& controller_;
+  AsyncRpcExecutor& executor_;
+};
+
+}  // namespace display
+
+namespace slam {
+
+/**
+ * @class AsyncSlamNavController
+ * @brief Future-based variants of the SlamNavController RPCs, see AsyncHighLevelMotionController.
+ */
+class AsyncSlamNavController final : public NonCopyable {
+ public:
+  AsyncSlamNavController(SlamNavController& controller, AsyncRpcExecutor& executor)
+      : controller_(controller), executor_(executor) {}
+
+  std::future<Status> SwitchToIdleAsync(RpcCompletion<Status> done = nullptr) {
+    return executor_.Submit<Status>([this] { return controller_.SwitchToIdle(); }, std::move(done));
+  }
+
+  std::future<Status> SwitchToLocationAsync(RpcCompletion<Status> done = nullptr) {
+    return executor_.Submit<Status>([this] { return controller_.SwitchToLocation(); }, std::move(done));
+  }
+
+  std::future<Status> StartMappingAsync(RpcCompletion<Status> done = nullptr) {
+    return executor_.Submit<Status>([this] { return controller_.StartMapping(); }, std::move(done));
+  }
+
+  std::future<Status> CancelMappingAsync(RpcCompletion<Status> done = nullptr) {
+    return executor_.Submit<Status>([this] { return controller_.CancelMapping(); }, std::move(done));
+  }
+
+  std::future<Status> SaveMapAsync(const std::string& map_name, RpcCompletion<Status> done = nullptr) {
+    return executor_.Submit<Status>([this, map_name] { return controller_.SaveMap(map_name); }, std::move(done));
+  }
+
+  std::future<Status> LoadMapAsync(const std::string& map_name, RpcCompletion<Status> done = nullptr) {
+    return executor_.Submit<Status>([this, map_name] { return controller_.LoadMap(map_name); }, std::move(done));
+  }
+
+  std::future<Status> DeleteMapAsync(const std::string& map_name, RpcCompletion<Status> done = nullptr) {
+    return executor_.Submit<Status>([this, map_name] { return controller_.DeleteMap(map_name); }, std::move(done));
+  }
+
+  std::future<RpcResult<AllMapInfo>> GetAllMapInfoAsync(RpcCompletion<RpcResult<AllMapInfo>> done = nullptr) {
+    return executor_.Submit<RpcResult<AllMapInfo>>([this] {
+      RpcResult<AllMapInfo> result;
+      result.status = controller_.GetAllMapInfo(result.value);
+      return result;
+    },
+                                                   std::move(done));
+  }
+
+  std::future<Status> InitPoseAsync(const Pose3DEuler& pose, RpcCompletion<Status> done = nullptr) {
+    return executor_.Submit<Status>([this, pose] { return controller_.InitPose(pose); }, std::move(done));
+  }
+
+  std::future<RpcResult<LocalizationInfo>> GetCurrentLocalizationInfoAsync(RpcCompletion<RpcResult<LocalizationInfo>> done = nullptr) {
+    return executor_.Submit<RpcResult<LocalizationInfo>>([this] {
+      RpcResult<LocalizationInfo> result;
+      result.status = controller_.GetCurrentLocalizationInfo(result.value);
+      return result;
+    },
+                                                         std::move(done));
+  }
+
+  std::future<Status> ActivateNavModeAsync(NavMode mode, RpcCompletion<Status> done = nullptr) {
+    return executor_.Submit<Status>([this, mode] { return controller_.ActivateNavMode(mode); }, std::move(done));
+  }
+
+  std::future<Status> SetNavTargetAsync(const NavTarget& goal, RpcCompletion<Status> done = nullptr) {
+    return executor_.Submit<Status>([this, goal] { return controller_.SetNavTarget(goal); }, std::move(done));
+  }
+
+  std::future<Status> PauseNavTaskAsync(RpcCompletion<Status> done = nullptr) {
+    return executor_.Submit<Status>([this] { return controller_.PauseNavTask(); }, std::move(done));
+  }
+
+  std::future<Status> ResumeNavTaskAsync(RpcCompletion<Status> done = nullptr) {
+    return executor_.Submit<Status>([this] { return controller_.ResumeNavTask(); }, std::move(done));
+  }
+
+  std::future<Status> CancelNavTaskAsync(RpcCompletion<Status> done = nullptr) {
+    return executor_.Submit<Status>([this] { return controller_.CancelNavTask(); }, std::move(done));
+  }
+
+  std::future<RpcResult<NavStatus>> GetNavTaskStatusAsync(RpcCompletion<RpcResult<NavStatus>> done = nullptr) {
+    return executor_.Submit<RpcResult<NavStatus>>([this] {
+      RpcResult<NavStatus> result;
+      result.status = controller_.GetNavTaskStatus(result.value);
+      return result;
+    },
+                                                  std::move(done));
+  }
+
+ private:
+  SlamNavController& controller_;
+  AsyncRpcExecutor& executor_;
+};
+
+}  // namespace slam
+
+}  // namespace magic::dog
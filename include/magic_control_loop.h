@@ -0,0 +1,226 @@
+#pragma once
+
+#include "magic_realtime.h"
+#include "magic_type.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <future>
+#include <string>
+#include <thread>
+#include <utility>
+
+namespace magic::dog::motion {
+
+/**
+ * @brief Options of ControlLoop.
+ */
+struct ControlLoopOptions {
+  std::chrono::nanoseconds period = std::chrono::milliseconds(2);  ///< Cycle period, 2 ms for a 500 Hz leg control loop
+  std::chrono::nanoseconds deadline{0};                            ///< Maximum step duration, 0 means one period
+  std::chrono::nanoseconds spin = std::chrono::microseconds(50);   ///< Busy-wait this tail of every sleep to cut wake-up jitter
+  int cpu = -1;                                                    ///< CPU to pin the loop thread to, -1 keeps the inherited affinity
+  int rt_priority = 0;                                             ///< SCHED_FIFO priority (1-98), 0 keeps the default scheduling policy
+  bool lock_memory = false;                                        ///< Call mlockall(MCL_CURRENT | MCL_FUTURE) before starting
+};
+
+/**
+ * @brief Counters of ControlLoop.
+ */
+struct ControlLoopStats {
+  uint64_t cycles = 0;           ///< Executed steps
+  uint64_t overruns = 0;         ///< Steps that ended after the next cycle should have started
+  uint64_t skipped_cycles = 0;   ///< Cycles dropped to realign after overruns
+  uint64_t deadline_misses = 0;  ///< Steps that took longer than ControlLoopOptions::deadline
+};
+
+/**
+ * @class ControlLoop
+ * @brief Deterministic fixed-period executor for low-level control loops.
+ *
+ * Runs a user step function every period on a dedicated thread, with optional CPU pinning, SCHED_FIFO priority,
+ * memory locking and busy-wait tail spinning. Each cycle records the wake-up jitter (actual start minus scheduled start)
+ * and the step duration into histograms, and counts overruns and deadline misses.
+ *
+ * The loop only calls the step function, so it can be driven against the real robot or against a local stand-in
+ * (e.g. LegStateMailbox::Update() and RealtimeLegCommandPublisher with a custom sink).
+ */
+class ControlLoop final : public NonCopyable {
+ public:
+  /// Step function, receives the zero-based cycle index.
+  using StepFunction = std::function<void(uint64_t cycle)>;
+
+  explicit ControlLoop(const ControlLoopOptions& options = ControlLoopOptions()) : options_(options) {}
+
+  /// Destructor, stops the loop thread.
+  ~ControlLoop() { Stop(); }
+
+  /**
+   * @brief Configure a loop thread and start running the step function.
+   * @param step Step function, called once per period on the loop thread.
+   * @return Status::OK on success. Fails if already running, or if memory locking, CPU pinning or
+   *         RT priority cannot be applied (e.g. missing rtprio or memlock limit, see "Real-time Control Loop"
+   *         in README.md).
+   */
+  Status Start(StepFunction step) {
+    if (!step || options_.period.count() <= 0) {
+      return {ErrorCode::INTERNAL_ERROR, "invalid control loop step or period"};
+    }
+    if (running_.exchange(true)) {
+      return {ErrorCode::INTERNAL_ERROR, "control loop already running"};
+    }
+    if (thread_.joinable()) {
+      thread_.join();
+    }
+    if (options_.lock_memory && mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+      running_ = false;
+      return {ErrorCode::INTERNAL_ERROR, std::string("mlockall failed: ") + std::strerror(errno)};
+    }
+    step_ = std::move(step);
+    std::promise<Status> configured;
+    auto result = configured.get_future();
+    thread_ = std::thread([this, &configured]() {
+      auto status = ConfigureCurrentThread();
+      const bool ok = status.code == ErrorCode::OK;
+      configured.set_value(std::move(status));
+      if (ok) {
+        Loop();
+      }
+    });
+    auto status = result.get();
+    if (status.code != ErrorCode::OK) {
+      running_ = false;
+      thread_.join();
+    }
+    return status;
+  }
+
+  /**
+   * @brief Stop the loop after the current step and join the loop thread.
+   *        May also be called from inside the step function, in which case it only requests the stop.
+   */
+  void Stop() {
+    running_ = false;
+    if (thread_.joinable() && thread_.get_id() != std::this_thread::get_id()) {
+      thread_.join();
+    }
+  }
+
+  /**
+   * @brief Whether the loop thread is running.
+   */
+  bool IsRunning() const { return running_.load(std::memory_order_acquire); }
+
+  /**
+   * @brief Get loop counters, safe to call from any thread.
+   */
+  ControlLoopStats GetStats() const {
+    ControlLoopStats stats;
+    stats.cycles = cycles_.load(std::memory_order_relaxed);
+    stats.overruns = overruns_.load(std::memory_order_relaxed);
+    stats.skipped_cycles = skipped_cycles_.load(std::memory_order_relaxed);
+    stats.deadline_misses = deadline_misses_.load(std::memory_order_relaxed);
+    return stats;
+  }
+
+  /**
+   * @brief Histogram of wake-up jitter in nanoseconds (actual minus scheduled cycle start).
+   */
+  const LatencyHistogram& GetWakeupJitter() const { return wakeup_jitter_; }
+
+  /**
+   * @brief Histogram of step durations in nanoseconds.
+   */
+  const LatencyHistogram& GetStepDuration() const { return step_duration_; }
+
+  /**
+   * @brief Get the options the loop was created with.
+   */
+  const ControlLoopOptions& GetOptions() const { return options_; }
+
+ private:
+  Status ConfigureCurrentThread() {
+    if (options_.cpu >= 0) {
+      cpu_set_t cpus;
+      CPU_ZERO(&cpus);
+      CPU_SET(options_.cpu, &cpus);
+      const int err = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+      if (err != 0) {
+        return {ErrorCode::INTERNAL_ERROR, std::string("pthread_setaffinity_np failed: ") + std::strerror(err)};
+      }
+    }
+    if (options_.rt_priority > 0) {
+      sched_param param{};
+      param.sched_priority = options_.rt_priority;
+      const int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+      if (err != 0) {
+        return {ErrorCode::INTERNAL_ERROR, std::string("pthread_setschedparam failed: ") + std::strerror(err)};
+      }
+    }
+    return {ErrorCode::OK, ""};
+  }
+
+  static void SleepUntilNs(int64_t wake_ns) {
+    timespec ts;
+    ts.tv_sec = static_cast<time_t>(wake_ns / 1000000000);
+    ts.tv_nsec = static_cast<long>(wake_ns % 1000000000);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {
+    }
+  }
+
+  void Loop() {
+    const int64_t period = options_.period.count();
+    const int64_t deadline = options_.deadline.count() > 0 ? options_.deadline.count() : period;
+    const int64_t spin = options_.spin.count();
+    uint64_t cycle = 0;
+    int64_t next = SteadyNowNs() + period;
+    while (running_.load(std::memory_order_acquire)) {
+      if (spin < period) {
+        SleepUntilNs(next - (spin > 0 ? spin : 0));
+      }
+      int64_t now = SteadyNowNs();
+      while (now < next) {
+        now = SteadyNowNs();
+      }
+      wakeup_jitter_.Record(now - next);
+
+      step_(cycle++);
+
+      const int64_t end = SteadyNowNs();
+      step_duration_.Record(end - now);
+      cycles_.fetch_add(1, std::memory_order_relaxed);
+      if (end - now > deadline) {
+        deadline_misses_.fetch_add(1, std::memory_order_relaxed);
+      }
+      next += period;
+      if (end > next) {
+        // Keep the cycle phase: drop the periods that have already elapsed.
+        const int64_t missed = (end - next) / period + 1;
+        overruns_.fetch_add(1, std::memory_order_relaxed);
+        skipped_cycles_.fetch_add(static_cast<uint64_t>(missed), std::memory_order_relaxed);
+        next += missed * period;
+      }
+    }
+  }
+
+  ControlLoopOptions options_;                   // Loop configuration
+  StepFunction step_;                            // User step function
+  std::thread thread_;                           // Loop thread
+  std::atomic_bool running_{false};              // Whether the loop is running
+  std::atomic<uint64_t> cycles_{0};              // Statistics, see ControlLoopStats
+  std::atomic<uint64_t> overruns_{0};
+  std::atomic<uint64_t> skipped_cycles_{0};
+  std::atomic<uint64_t> deadline_misses_{0};
+  LatencyHistogram wakeup_jitter_;               // Wake-up jitter (ns)
+  LatencyHistogram step_duration_;               // Step duration (ns)
+};
+
+}  // namespace magic::dog::motion
@@ -0,0 +1,506 @@
+#pragma once
+
+#include "magic_async.h"
+#include "magic_realtime.h"
+#include "magic_type.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace magic::dog {
+
+/************************************************************
+ *                          Tasks                           *
+ ************************************************************/
+
+template <typename T = void>
+class Task;
+
+namespace detail {
+
+struct TaskPromiseBase {
+  std::coroutine_handle<> continuation;  // Awaiting coroutine, resumed when this task finishes
+  std::exception_ptr exception;
+
+  struct FinalAwaiter {
+    bool await_ready() noexcept { return false; }
+    template <typename Promise>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+      auto continuation = handle.promise().continuation;
+      return continuation ? continuation : std::noop_coroutine();
+    }
+    void await_resume() noexcept {}
+  };
+
+  std::suspend_always initial_suspend() noexcept { return {}; }
+  FinalAwaiter final_suspend() noexcept { return {}; }
+  void unhandled_exception() noexcept { exception = std::current_exception(); }
+};
+
+template <typename T>
+struct TaskPromise : TaskPromiseBase {
+  std::optional<T> value;
+
+  Task<T> get_return_object() noexcept;
+  void return_value(T result) { value.emplace(std::move(result)); }
+};
+
+template <>
+struct TaskPromise<void> : TaskPromiseBase {
+  Task<void> get_return_object() noexcept;
+  void return_void() noexcept {}
+};
+
+}  // namespace detail
+
+/**
+ * @class Task
+ * @brief Lazily started coroutine returning T, resumed by co_await.
+ *
+ * A Task starts when awaited and resumes its awaiter when it finishes (symmetric transfer, no extra thread).
+ * Top-level tasks are started with CoroScheduler::Spawn().
+ */
+template <typename T>
+class Task {
+ public:
+  using promise_type = detail::TaskPromise<T>;
+
+  explicit Task(std::coroutine_handle<promise_type> handle) noexcept : handle_(handle) {}
+  Task(Task&& other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+  Task& operator=(Task&& other) noexcept {
+    if (this != &other) {
+      if (handle_) {
+        handle_.destroy();
+      }
+      handle_ = std::exchange(other.handle_, {});
+    }
+    return *this;
+  }
+  Task(const Task&) = delete;
+  Task& operator=(const Task&) = delete;
+  ~Task() {
+    if (handle_) {
+      handle_.destroy();
+    }
+  }
+
+  bool await_ready() const noexcept { return false; }
+
+  std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiter) noexcept {
+    handle_.promise().continuation = awaiter;
+    return handle_;
+  }
+
+  T await_resume() {
+    if (handle_.promise().exception) {
+      std::rethrow_exception(handle_.promise().exception);
+    }
+    if constexpr (!std::is_void_v<T>) {
+      return std::move(*handle_.promise().value);
+    }
+  }
+
+ private:
+  std::coroutine_handle<promise_type> handle_;
+};
+
+namespace detail {
+
+template <typename T>
+Task<T> TaskPromise<T>::get_return_object() noexcept {
+  return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() noexcept {
+  return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+}
+
+// Self-destroying coroutine owning a spawned top-level task.
+struct DetachedTask {
+  struct promise_type {
+    DetachedTask get_return_object() noexcept { return {std::coroutine_handle<promise_type>::from_promise(*this)}; }
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() noexcept {}
+    void unhandled_exception() noexcept {}
+  };
+
+  std::coroutine_handle<promise_type> handle;
+};
+
+}  // namespace detail
+
+/************************************************************
+ *                        Scheduler                         *
+ ************************************************************/
+
+/**
+ * @class CoroScheduler
+ * @brief Single-thread event loop for mission coroutines.
+ *
+ * All spawned tasks run on the thread calling Run(); blocking RPCs are moved to the AsyncRpcExecutor and the awaiting
+ * task is resumed on the loop thread when they complete, so thousands of tasks cost one loop thread plus the RPC pool.
+ *
+ * Tasks still suspended when the scheduler is destroyed are destroyed with it (their locals are destructed, they are
+ * never resumed). The destructor first waits for the RPCs those tasks await, so no completion touches a freed
+ * scheduler or coroutine frame.
+ */
+class CoroScheduler final : public NonCopyable {
+ public:
+  /**
+   * @param rpc_executor Pool running the blocking RPCs awaited through Rpc(), must outlive the scheduler.
+   */
+  explicit CoroScheduler(AsyncRpcExecutor& rpc_executor) : rpc_executor_(rpc_executor) {}
+
+  /// Destructor, waits for in-flight RPCs and destroys the tasks that have not finished. Not on the loop thread.
+  ~CoroScheduler() {
+    std::unordered_map<uint64_t, std::coroutine_handle<>> roots;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      closed_ = true;
+      cv_.wait(lock, [this] { return rpcs_in_flight_ == 0; });
+      roots.swap(roots_);
+      ready_.clear();
+    }
+    timers_ = {};
+    // Destroying a top-level frame destroys the Task it awaits, and with it every nested frame.
+    for (auto& [id, handle] : roots) {
+      handle.destroy();
+    }
+  }
+
+  /**
+   * @brief Start a top-level task on the loop thread. Thread-safe.
+   */
+  void Spawn(Task<void> task) {
+    live_tasks_.fetch_add(1, std::memory_order_relaxed);
+    std::coroutine_handle<> handle;
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      const uint64_t id = next_root_id_++;
+      handle = RunDetached(this, id, std::move(task)).handle;
+      roots_.emplace(id, handle);
+    }
+    Post(handle);
+  }
+
+  /**
+   * @brief Run the loop on the calling thread until all spawned tasks finished or Stop() is called.
+   */
+  void Run() {
+    std::vector<std::coroutine_handle<>> ready;
+    while (!stopping_.load(std::memory_order_relaxed)) {
+      // Move expired timers to the ready list.
+      const int64_t now_ns = SteadyNowNs();
+      while (!timers_.empty() && timers_.top().deadline_ns <= now_ns) {
+        ready.push_back(timers_.top().handle);
+        timers_.pop();
+      }
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (ready.empty() && ready_.empty()) {
+          if (live_tasks_.load(std::memory_order_relaxed) == 0) {
+            break;
+          }
+          auto has_work = [this] { return !ready_.empty() || stopping_.load(std::memory_order_relaxed); };
+          if (timers_.empty()) {
+            cv_.wait(lock, has_work);
+          } else {
+            cv_.wait_for(lock, std::chrono::nanoseconds(timers_.top().deadline_ns - now_ns), has_work);
+          }
+        }
+        ready.insert(ready.end(), ready_.begin(), ready_.end());
+        ready_.clear();
+      }
+      for (auto handle : ready) {
+        handle.resume();
+      }
+      ready.clear();
+    }
+    // Consume the stop request on exit rather than on entry, so a Stop() issued before Run() is not lost.
+    stopping_.store(false, std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Make Run() return after the current batch of resumptions, or the next Run() return at once if the loop is
+   *        not running. Thread-safe. Unfinished tasks stay suspended until a later Run() or the scheduler's destruction.
+   */
+  void Stop() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    stopping_.store(true, std::memory_order_relaxed);
+    cv_.notify_all();
+  }
+
+  /**
+   * @brief Queue a suspended coroutine for resumption on the loop thread. Thread-safe.
+   */
+  void Post(std::coroutine_handle<> handle) {
+    // Notify under the lock: once Run() sees the handle it may return and the scheduler may be destroyed.
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (!closed_) {
+      ready_.push_back(handle);
+    }
+    cv_.notify_all();
+  }
+
+  /// Number of spawned tasks that have not finished.
+  std::size_t GetTaskCount() const { return live_tasks_.load(std::memory_order_relaxed); }
+
+  /// Number of spawned tasks that ended with an exception.
+  uint64_t GetFailedTaskCount() const { return failed_tasks_.load(std::memory_order_relaxed); }
+
+  /**
+   * @brief Awaitable suspending the task for a duration without blocking the loop. Loop thread only.
+   */
+  auto SleepFor(std::chrono::nanoseconds duration) {
+    struct SleepAwaiter {
+      CoroScheduler& scheduler;
+      int64_t deadline_ns;
+      bool await_ready() const noexcept { return deadline_ns <= SteadyNowNs(); }
+      void await_suspend(std::coroutine_handle<> handle) { scheduler.timers_.push({deadline_ns, handle}); }
+      void await_resume() const noexcept {}
+    };
+    return SleepAwaiter{*this, SteadyNowNs() + duration.count()};
+  }
+
+  /**
+   * @brief Awaitable running a blocking call on the RPC pool and resuming the task with its result on the loop thread.
+   */
+  template <typename R>
+  auto Rpc(std::function<R()> call) {
+    struct RpcAwaiter {
+      CoroScheduler& scheduler;
+      std::function<R()> call;
+      std::optional<R> result;
+      std::exception_ptr exception;
+
+      bool await_ready() const noexcept { return false; }
+      void await_suspend(std::coroutine_handle<> handle) {
+        {
+          std::lock_guard<std::mutex> guard(scheduler.mutex_);
+          ++scheduler.rpcs_in_flight_;
+        }
+        scheduler.rpc_executor_.template Submit<bool>([this, handle] {
+          try {
+            result.emplace(call());
+          } catch (...) {
+            exception = std::current_exception();
+          }
+          // The awaiter may be destroyed as soon as the task resumes, do not touch it afterwards.
+          scheduler.CompleteRpc(handle);
+          return true;
+        });
+      }
+      R await_resume() {
+        if (exception) {
+          std::rethrow_exception(exception);
+        }
+        return std::move(*result);
+      }
+    };
+    return RpcAwaiter{*this, std::move(call), std::nullopt, nullptr};
+  }
+
+ private:
+  struct Timer {
+    int64_t deadline_ns;
+    std::coroutine_handle<> handle;
+    bool operator>(const Timer& other) const { return deadline_ns > other.deadline_ns; }
+  };
+
+  static detail::DetachedTask RunDetached(CoroScheduler* scheduler, uint64_t id, Task<void> task) {
+    try {
+      co_await task;
+    } catch (...) {
+      scheduler->failed_tasks_.fetch_add(1, std::memory_order_relaxed);
+    }
+    {
+      std::lock_guard<std::mutex> guard(scheduler->mutex_);
+      scheduler->roots_.erase(id);
+    }
+    scheduler->live_tasks_.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  // Called on the RPC pool: resume the awaiting task, or only release the destructor once the scheduler is closing.
+  void CompleteRpc(std::coroutine_handle<> handle) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    --rpcs_in_flight_;
+    if (!closed_) {
+      ready_.push_back(handle);
+    }
+    cv_.notify_all();
+  }
+
+  AsyncRpcExecutor& rpc_executor_;                                              // Runs blocking RPCs
+  std::mutex mutex_;                                                            // Guards the fields up to roots_
+  std::condition_variable cv_;                                                  // Signals ready_, stopping_ and RPC completion
+  std::vector<std::coroutine_handle<>> ready_;                                  // Coroutines posted from any thread
+  std::size_t rpcs_in_flight_ = 0;                                              // Rpc() calls not yet completed
+  bool closed_ = false;                                                         // Set by the destructor
+  uint64_t next_root_id_ = 0;
+  std::unordered_map<uint64_t, std::coroutine_handle<>> roots_;                 // Unfinished top-level task frames
+  std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers_;  // Sleeping coroutines, loop thread only
+  std::atomic<bool> stopping_{false};
+  std::atomic<std::size_t> live_tasks_{0};
+  std::atomic<uint64_t> failed_tasks_{0};
+};
+
+/************************************************************
+ *                     Message channels                     *
+ ************************************************************/
+
+/**
+ * @class MessageChannel
+ * @brief Awaitable "next message" reads on a subscription stream.
+ *
+ * Pass Callback() to a Subscribe* API; `co_await channel.Next()` suspends the task until a message arrives after the
+ * call and returns the newest one (intermediate messages are skipped). Several tasks may wait on one channel.
+ * The channel must outlive the subscription and any waiting task, and the subscription must end before the scheduler
+ * is destroyed; tasks destroyed with the scheduler leave the wait list.
+ *
+ * @tparam T Message type, e.g. Odometry or NavStatus.
+ */
+template <typename T>
+class MessageChannel final : public NonCopyable {
+ public:
+  using MessagePtr = std::shared_ptr<T>;
+
+  explicit MessageChannel(CoroScheduler& scheduler) : scheduler_(scheduler) {}
+
+  /**
+   * @brief Store a message and resume all waiting tasks. Called from the SDK delivery thread.
+   */
+  void Push(const MessagePtr& message) {
+    std::vector<std::coroutine_handle<>> waiters;
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      latest_ = message;
+      waiters.swap(waiters_);
+    }
+    for (auto handle : waiters) {
+      scheduler_.Post(handle);
+    }
+  }
+
+  /**
+   * @brief Subscription callback that feeds this channel, for the SDK Subscribe* APIs.
+   */
+  std::function<void(const MessagePtr)> Callback() {
+    return [this](const MessagePtr& message) { Push(message); };
+  }
+
+  /**
+   * @brief Latest message without waiting, nullptr if none arrived yet.
+   */
+  MessagePtr Latest() const {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return latest_;
+  }
+
+  /**
+   * @brief Awaitable returning the next message.
+   */
+  auto Next() {
+    struct NextAwaiter {
+      MessageChannel& channel;
+      std::coroutine_handle<> waiting{};
+      // A task destroyed while waiting (e.g. with its scheduler) leaves the wait list.
+      ~NextAwaiter() {
+        if (waiting) {
+          std::lock_guard<std::mutex> guard(channel.mutex_);
+          std::erase(channel.waiters_, waiting);
+        }
+      }
+      bool await_ready() const noexcept { return false; }
+      void await_suspend(std::coroutine_handle<> handle) {
+        std::lock_guard<std::mutex> guard(channel.mutex_);
+        waiting = handle;
+        channel.waiters_.push_back(handle);
+      }
+      MessagePtr await_resume() const { return channel.Latest(); }
+    };
+    return NextAwaiter{*this};
+  }
+
+ private:
+  CoroScheduler& scheduler_;
+  mutable std::mutex mutex_;                      // Guards latest_ and waiters_
+  MessagePtr latest_;                             // Newest message
+  std::vector<std::coroutine_handle<>> waiters_;  // Tasks waiting in Next()
+};
+
+/************************************************************
+ *                     Awaitable RPCs                       *
+ ************************************************************/
+
+namespace motion {
+
+/// Awaitable HighLevelMotionController::SetGait.
+inline auto AwaitSetGait(CoroScheduler& scheduler, HighLevelMotionController& controller, GaitMode gait_mode, int timeout_ms = 5000) {
+  return scheduler.Rpc<Status>([&controller, gait_mode, timeout_ms] { return controller.SetGait(gait_mode, timeout_ms); });
+}
+
+/// Awaitable HighLevelMotionController::GetGait.
+inline auto AwaitGetGait(CoroScheduler& scheduler, HighLevelMotionController& controller, int timeout_ms = 5000) {
+  return scheduler.Rpc<RpcResult<GaitMode>>([&controller, timeout_ms] {
+    RpcResult<GaitMode> result;
+    result.status = controller.GetGait(result.value, timeout_ms);
+    return result;
+  });
+}
+
+/// Awaitable HighLevelMotionController::ExecuteTrick.
+inline auto AwaitExecuteTrick(CoroScheduler& scheduler, HighLevelMotionController& controller, TrickAction trick_action, int timeout_ms = 5000) {
+  return scheduler.Rpc<Status>([&controller, trick_action, timeout_ms] { return controller.ExecuteTrick(trick_action, timeout_ms); });
+}
+
+}  // namespace motion
+
+namespace audio {
+
+/// Awaitable AudioController::Play.
+inline auto AwaitPlay(CoroScheduler& scheduler, AudioController& controller, const TtsCommand& cmd, int timeout_ms = 5000) {
+  return scheduler.Rpc<Status>([&controller, cmd, timeout_ms] { return controller.Play(cmd, timeout_ms); });
+}
+
+}  // namespace audio
+
+namespace slam {
+
+/// Awaitable SlamNavController::SetNavTarget.
+inline auto AwaitSetNavTarget(CoroScheduler& scheduler, SlamNavController& controller, const NavTarget& goal) {
+  return scheduler.Rpc<Status>([&controller, goal] { return controller.SetNavTarget(goal); });
+}
+
+/// Awaitable SlamNavController::LoadMap.
+inline auto AwaitLoadMap(CoroScheduler& scheduler, SlamNavController& controller, const std::string& map_name) {
+  return scheduler.Rpc<Status>([&controller, map_name] { return controller.LoadMap(map_name); });
+}
+
+/// Awaitable SlamNavController::GetNavTaskStatus.
+inline auto AwaitGetNavTaskStatus(CoroScheduler& scheduler, SlamNavController& controller) {
+  return scheduler.Rpc<RpcResult<NavStatus>>([&controller] {
+    RpcResult<NavStatus> result;
+    result.status = controller.GetNavTaskStatus(result.value);
+    return result;
+  });
+}
+
+}  // namespace slam
+
+}  // namespace magic::dog
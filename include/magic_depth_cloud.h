@@ -0,0 +1,477 @@
+#pragma once
+
+#include "magic_dispatch.h"
+#include "magic_frame_pool.h"
+#include "magic_point_cloud.h"
+#include "magic_sensor.h"
+#include "magic_type.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#if defined(__AVX2__)
+  #include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  #include <arm_neon.h>
+#endif
+
+namespace magic::dog::sensor {
+
+/************************************************************
+ *                         Ray tables                       *
+ ************************************************************/
+
+namespace detail {
+
+// Invert the plumb_bob / rational_polynomial distortion of normalized coordinates (xd, yd), as OpenCV's
+// undistortPoints does: fixed-point iteration on x = (xd - tangential(x)) / radial(x).
+inline void UndistortNormalized(double xd, double yd, const std::vector<double>& d, double& x, double& y) {
+  const auto coefficient = [&](std::size_t i) { return i < d.size() ? d[i] : 0.0; };
+  const double k1 = coefficient(0), k2 = coefficient(1), p1 = coefficient(2), p2 = coefficient(3), k3 = coefficient(4);
+  const double k4 = coefficient(5), k5 = coefficient(6), k6 = coefficient(7);
+  x = xd;
+  y = yd;
+  for (int iteration = 0; iteration < 20; ++iteration) {
+    const double r2 = x * x + y * y;
+    const double r4 = r2 * r2;
+    const double r6 = r4 * r2;
+    const double inverse_radial = (1.0 + k4 * r2 + k5 * r4 + k6 * r6) / (1.0 + k1 * r2 + k2 * r4 + k3 * r6);
+    const double dx = 2.0 * p1 * x * y + p2 * (r2 + 2.0 * x * x);
+    const double dy = p1 * (r2 + 2.0 * y * y) + 2.0 * p2 * x * y;
+    const double next_x = (xd - dx) * inverse_radial;
+    const double next_y = (yd - dy) * inverse_radial;
+    const bool converged = std::abs(next_x - x) + std::abs(next_y - y) < 1e-12;
+    x = next_x;
+    y = next_y;
+    if (converged) {
+      break;
+    }
+  }
+}
+
+}  // namespace detail
+
+/**
+ * @class DepthRayTable
+ * @brief Per-pixel viewing rays of a depth camera, so deprojection is point = depth * (ray_x, ray_y, 1).
+ *
+ * Built once from CameraInfo::K and D (plumb_bob or rational_polynomial; no distortion if D is empty or zero),
+ * removing the division and distortion inversion from the per-frame path. Rows are padded to
+ * kSimdBufferAlignment so every row starts aligned.
+ */
+class DepthRayTable {
+ public:
+  /**
+   * @brief Build the table for a camera, sampling every decimation-th pixel of every decimation-th row.
+   * @param executor Optional workers sharing the rows with the calling thread.
+   * @return INTERNAL_ERROR for a non-positive size, focal length or decimation, or an unknown distortion model.
+   */
+  Status Build(const CameraInfo& info, int32_t decimation, Executor* executor = nullptr) {
+    if (info.width <= 0 || info.height <= 0 || decimation <= 0) {
+      return {ErrorCode::INTERNAL_ERROR, "camera size and decimation must be positive"};
+    }
+    const double fx = info.K[0];
+    const double skew = info.K[1];
+    const double cx = info.K[2];
+    const double fy = info.K[4];
+    const double cy = info.K[5];
+    if (!(fx > 0.0) || !(fy > 0.0)) {
+      return {ErrorCode::INTERNAL_ERROR, "camera focal length must be positive"};
+    }
+    const bool distorted = std::any_of(info.D.begin(), info.D.end(), [](double d) { return d != 0.0; });
+    if (distorted && info.distortion_model != "plumb_bob" && info.distortion_model != "rational_polynomial") {
+      return {ErrorCode::INTERNAL_ERROR, "unsupported distortion model: " + info.distortion_model};
+    }
+    width_ = (info.width + decimation - 1) / decimation;
+    height_ = (info.height + decimation - 1) / decimation;
+    const std::size_t lane = kSimdBufferAlignment / sizeof(float);
+    stride_ = (static_cast<std::size_t>(width_) + lane - 1) / lane * lane;
+    ray_x_.assign(stride_ * height_, 0.0f);
+    ray_y_.assign(stride_ * height_, 0.0f);
+    ParallelFor(executor, static_cast<std::size_t>(height_), 1, [&](std::size_t begin, std::size_t end) {
+      for (std::size_t row = begin; row < end; ++row) {
+        const double yd = (static_cast<double>(row) * decimation - cy) / fy;
+        for (int32_t column = 0; column < width_; ++column) {
+          const double xd = (static_cast<double>(column) * decimation - cx - skew * yd) / fx;
+          double x = xd;
+          double y = yd;
+          if (distorted) {
+            detail::UndistortNormalized(xd, yd, info.D, x, y);
+          }
+          ray_x_[row * stride_ + column] = static_cast<float>(x);
+          ray_y_[row * stride_ + column] = static_cast<float>(y);
+        }
+      }
+    });
+    source_width_ = info.width;
+    source_height_ = info.height;
+    decimation_ = decimation;
+    K_ = info.K;
+    D_ = info.D;
+    distortion_model_ = info.distortion_model;
+    return {ErrorCode::OK, ""};
+  }
+
+  /// Whether the table was built for this camera and decimation.
+  bool Matches(const CameraInfo& info, int32_t decimation) const {
+    return decimation == decimation_ && info.width == source_width_ && info.height == source_height_ && info.K == K_ &&
+           info.D == D_ && info.distortion_model == distortion_model_;
+  }
+
+  /// Ray x components of an output row.
+  const float* RayX(int32_t row) const { return ray_x_.data() + row * stride_; }
+
+  /// Ray y components of an output row.
+  const float* RayY(int32_t row) const { return ray_y_.data() + row * stride_; }
+
+  int32_t Width() const { return width_; }                ///< Output columns
+  int32_t Height() const { return height_; }              ///< Output rows
+  int32_t SourceWidth() const { return source_width_; }   ///< Depth image width
+  int32_t SourceHeight() const { return source_height_; } ///< Depth image height
+  int32_t Decimation() const { return decimation_; }      ///< Pixel stride
+
+ private:
+  int32_t width_ = 0;
+  int32_t height_ = 0;
+  std::size_t stride_ = 0;         // Floats per table row
+  int32_t source_width_ = 0;
+  int32_t source_height_ = 0;
+  int32_t decimation_ = 0;
+  std::array<double, 9> K_{};      // Intrinsics the table was built from
+  std::vector<double> D_;
+  std::string distortion_model_;
+  AlignedVector<float> ray_x_;     // x / z of each output pixel's ray
+  AlignedVector<float> ray_y_;     // y / z of each output pixel's ray
+};
+
+/************************************************************
+ *                      Depth projection                    *
+ ************************************************************/
+
+/**
+ * @brief DepthCloudProjector options.
+ */
+struct DepthCloudOptions {
+  int32_t decimation = 1;                                    ///< Use every n-th pixel of every n-th row
+  float depth_scale = 0.001f;                                ///< Meters per 16UC1 depth unit (32FC1 is in meters)
+  float min_depth = 0.0f;                                    ///< Closer depths are invalid (m); zero depth is always invalid
+  float max_depth = std::numeric_limits<float>::infinity();  ///< Farther depths are invalid (m); infinite depth always is
+  bool organized = true;                                     ///< Keep the image grid with NaN points; false drops them
+  std::size_t threads = 1;                                   ///< Row threads including the caller, 0 for hardware concurrency
+  std::size_t min_rows_per_task = 16;                        ///< Minimum rows per worker task
+  std::size_t pool_size = 4;                                 ///< Pooled output clouds of the subscription stage
+};
+
+/// Depth stream used by DepthCloudProjector::Attach().
+enum class DepthCloudSource {
+  RGBD = 0,   ///< SubscribeRgbdDepthImage, intrinsics from SubscribeRgbDepthCameraInfo
+  DEPTH = 1,  ///< SubscribeDepthImage, intrinsics from SetCameraInfo()
+};
+
+/**
+ * @class DepthCloudProjector
+ * @brief Deprojects 16UC1 / 32FC1 depth images into PointXYZ clouds in the camera optical frame.
+ *
+ * Each output pixel costs one depth load and two multiplies against the DepthRayTable, 8 pixels per AVX2 iteration
+ * (4 per NEON). Rows are split across an optional worker pool. Use Project() directly, or Attach() to run as a
+ * SensorController stage delivering pooled clouds.
+ */
+class DepthCloudProjector final : public NonCopyable {
+ public:
+  using PointCloudPtr = std::shared_ptr<PointCloud2>;
+  using PointCloudCallback = std::function<void(const PointCloudPtr)>;
+
+  explicit DepthCloudProjector(const DepthCloudOptions& options = DepthCloudOptions())
+      : options_(options), pool_(options.pool_size) {
+    options_.decimation = std::max(options_.decimation, 1);
+    std::size_t threads = options_.threads != 0 ? options_.threads : std::max(1u, std::thread::hardware_concurrency());
+    // The calling thread projects one share of every image.
+    if (threads > 1) {
+      executor_ = std::make_unique<Executor>(ExecutorOptions{"depth_cloud", threads - 1, {}, SCHED_OTHER, 0});
+    }
+  }
+
+  /// Destructor, unsubscribes if still attached.
+  ~DepthCloudProjector() { Detach(); }
+
+  /**
+   * @brief Set the camera intrinsics, rebuilding the ray table only if they changed. Thread-safe.
+   */
+  Status SetCameraInfo(const CameraInfo& info) {
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      if (table_ && table_->Matches(info, options_.decimation)) {
+        return {ErrorCode::OK, ""};
+      }
+    }
+    auto table = std::make_shared<DepthRayTable>();
+    Status status = table->Build(info, options_.decimation, executor_.get());
+    if (status.code == ErrorCode::OK) {
+      std::lock_guard<std::mutex> guard(mutex_);
+      table_ = std::move(table);
+    }
+    return status;
+  }
+
+  /// Whether camera intrinsics have been set.
+  bool HasCameraInfo() const {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return table_ != nullptr;
+  }
+
+  /**
+   * @brief Deproject a depth image. One caller at a time.
+   * @param out PointXYZ cloud with the image header; organized (height x width, NaN for invalid pixels,
+   *            is_dense = false) or, with organized = false, only valid points.
+   * @return SERVICE_NOT_READY before SetCameraInfo(); INTERNAL_ERROR for an unsupported encoding or an image whose
+   *         size does not match the camera info.
+   */
+  Status Project(const Image& depth, PointCloud2& out) {
+    std::shared_ptr<const DepthRayTable> table;
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      table = table_;
+    }
+    if (!table) {
+      return {ErrorCode::SERVICE_NOT_READY, "no camera info"};
+    }
+    const bool is_float = depth.encoding == "32FC1";
+    if (!is_float && depth.encoding != "16UC1" && depth.encoding != "mono16") {
+      return {ErrorCode::INTERNAL_ERROR, "unsupported depth encoding: " + depth.encoding};
+    }
+    const int32_t bytes_per_pixel = is_float ? 4 : 2;
+    if (depth.width != table->SourceWidth() || depth.height != table->SourceHeight() || depth.is_bigendian ||
+        depth.step < depth.width * bytes_per_pixel ||
+        static_cast<std::size_t>(depth.step) * static_cast<std::size_t>(depth.height) > depth.data.size()) {
+      return {ErrorCode::INTERNAL_ERROR, "depth image does not match the camera info"};
+    }
+
+    const int32_t width = table->Width();
+    const int32_t height = table->Height();
+    SetPointLayout<PointXYZ>(out, static_cast<std::size_t>(width) * static_cast<std::size_t>(height));
+    out.header.stamp = depth.header.stamp;
+    out.header.frame_id = depth.header.frame_id;
+    out.height = height;
+    out.width = width;
+    out.row_step = width * out.point_step;
+    out.is_dense = false;
+
+    const Limits limits{options_.depth_scale, options_.min_depth, std::min(options_.max_depth, std::numeric_limits<float>::max())};
+    const int32_t decimation = options_.decimation;
+    ParallelFor(executor_.get(), static_cast<std::size_t>(height), options_.min_rows_per_task,
+                [&](std::size_t begin, std::size_t end) {
+                  for (std::size_t row = begin; row < end; ++row) {
+                    const uint8_t* source = depth.data.data() + row * decimation * static_cast<std::size_t>(depth.step);
+                    uint8_t* target = out.data.data() + row * static_cast<std::size_t>(out.row_step);
+                    const int32_t r = static_cast<int32_t>(row);
+                    if (is_float) {
+                      ProjectRow(reinterpret_cast<const float*>(source), *table, r, limits, decimation, target);
+                    } else {
+                      ProjectRow(reinterpret_cast<const uint16_t*>(source), *table, r, limits, decimation, target);
+                    }
+                  }
+                });
+    if (!options_.organized) {
+      RemoveNaNPoints<PointXYZ>(out, out);
+    }
+    return {ErrorCode::OK, ""};
+  }
+
+  /**
+   * @brief Subscribe to a depth stream and deliver deprojected clouds to a callback, on the SDK callback thread.
+   * @note Replaces any depth image (and, for RGBD, depth camera info) callback previously registered on the controller.
+   */
+  void Attach(SensorController& controller, DepthCloudSource source, const PointCloudCallback& callback) {
+    Detach();
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      callback_ = callback;
+    }
+    controller_ = &controller;
+    source_ = source;
+    auto on_depth = [this](const std::shared_ptr<Image> msg) {
+      if (msg) {
+        OnDepthImage(*msg);
+      }
+    };
+    if (source == DepthCloudSource::RGBD) {
+      controller.SubscribeRgbDepthCameraInfo([this](const std::shared_ptr<CameraInfo> msg) {
+        if (msg) {
+          SetCameraInfo(*msg);
+        }
+      });
+      controller.SubscribeRgbdDepthImage(on_depth);
+    } else {
+      controller.SubscribeDepthImage(on_depth);
+    }
+  }
+
+  /**
+   * @brief Unsubscribe from the attached controller.
+   */
+  void Detach() {
+    if (controller_ == nullptr) {
+      return;
+    }
+    if (source_ == DepthCloudSource::RGBD) {
+      controller_->UnsubscribeRgbdDepthImage();
+      controller_->UnsubscribeRgbDepthCameraInfo();
+    } else {
+      controller_->UnsubscribeDepthImage();
+    }
+    controller_ = nullptr;
+  }
+
+  /// Number of clouds delivered by the subscription stage.
+  uint64_t GetProjectedCount() const { return projected_.load(std::memory_order_relaxed); }
+
+  /// Number of depth images dropped by the subscription stage (no camera info, bad image or pool exhausted).
+  uint64_t GetDroppedCount() const { return dropped_.load(std::memory_order_relaxed); }
+
+  /// Output cloud pool of the subscription stage, for statistics.
+  const FramePool<PointCloud2>& GetPool() const { return pool_; }
+
+ private:
+  struct Limits {
+    float scale;  // Meters per depth unit (16UC1)
+    float min;    // Minimum valid depth (m)
+    float max;    // Maximum valid depth (m), finite
+  };
+
+  static float DepthToMeters(uint16_t depth, float scale) { return static_cast<float>(depth) * scale; }
+  static float DepthToMeters(float depth, float) { return depth; }
+
+  // Load 8 output pixels' depth in meters (SIMD when contiguous, gathered when decimated).
+  template <typename Depth>
+  static void LoadDepth(const Depth* source, int32_t column, int32_t decimation, float scale, float* z) {
+    for (int32_t i = 0; i < 8; ++i) {
+      z[i] = DepthToMeters(source[(column + i) * decimation], scale);
+    }
+  }
+
+  template <typename Depth>
+  static void ProjectRow(const Depth* source, const DepthRayTable& table, int32_t row, const Limits& limits,
+                         int32_t decimation, uint8_t* target) {
+    const float* ray_x = table.RayX(row);
+    const float* ray_y = table.RayY(row);
+    const int32_t width = table.Width();
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    int32_t column = 0;
+#if defined(__AVX2__)
+    alignas(32) float z[8];
+    alignas(32) float xyz[24];
+    const __m256 lo = _mm256_set1_ps(limits.min);
+    const __m256 hi = _mm256_set1_ps(limits.max);
+    const __m256 nan8 = _mm256_set1_ps(nan);
+    for (; column + 8 <= width; column += 8) {
+      __m256 depth;
+      if (decimation == 1) {
+        if constexpr (std::is_same_v<Depth, uint16_t>) {
+          const __m128i raw = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + column));
+          depth = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(raw)), _mm256_set1_ps(limits.scale));
+        } else {
+          depth = _mm256_loadu_ps(source + column);
+        }
+      } else {
+        LoadDepth(source, column, decimation, limits.scale, z);
+        depth = _mm256_load_ps(z);
+      }
+      // Ordered compares also reject NaN depths; max is finite, so infinite depths fail too.
+      const __m256 valid = _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(depth, _mm256_setzero_ps(), _CMP_GT_OQ),
+                                                       _mm256_cmp_ps(depth, lo, _CMP_GE_OQ)),
+                                         _mm256_cmp_ps(depth, hi, _CMP_LE_OQ));
+      alignas(32) float x[8];
+      alignas(32) float y[8];
+      _mm256_store_ps(x, _mm256_blendv_ps(nan8, _mm256_mul_ps(depth, _mm256_load_ps(ray_x + column)), valid));
+      _mm256_store_ps(y, _mm256_blendv_ps(nan8, _mm256_mul_ps(depth, _mm256_load_ps(ray_y + column)), valid));
+      _mm256_store_ps(z, _mm256_blendv_ps(nan8, depth, valid));
+      for (int i = 0; i < 8; ++i) {
+        xyz[3 * i] = x[i];
+        xyz[3 * i + 1] = y[i];
+        xyz[3 * i + 2] = z[i];
+      }
+      std::memcpy(target + static_cast<std::size_t>(column) * sizeof(PointXYZ), xyz, sizeof(xyz));
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    alignas(32) float z[8];
+    alignas(32) float xyz[24];
+    const float32x4_t lo = vdupq_n_f32(limits.min);
+    const float32x4_t hi = vdupq_n_f32(limits.max);
+    const float32x4_t nan4 = vdupq_n_f32(nan);
+    for (; column + 8 <= width; column += 8) {
+      float32x4_t depth[2];
+      if (decimation == 1) {
+        if constexpr (std::is_same_v<Depth, uint16_t>) {
+          const uint16x8_t raw = vld1q_u16(source + column);
+          depth[0] = vmulq_n_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16(raw))), limits.scale);
+          depth[1] = vmulq_n_f32(vcvtq_f32_u32(vmovl_u16(vget_high_u16(raw))), limits.scale);
+        } else {
+          depth[0] = vld1q_f32(source + column);
+          depth[1] = vld1q_f32(source + column + 4);
+        }
+      } else {
+        LoadDepth(source, column, decimation, limits.scale, z);
+        depth[0] = vld1q_f32(z);
+        depth[1] = vld1q_f32(z + 4);
+      }
+      for (int half = 0; half < 2; ++half) {
+        const float32x4_t d = depth[half];
+        const uint32x4_t valid = vandq_u32(vandq_u32(vcgtq_f32(d, vdupq_n_f32(0.0f)), vcgeq_f32(d, lo)), vcleq_f32(d, hi));
+        float32x4x3_t point;
+        point.val[0] = vbslq_f32(valid, vmulq_f32(d, vld1q_f32(ray_x + column + 4 * half)), nan4);
+        point.val[1] = vbslq_f32(valid, vmulq_f32(d, vld1q_f32(ray_y + column + 4 * half)), nan4);
+        point.val[2] = vbslq_f32(valid, d, nan4);
+        vst3q_f32(xyz + 12 * half, point);  // Interleaves x, y, z
+      }
+      std::memcpy(target + static_cast<std::size_t>(column) * sizeof(PointXYZ), xyz, sizeof(xyz));
+    }
+#endif
+    for (; column < width; ++column) {
+      const float depth = DepthToMeters(source[column * decimation], limits.scale);
+      const bool valid = depth > 0.0f && depth >= limits.min && depth <= limits.max;
+      const PointXYZ point = valid ? PointXYZ{depth * ray_x[column], depth * ray_y[column], depth} : PointXYZ{nan, nan, nan};
+      std::memcpy(target + static_cast<std::size_t>(column) * sizeof(PointXYZ), &point, sizeof(point));
+    }
+  }
+
+  void OnDepthImage(const Image& depth) {
+    PointCloudCallback callback;
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      callback = callback_;
+    }
+    auto cloud = pool_.Acquire();
+    if (!cloud || !callback || Project(depth, *cloud).code != ErrorCode::OK) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    projected_.fetch_add(1, std::memory_order_relaxed);
+    callback(cloud);
+  }
+
+  DepthCloudOptions options_;
+  std::unique_ptr<Executor> executor_;            // Row workers, nullptr when single-threaded
+  mutable std::mutex mutex_;                      // Guards table_ and callback_
+  std::shared_ptr<const DepthRayTable> table_;    // Rays of the current camera, replaced when the intrinsics change
+  PointCloudCallback callback_;
+  FramePool<PointCloud2> pool_;                   // Output clouds of the subscription stage
+  SensorController* controller_ = nullptr;
+  DepthCloudSource source_ = DepthCloudSource::RGBD;
+  std::atomic<uint64_t> projected_{0};
+  std::atomic<uint64_t> dropped_{0};
+};
+
+}  // namespace magic::dog::sensor
@@ -0,0 +1,493 @@
+#pragma once
+
+#include "magic_realtime.h"
+#include "magic_type.h"
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace magic::dog {
+
+/************************************************************
+ *                         Executors                        *
+ ************************************************************/
+
+/**
+ * @brief Thread group configuration of an Executor.
+ */
+struct ExecutorOptions {
+  std::string name;                ///< Group name, e.g. "rt" or "camera", used by DispatchConfig and for the thread names
+  std::size_t threads = 1;         ///< Number of worker threads, at least one
+  std::vector<int> cpus;           ///< CPUs the workers may run on, empty keeps the inherited affinity
+  int sched_policy = SCHED_OTHER;  ///< Scheduling policy, e.g. SCHED_FIFO for an isolated real-time core
+  int priority = 0;                ///< Priority for SCHED_FIFO / SCHED_RR (1-98), ignored for SCHED_OTHER
+};
+
+/**
+ * @class Executor
+ * @brief Worker thread pool running callback dispatch tasks.
+ *
+ * One Executor may be shared by several TopicQueue instances (shared executor), or a queue may own a
+ * single-thread Executor (dedicated executor), so a slow consumer only delays the topics on its own executor.
+ * Each task records how long it waited in the queue and how long it ran.
+ */
+class Executor final : public NonCopyable {
+ public:
+  /**
+   * @brief Start the worker threads.
+   * @param threads Number of worker threads, at least one.
+   */
+  explicit Executor(std::size_t threads = 1) : Executor(ExecutorOptions{"", threads, {}, SCHED_OTHER, 0}) {}
+
+  /**
+   * @brief Start the worker threads with CPU affinity and scheduling policy.
+   * @note Affinity or scheduling failures (e.g. missing CAP_SYS_NICE) do not stop the workers, see GetConfigStatus().
+   */
+  explicit Executor(const ExecutorOptions& options) : options_(options) {
+    options_.threads = std::max<std::size_t>(options_.threads, 1);
+    for (std::size_t i = 0; i < options_.threads; ++i) {
+      workers_.emplace_back(&Executor::WorkerLoop, this, i);
+    }
+  }
+
+  /// Destructor, runs the remaining tasks and joins the worker threads.
+  ~Executor() {
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      stopping_ = true;
+    }
+    cv_.notify_all();
+    for (auto& worker : workers_) {
+      worker.join();
+    }
+  }
+
+  /**
+   * @brief Queue a task for execution on one of the worker threads.
+   */
+  void Post(std::function<void()> task) {
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      tasks_.push_back({std::move(task), SteadyNowNs()});
+    }
+    cv_.notify_one();
+  }
+
+  /// Number of worker threads.
+  std::size_t GetThreadCount() const { return workers_.size(); }
+
+  /// Options the executor was created with.
+  const ExecutorOptions& GetOptions() const { return options_; }
+
+  /**
+   * @brief Result of applying the CPU affinity and scheduling policy to the workers.
+   */
+  Status GetConfigStatus() const {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return config_status_;
+  }
+
+  /**
+   * @brief Histogram of queueing latency in nanoseconds (Post() to task start).
+   */
+  const LatencyHistogram& GetQueueLatency() const { return queue_latency_; }
+
+  /**
+   * @brief Histogram of task run time in nanoseconds.
+   */
+  const LatencyHistogram& GetRunTime() const { return run_time_; }
+
+ private:
+  struct PendingTask {
+    std::function<void()> task;
+    int64_t posted_ns = 0;
+  };
+
+  Status ConfigureCurrentThread(std::size_t index) {
+    if (!options_.name.empty()) {
+      // Linux limits thread names to 15 characters.
+      pthread_setname_np(pthread_self(), (options_.name + "-" + std::to_string(index)).substr(0, 15).c_str());
+    }
+    if (!options_.cpus.empty()) {
+      cpu_set_t cpus;
+      CPU_ZERO(&cpus);
+      for (int cpu : options_.cpus) {
+        CPU_SET(cpu, &cpus);
+      }
+      const int err = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+      if (err != 0) {
+        return {ErrorCode::INTERNAL_ERROR, std::string("pthread_setaffinity_np failed: ") + std::strerror(err)};
+      }
+    }
+    if (options_.sched_policy != SCHED_OTHER) {
+      sched_param param{};
+      param.sched_priority = options_.priority;
+      const int err = pthread_setschedparam(pthread_self(), options_.sched_policy, &param);
+      if (err != 0) {
+        return {ErrorCode::INTERNAL_ERROR, std::string("pthread_setschedparam failed: ") + std::strerror(err)};
+      }
+    }
+    return {ErrorCode::OK, ""};
+  }
+
+  void WorkerLoop(std::size_t index) {
+    Status status = ConfigureCurrentThread(index);
+    if (status.code != ErrorCode::OK) {
+      std::lock_guard<std::mutex> guard(mutex_);
+      config_status_ = std::move(status);
+    }
+    while (true) {
+      PendingTask pending;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+        if (tasks_.empty()) {
+          return;
+        }
+        pending = std::move(tasks_.front());
+        tasks_.pop_front();
+      }
+      const int64_t start_ns = SteadyNowNs();
+      queue_latency_.Record(start_ns - pending.posted_ns);
+      pending.task();
+      run_time_.Record(SteadyNowNs() - start_ns);
+    }
+  }
+
+  ExecutorOptions options_;                   // Thread group configuration
+  std::vector<std::thread> workers_;          // Worker threads
+  mutable std::mutex mutex_;                  // Guards tasks_, stopping_ and config_status_
+  std::condition_variable cv_;                // Signals new tasks
+  std::deque<PendingTask> tasks_;             // Pending tasks
+  bool stopping_ = false;                     // Set by the destructor
+  Status config_status_{ErrorCode::OK, ""};  // Last affinity / scheduling failure
+  LatencyHistogram queue_latency_;            // Post() to task start
+  LatencyHistogram run_time_;                 // Task duration
+};
+
+using ExecutorPtr = std::shared_ptr<Executor>;
+
+/**
+ * @brief Run body(begin, end) over [0, count) in chunks of at least min_chunk, on the workers and the calling thread.
+ *
+ * Blocks until every chunk has finished. The calling thread runs the first chunk, so a null executor (or a count
+ * that fits one chunk) runs everything inline.
+ */
+template <typename Body>
+void ParallelFor(Executor* executor, std::size_t count, std::size_t min_chunk, const Body& body) {
+  const std::size_t lanes = executor != nullptr ? executor->GetThreadCount() + 1 : 1;
+  const std::size_t chunk = std::max<std::size_t>(std::max<std::size_t>(min_chunk, 1), (count + lanes - 1) / lanes);
+  if (count <= chunk) {
+    body(0, count);
+    return;
+  }
+  std::mutex mutex;
+  std::condition_variable done;
+  std::size_t pending = 0;
+  for (std::size_t begin = chunk; begin < count; begin += chunk) {
+    const std::size_t end = std::min(count, begin + chunk);
+    {
+      std::lock_guard<std::mutex> guard(mutex);
+      ++pending;
+    }
+    executor->Post([&, begin, end] {
+      body(begin, end);
+      std::lock_guard<std::mutex> guard(mutex);
+      if (--pending == 0) {
+        done.notify_one();
+      }
+    });
+  }
+  body(0, chunk);
+  std::unique_lock<std::mutex> lock(mutex);
+  done.wait(lock, [&] { return pending == 0; });
+}
+
+/************************************************************
+ *                    Bounded topic queues                  *
+ ************************************************************/
+
+/**
+ * @brief What a full subscription queue does with a new message.
+ */
+enum class DropPolicy : int8_t {
+  DROP_OLDEST = 0,  ///< Discard the oldest queued message to make room
+  DROP_NEWEST = 1,  ///< Discard the new message
+  KEEP_LATEST = 2,  ///< Keep only the newest message (queue depth is treated as 1)
+};
+
+/**
+ * @brief Per-subscription dispatch options.
+ */
+struct SubscriptionOptions {
+  std::size_t queue_depth = 1;                       ///< Maximum queued messages
+  DropPolicy drop_policy = DropPolicy::KEEP_LATEST;  ///< Behavior when the queue is full
+  ExecutorPtr executor;                              ///< Shared executor, nullptr for a dedicated thread
+  std::size_t max_batch = 16;                        ///< Messages handled per executor task before yielding to other topics
+};
+
+/**
+ * @brief Per-subscription counters.
+ */
+struct SubscriptionStats {
+  uint64_t received = 0;            ///< Messages handed to the queue
+  uint64_t dropped = 0;             ///< Messages discarded by the drop policy
+  uint64_t delivered = 0;           ///< Messages passed to the handler
+  std::size_t queue_depth = 0;      ///< Currently queued messages
+  std::size_t max_queue_depth = 0;  ///< Highest observed queue depth
+};
+
+/**
+ * @class TopicQueue
+ * @brief Bounded dispatch queue between an SDK subscription and a user handler.
+ *
+ * Callback() returns a function to pass to a Subscribe* API (e.g. SensorController::SubscribeLaserScan).
+ * It only enqueues the message and returns at once, so the SDK delivery thread is never blocked by the handler.
+ * The handler runs on the configured executor, with the configured queue depth and drop policy.
+ *
+ * @tparam T Message type, e.g. LaserScan or Image.
+ */
+template <typename T>
+class TopicQueue final : public NonCopyable {
+ public:
+  using MessagePtr = std::shared_ptr<T>;
+  using Handler = std::function<void(const MessagePtr)>;
+
+  /**
+   * @brief Create the queue.
+   * @param handler User handler, called on the executor.
+   * @param options Queue depth, drop policy and executor.
+   */
+  explicit TopicQueue(Handler handler, const SubscriptionOptions& options = SubscriptionOptions())
+      : state_(std::make_shared<State>()), executor_(options.executor ? options.executor : std::make_shared<Executor>(1)) {
+    state_->handler = std::move(handler);
+    state_->depth = options.drop_policy == DropPolicy::KEEP_LATEST ? 1 : std::max<std::size_t>(options.queue_depth, 1);
+    state_->policy = options.drop_policy;
+    state_->max_batch = std::max<std::size_t>(options.max_batch, 1);
+    state_->executor = executor_.get();
+  }
+
+  /// Destructor, see Close().
+  ~TopicQueue() { Close(); }
+
+  /**
+   * @brief Enqueue a message, applying the drop policy. Never blocks on the handler.
+   */
+  void Push(const MessagePtr& message) {
+    bool schedule = false;
+    {
+      std::lock_guard<std::mutex> guard(state_->mutex);
+      if (state_->closed) {
+        return;
+      }
+      ++state_->stats.received;
+      if (state_->queue.size() >= state_->depth) {
+        ++state_->stats.dropped;
+        if (state_->policy == DropPolicy::DROP_NEWEST) {
+          return;
+        }
+        state_->queue.pop_front();
+      }
+      state_->queue.push_back(message);
+      state_->stats.max_queue_depth = std::max(state_->stats.max_queue_depth, state_->queue.size());
+      if (!state_->scheduled) {
+        state_->scheduled = true;
+        schedule = true;
+      }
+    }
+    if (schedule) {
+      Schedule(state_);
+    }
+  }
+
+  /**
+   * @brief Subscription callback that feeds this queue, for the SDK Subscribe* APIs.
+   * @note The queue must outlive the subscription (unsubscribe before destroying it).
+   */
+  std::function<void(const MessagePtr)> Callback() {
+    return [this](const MessagePtr& message) { Push(message); };
+  }
+
+  /**
+   * @brief Get the queue counters.
+   */
+  SubscriptionStats GetStats() const {
+    std::lock_guard<std::mutex> guard(state_->mutex);
+    SubscriptionStats stats = state_->stats;
+    stats.queue_depth = state_->queue.size();
+    return stats;
+  }
+
+  /**
+   * @brief Drop queued messages, stop accepting new ones and wait for a running handler to return.
+   * @note Must not be called from inside the handler.
+   */
+  void Close() {
+    std::unique_lock<std::mutex> lock(state_->mutex);
+    state_->closed = true;
+    state_->queue.clear();
+    state_->idle.wait(lock, [this] { return !state_->running; });
+  }
+
+ private:
+  struct State {
+    Handler handler;
+    std::size_t depth = 1;
+    DropPolicy policy = DropPolicy::KEEP_LATEST;
+    std::size_t max_batch = 16;
+    Executor* executor = nullptr;  // Owned by the TopicQueue, which closes the state before releasing it
+    mutable std::mutex mutex;
+    std::condition_variable idle;  // Signaled when the handler is not running
+    std::deque<MessagePtr> queue;
+    SubscriptionStats stats;
+    bool scheduled = false;  // A drain task is queued or running
+    bool running = false;    // The handler is currently running
+    bool closed = false;
+  };
+
+  // Drain up to max_batch messages, then re-post if more are pending so topics sharing an executor stay fair.
+  static void Schedule(const std::shared_ptr<State>& state) {
+    state->executor->Post([state]() {
+      for (std::size_t n = 0; n < state->max_batch; ++n) {
+        MessagePtr message;
+        {
+          std::lock_guard<std::mutex> guard(state->mutex);
+          if (state->closed || state->queue.empty()) {
+            state->scheduled = false;
+            return;
+          }
+          message = std::move(state->queue.front());
+          state->queue.pop_front();
+          state->running = true;
+        }
+        state->handler(message);
+        {
+          std::lock_guard<std::mutex> guard(state->mutex);
+          state->running = false;
+          ++state->stats.delivered;
+        }
+        state->idle.notify_all();
+      }
+      Schedule(state);
+    });
+  }
+
+  std::shared_ptr<State> state_;  // Shared with in-flight executor tasks
+  ExecutorPtr executor_;          // Shared or dedicated executor, released first on destruction
+};
+
+/************************************************************
+ *                    Dispatch configuration                *
+ ************************************************************/
+
+/**
+ * @class DispatchConfig
+ * @brief Maps subscription topics to named executor groups.
+ *
+ * Build it once at startup, e.g. leg state and IMU on a SCHED_FIFO group pinned to an isolated core and cameras on a
+ * worker pool, then create each TopicQueue with GetSubscriptionOptions(topic). Topics without an assignment use the
+ * default group. Per-group latency metrics come from Executor::GetQueueLatency() and Executor::GetRunTime().
+ */
+class DispatchConfig final : public NonCopyable {
+ public:
+  /**
+   * @brief Create the configuration with its default group.
+   * @param default_group Group used by unassigned topics.
+   */
+  explicit DispatchConfig(const ExecutorOptions& default_group = ExecutorOptions{"default", 1, {}, SCHED_OTHER, 0})
+      : default_group_(default_group.name) {
+    AddGroup(default_group);
+  }
+
+  /**
+   * @brief Create a named executor group, starting its threads.
+   * @return INTERNAL_ERROR if a group with the same name exists.
+   */
+  Status AddGroup(const ExecutorOptions& options) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (groups_.count(options.name) != 0) {
+      return {ErrorCode::INTERNAL_ERROR, "executor group already exists: " + options.name};
+    }
+    groups_[options.name] = std::make_shared<Executor>(options);
+    return {ErrorCode::OK, ""};
+  }
+
+  /**
+   * @brief Route a topic to a group with the given queue depth and drop policy.
+   * @param topic Topic name, e.g. "leg_state", "imu", "rgbd_color".
+   * @param group Name of a group created with AddGroup().
+   * @return INTERNAL_ERROR if the group does not exist.
+   */
+  Status AssignTopic(const std::string& topic, const std::string& group, std::size_t queue_depth = 1,
+                     DropPolicy drop_policy = DropPolicy::KEEP_LATEST) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto it = groups_.find(group);
+    if (it == groups_.end()) {
+      return {ErrorCode::INTERNAL_ERROR, "unknown executor group: " + group};
+    }
+    SubscriptionOptions options;
+    options.queue_depth = queue_depth;
+    options.drop_policy = drop_policy;
+    options.executor = it->second;
+    topics_[topic] = options;
+    return {ErrorCode::OK, ""};
+  }
+
+  /**
+   * @brief Options for the TopicQueue of a topic.
+   */
+  SubscriptionOptions GetSubscriptionOptions(const std::string& topic) const {
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto it = topics_.find(topic);
+    if (it != topics_.end()) {
+      return it->second;
+    }
+    SubscriptionOptions options;
+    options.executor = groups_.at(default_group_);
+    return options;
+  }
+
+  /**
+   * @brief Executor of a group, nullptr if it does not exist.
+   */
+  ExecutorPtr GetGroup(const std::string& group) const {
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto it = groups_.find(group);
+    return it != groups_.end() ? it->second : nullptr;
+  }
+
+  /**
+   * @brief Names of all groups.
+   */
+  std::vector<std::string> GetGroupNames() const {
+    std::lock_guard<std::mutex> guard(mutex_);
+    std::vector<std::string> names;
+    for (const auto& [name, executor] : groups_) {
+      names.push_back(name);
+    }
+    return names;
+  }
+
+ private:
+  mutable std::mutex mutex_;                           // Guards groups_ and topics_
+  std::string default_group_;                          // Group of unassigned topics
+  std::map<std::string, ExecutorPtr> groups_;          // Executor groups by name
+  std::map<std::string, SubscriptionOptions> topics_;  // Topic routing
+};
+
+}  // namespace magic::dog
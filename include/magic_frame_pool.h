@@ -0,0 +1,255 @@
+#pragma once
+
+#include "magic_type.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace magic::dog {
+
+/************************************************************
+ *                        Frame pools                       *
+ ************************************************************/
+
+/**
+ * @class FramePool
+ * @brief Fixed set of preallocated, recyclable message buffers.
+ *
+ * Acquire() hands out a shared_ptr to a free pooled object; the object returns to the pool automatically when the
+ * last user drops its reference, keeping its heap capacity (e.g. std::vector data), so steady-state frames cause no
+ * malloc. Acquire() returns nullptr when all objects are in use, letting the caller choose to drop or wait.
+ *
+ * @tparam T Pooled message type, e.g. Image, LaserScan or PointCloud2.
+ */
+template <typename T>
+class FramePool final : public NonCopyable {
+ public:
+  /**
+   * @brief Create the pool.
+   * @param size Number of pooled objects.
+   * @param init Optional initializer called once per object, e.g. to reserve buffer capacity.
+   */
+  explicit FramePool(std::size_t size, const std::function<void(T&)>& init = nullptr) {
+    slots_.reserve(size);
+    for (std::size_t i = 0; i < size; ++i) {
+      auto object = std::make_shared<T>();
+      if (init) {
+        init(*object);
+      }
+      slots_.push_back(std::move(object));
+    }
+  }
+
+  /**
+   * @brief Take a free object from the pool.
+   * @return Pooled object (previous contents are kept, overwrite as needed), or nullptr if the pool is exhausted.
+   */
+  std::shared_ptr<T> Acquire() {
+    std::lock_guard<std::mutex> guard(acquire_mutex_);
+    for (std::size_t n = 0; n < slots_.size(); ++n) {
+      const std::size_t i = (next_ + n) % slots_.size();
+      // Only the pool holds a reference: the last user has released the object.
+      if (slots_[i].use_count() == 1) {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        next_ = i + 1;
+        acquired_.fetch_add(1, std::memory_order_relaxed);
+        return slots_[i];
+      }
+    }
+    exhausted_.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+  }
+
+  /// Number of pooled objects.
+  std::size_t Size() const { return slots_.size(); }
+
+  /// Number of successful Acquire() calls.
+  uint64_t GetAcquiredCount() const { return acquired_.load(std::memory_order_relaxed); }
+
+  /// Number of Acquire() calls that found no free object.
+  uint64_t GetExhaustedCount() const { return exhausted_.load(std::memory_order_relaxed); }
+
+ private:
+  std::vector<std::shared_ptr<T>> slots_;  // Pooled objects, the pool keeps one reference each
+  std::mutex acquire_mutex_;               // Serializes concurrent Acquire() calls
+  std::size_t next_ = 0;                   // Round-robin start index
+  std::atomic<uint64_t> acquired_{0};      // Statistics
+  std::atomic<uint64_t> exhausted_{0};
+};
+
+/************************************************************
+ *                      Aligned buffers                     *
+ ************************************************************/
+
+constexpr std::size_t kSimdBufferAlignment = 64;  ///< Alignment of SIMD buffers (one cache line, one AVX-512 register)
+
+/**
+ * @brief Allocator returning kSimdBufferAlignment-aligned storage, so SIMD loops may use aligned loads.
+ */
+template <typename T>
+struct AlignedAllocator {
+  using value_type = T;
+
+  AlignedAllocator() noexcept = default;
+  template <typename U>
+  AlignedAllocator(const AlignedAllocator<U>&) noexcept {}
+
+  T* allocate(std::size_t n) {
+    return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(kSimdBufferAlignment)));
+  }
+
+  void deallocate(T* p, std::size_t) noexcept { ::operator delete(p, std::align_val_t(kSimdBufferAlignment)); }
+
+  template <typename U>
+  bool operator==(const AlignedAllocator<U>&) const noexcept {
+    return true;
+  }
+  template <typename U>
+  bool operator!=(const AlignedAllocator<U>&) const noexcept {
+    return false;
+  }
+};
+
+/// std::vector with kSimdBufferAlignment-aligned data.
+template <typename T>
+using AlignedVector = std::vector<T, AlignedAllocator<T>>;
+
+/************************************************************
+ *                         Image views                      *
+ ************************************************************/
+
+/**
+ * @brief Bytes per pixel of a ROS-style image encoding, 0 if unknown.
+ */
+inline int32_t ImageBytesPerPixel(const std::string& encoding) {
+  if (encoding == "mono8" || encoding == "8UC1") {
+    return 1;
+  }
+  if (encoding == "mono16" || encoding == "16UC1" || encoding == "16SC1") {
+    return 2;
+  }
+  if (encoding == "rgb8" || encoding == "bgr8" || encoding == "8UC3") {
+    return 3;
+  }
+  if (encoding == "rgba8" || encoding == "bgra8" || encoding == "8UC4" || encoding == "32FC1") {
+    return 4;
+  }
+  return 0;
+}
+
+/**
+ * @brief Non-owning view of image pixels, no copy.
+ *
+ * Valid as long as the underlying buffer is alive, e.g. while the ImagePtr delivered to a subscription callback is held.
+ */
+struct ImageView {
+  const uint8_t* data = nullptr;  ///< First pixel byte
+  int32_t width = 0;              ///< Image width (pixels)
+  int32_t height = 0;             ///< Image height (pixels)
+  int32_t step = 0;               ///< Bytes per row
+  int32_t bytes_per_pixel = 0;    ///< Bytes per pixel, 0 if the encoding is unknown
+
+  /// Whether the view describes a complete image.
+  bool IsValid() const { return data != nullptr && width > 0 && height > 0 && step >= width * bytes_per_pixel; }
+
+  /// Pointer to the first byte of a row.
+  const uint8_t* Row(int32_t y) const { return data + static_cast<std::ptrdiff_t>(y) * step; }
+
+  /// Typed pointer to the first element of a row, e.g. Row<uint16_t>(y) for 16UC1 depth.
+  template <typename Pixel>
+  const Pixel* Row(int32_t y) const {
+    return reinterpret_cast<const Pixel*>(Row(y));
+  }
+};
+
+/**
+ * @brief View the pixels of an Image without copying.
+ */
+inline ImageView MakeImageView(const Image& image) {
+  ImageView view;
+  view.data = image.data.data();
+  view.width = image.width;
+  view.height = image.height;
+  view.step = image.step;
+  view.bytes_per_pixel = ImageBytesPerPixel(image.encoding);
+  if (static_cast<std::size_t>(image.step) * static_cast<std::size_t>(image.height) > image.data.size()) {
+    view.data = nullptr;
+  }
+  return view;
+}
+
+/************************************************************
+ *                        Image pools                       *
+ ************************************************************/
+
+/**
+ * @class ImagePool
+ * @brief FramePool of Image buffers preallocated for a fixed geometry.
+ *
+ * Use it for frames that must outlive the subscription callback in a different form (converted, cropped,
+ * re-encoded, synchronized): buffers are recycled, so steady state costs one memcpy per frame and no malloc.
+ * The memcpy dominates: when the allocator recycles freed blocks, a fresh make_shared copy reaches about the same
+ * bandwidth, so the gain is keeping malloc and its page faults off the frame path (see frame_pool_example).
+ * To keep a frame unchanged, holding the delivered ImagePtr is already zero-copy.
+ */
+class ImagePool final : public NonCopyable {
+ public:
+  /**
+   * @brief Create the pool.
+   * @param size Number of pooled images.
+   * @param width Image width (pixels).
+   * @param height Image height (pixels).
+   * @param bytes_per_pixel Bytes per pixel, e.g. 3 for rgb8, 2 for 16UC1 depth.
+   */
+  ImagePool(std::size_t size, int32_t width, int32_t height, int32_t bytes_per_pixel)
+      : pool_(size, [=](Image& image) {
+          image.width = width;
+          image.height = height;
+          image.step = width * bytes_per_pixel;
+          image.data.reserve(static_cast<std::size_t>(image.step) * static_cast<std::size_t>(height));
+        }) {}
+
+  /**
+   * @brief Take a free image buffer.
+   * @return Image whose data capacity fits the configured geometry, or nullptr if all are in use.
+   */
+  std::shared_ptr<Image> Acquire() { return pool_.Acquire(); }
+
+  /**
+   * @brief Copy an image into a recycled buffer.
+   * @return Pooled copy, or nullptr if all buffers are in use.
+   */
+  std::shared_ptr<Image> CopyFrom(const Image& source) {
+    auto image = pool_.Acquire();
+    if (!image) {
+      return nullptr;
+    }
+    image->header.stamp = source.header.stamp;
+    image->header.frame_id = source.header.frame_id;
+    image->height = source.height;
+    image->width = source.width;
+    image->encoding = source.encoding;
+    image->is_bigendian = source.is_bigendian;
+    image->step = source.step;
+    image->data.resize(source.data.size());
+    std::memcpy(image->data.data(), source.data.data(), source.data.size());
+    return image;
+  }
+
+  /// Underlying frame pool, for statistics.
+  const FramePool<Image>& GetPool() const { return pool_; }
+
+ private:
+  FramePool<Image> pool_;  // Pooled images
+};
+
+}  // namespace magic::dog
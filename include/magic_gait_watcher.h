@@ -0,0 +1,218 @@
+#pragma once
+
+#include "magic_motion.h"
+#include "magic_type.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+
+namespace magic::dog::motion {
+
+/**
+ * @brief GaitWatcher options.
+ */
+struct GaitWatcherOptions {
+  std::chrono::milliseconds poll_interval{100};  ///< GetGait period while a WaitForGait() call is pending
+  int rpc_timeout_ms = 1000;                     ///< Timeout of each GetGait call
+};
+
+/**
+ * @class GaitWatcher
+ * @brief Shared gait state stream with change notification and WaitForGait().
+ *
+ * One watcher thread serves every waiter and subscriber. It only queries the gait while a WaitForGait() call is
+ * pending, so an idle watcher causes no RPC traffic, and all waiters share one query per poll interval (by default
+ * the 100 ms of a hand-written SetGait / GetGait / sleep loop). Subscribers see the changes found by those queries and
+ * by Notify(), which lets a push source (e.g. a server-side gait stream or a local stand-in) deliver gait changes
+ * directly; waiters then wake immediately instead of at the next poll.
+ */
+class GaitWatcher final : public NonCopyable {
+ public:
+  /// Gait query used by the watcher thread.
+  using GaitSource = std::function<Status(GaitMode&)>;
+  /// Gait change callback, called on the watcher (or Notify()) thread.
+  using GaitCallback = std::function<void(GaitMode previous, GaitMode current)>;
+
+  /**
+   * @brief Watch the gait reported by a high-level motion controller.
+   * @param controller Initialized controller, must outlive this object.
+   */
+  explicit GaitWatcher(HighLevelMotionController& controller, const GaitWatcherOptions& options = GaitWatcherOptions())
+      : options_(options) {
+    const int timeout_ms = options.rpc_timeout_ms;
+    source_ = [&controller, timeout_ms](GaitMode& gait_mode) { return controller.GetGait(gait_mode, timeout_ms); };
+  }
+
+  /**
+   * @brief Watch a custom gait source, e.g. a local stand-in for the robot.
+   */
+  explicit GaitWatcher(GaitSource source, const GaitWatcherOptions& options = GaitWatcherOptions())
+      : options_(options), source_(std::move(source)) {}
+
+  /// Destructor, stops the watcher thread.
+  ~GaitWatcher() { Stop(); }
+
+  /**
+   * @brief Start the watcher thread.
+   * @return false if already running or no source is set.
+   */
+  bool Start() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!source_ || running_) {
+      return false;
+    }
+    lock.unlock();
+    if (watcher_.joinable()) {
+      watcher_.join();
+    }
+    lock.lock();
+    running_ = true;
+    watcher_ = std::thread(&GaitWatcher::WatchLoop, this);
+    return true;
+  }
+
+  /**
+   * @brief Stop the watcher thread, pending WaitForGait() calls return SERVICE_NOT_READY.
+   */
+  void Stop() {
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      running_ = false;
+    }
+    cv_.notify_all();
+    if (watcher_.joinable() && watcher_.get_id() != std::this_thread::get_id()) {
+      watcher_.join();
+    }
+  }
+
+  /**
+   * @brief Register a change-only gait callback, replacing any previous one. It does not start queries by itself.
+   */
+  void SubscribeGait(const GaitCallback& callback) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    callback_ = callback;
+  }
+
+  /**
+   * @brief Remove the gait callback.
+   */
+  void UnsubscribeGait() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    callback_ = nullptr;
+  }
+
+  /**
+   * @brief Deliver a gait reported by a push source. Thread-safe.
+   */
+  void Notify(GaitMode gait_mode) { Update(gait_mode); }
+
+  /**
+   * @brief Last known gait, GAIT_UNKNOWN before the first report.
+   */
+  GaitMode GetGait() const {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return gait_;
+  }
+
+  /**
+   * @brief Block until the robot reports the target gait.
+   * @param target Gait to wait for.
+   * @param timeout_ms Timeout in milliseconds.
+   * @return OK, TIMEOUT, SERVICE_NOT_READY if the watcher is not running, or the last GetGait error of this wait.
+   */
+  Status WaitForGait(GaitMode target, int timeout_ms = 5000) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!running_) {
+      return {ErrorCode::SERVICE_NOT_READY, "gait watcher is not running"};
+    }
+    ++waiters_;
+    ++demand_seq_;
+    // Discard the cached gait and error: they may predate the SetGait call this wait follows.
+    const uint64_t since = report_seq_;
+    last_error_ = {ErrorCode::OK, ""};
+    cv_.notify_all();
+    const bool reached = cv_.wait_until(lock, deadline, [&] {
+      return !running_ || (report_seq_ != since && gait_ == target);
+    });
+    --waiters_;
+    if (reached && running_) {
+      return {ErrorCode::OK, ""};
+    }
+    if (!running_) {
+      return {ErrorCode::SERVICE_NOT_READY, "gait watcher stopped"};
+    }
+    if (last_error_.code != ErrorCode::OK) {
+      return last_error_;
+    }
+    return {ErrorCode::TIMEOUT, "timed out waiting for gait " + std::to_string(static_cast<int32_t>(target))};
+  }
+
+  /// Number of gait queries issued by the watcher thread.
+  uint64_t GetPollCount() const { return polls_.load(std::memory_order_relaxed); }
+
+ private:
+  void WatchLoop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (running_) {
+      // Sleep until someone waits for a gait.
+      cv_.wait(lock, [this] { return !running_ || waiters_ > 0; });
+      if (!running_) {
+        break;
+      }
+      const uint64_t demand = demand_seq_;
+      lock.unlock();
+      GaitMode gait_mode = GaitMode::GAIT_UNKNOWN;
+      const Status status = source_(gait_mode);
+      polls_.fetch_add(1, std::memory_order_relaxed);
+      if (status.code == ErrorCode::OK) {
+        Update(gait_mode);
+      }
+      lock.lock();
+      last_error_ = status;
+      // A waiter that registered since this query started polls again at once instead of after the interval.
+      cv_.wait_for(lock, options_.poll_interval, [&] { return !running_ || demand_seq_ != demand; });
+    }
+  }
+
+  void Update(GaitMode gait_mode) {
+    GaitCallback callback;
+    GaitMode previous;
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      previous = gait_;
+      gait_ = gait_mode;
+      ++report_seq_;
+      if (previous != gait_mode) {
+        callback = callback_;
+      }
+    }
+    cv_.notify_all();
+    if (callback) {
+      callback(previous, gait_mode);
+    }
+  }
+
+  GaitWatcherOptions options_;
+  GaitSource source_;                       // Gait query
+  mutable std::mutex mutex_;                // Guards the fields below
+  std::condition_variable cv_;              // Signals gait reports, demand and Stop()
+  std::thread watcher_;                     // Watcher thread
+  bool running_ = false;
+  GaitMode gait_ = GaitMode::GAIT_UNKNOWN;  // Last reported gait
+  uint64_t report_seq_ = 0;                 // Incremented on every report
+  int waiters_ = 0;                         // Threads inside WaitForGait()
+  uint64_t demand_seq_ = 0;                 // Incremented when a WaitForGait() call registers
+  GaitCallback callback_;                   // Change callback
+  Status last_error_{ErrorCode::OK, ""};    // Status of the last query
+  std::atomic<uint64_t> polls_{0};
+};
+
+}  // namespace magic::dog::motion
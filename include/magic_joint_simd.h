@@ -0,0 +1,228 @@
+#pragma once
+
+#include "magic_type.h"
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__AVX2__)
+  #include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  #include <arm_neon.h>
+#endif
+
+namespace magic::dog::motion {
+
+/************************************************************
+ *              Structure-of-arrays joint layout            *
+ ************************************************************/
+
+constexpr std::size_t kJointSimdAlignment = 32;  ///< Alignment of SoA joint arrays (one AVX2 register)
+
+/// Aligned array of one value per leg joint.
+struct alignas(kJointSimdAlignment) JointArray {
+  double v[kLegJointNum] = {};
+
+  double& operator[](std::size_t i) { return v[i]; }
+  const double& operator[](std::size_t i) const { return v[i]; }
+};
+
+/**
+ * @brief Structure-of-arrays form of LegState.
+ */
+struct LegStateSoA {
+  int64_t timestamp = 0;  ///< Timestamp (ns)
+  JointArray q;           ///< Joint positions
+  JointArray dq;          ///< Joint velocities
+  JointArray tau_est;     ///< Estimated joint torques
+};
+
+/**
+ * @brief Structure-of-arrays form of LegJointCommand.
+ */
+struct LegCommandSoA {
+  int64_t timestamp = 0;  ///< Timestamp (ns)
+  JointArray q_des;       ///< Desired joint positions
+  JointArray dq_des;      ///< Desired joint velocities
+  JointArray tau_des;     ///< Desired feed-forward torques
+  JointArray kp;          ///< P gains
+  JointArray kd;          ///< D gains
+};
+
+/**
+ * @brief Convert LegState to its SoA form.
+ */
+inline void ToSoA(const LegState& state, LegStateSoA& soa) {
+  soa.timestamp = state.timestamp;
+  for (std::size_t i = 0; i < kLegJointNum; ++i) {
+    soa.q[i] = state.state[i].q;
+    soa.dq[i] = state.state[i].dq;
+    soa.tau_est[i] = state.state[i].tau_est;
+  }
+}
+
+/**
+ * @brief Convert SoA leg state back to LegState.
+ */
+inline void FromSoA(const LegStateSoA& soa, LegState& state) {
+  state.timestamp = soa.timestamp;
+  for (std::size_t i = 0; i < kLegJointNum; ++i) {
+    state.state[i].q = soa.q[i];
+    state.state[i].dq = soa.dq[i];
+    state.state[i].tau_est = soa.tau_est[i];
+  }
+}
+
+/**
+ * @brief Convert LegJointCommand to its SoA form.
+ */
+inline void ToSoA(const LegJointCommand& command, LegCommandSoA& soa) {
+  soa.timestamp = command.timestamp;
+  for (std::size_t i = 0; i < kLegJointNum; ++i) {
+    soa.q_des[i] = command.cmd[i].q_des;
+    soa.dq_des[i] = command.cmd[i].dq_des;
+    soa.tau_des[i] = command.cmd[i].tau_des;
+    soa.kp[i] = command.cmd[i].kp;
+    soa.kd[i] = command.cmd[i].kd;
+  }
+}
+
+/**
+ * @brief Convert SoA command back to the LegJointCommand wire type.
+ */
+inline void FromSoA(const LegCommandSoA& soa, LegJointCommand& command) {
+  command.timestamp = soa.timestamp;
+  for (std::size_t i = 0; i < kLegJointNum; ++i) {
+    command.cmd[i].q_des = soa.q_des[i];
+    command.cmd[i].dq_des = soa.dq_des[i];
+    command.cmd[i].tau_des = soa.tau_des[i];
+    command.cmd[i].kp = soa.kp[i];
+    command.cmd[i].kd = soa.kd[i];
+  }
+}
+
+/************************************************************
+ *                       Joint kernels                      *
+ ************************************************************/
+// AVX2 (4 lanes) on x86_64 and NEON (2 lanes) on aarch64, scalar otherwise.
+// kLegJointNum is a multiple of both lane counts, so there is no remainder loop.
+// The NEON path uses fused multiply-add while AVX2 and scalar round the product first (unless the compiler
+// contracts them), so JointLerp and JointPdTorque may differ in the last bit between platforms.
+// The kernels pay off when data stays in SoA form across the step: converting from and back to the AoS wire types
+// every cycle costs about as much as the kernels save (see joint_simd_example).
+static_assert(kLegJointNum % 4 == 0, "joint kernels assume a multiple of 4 joints");
+
+/**
+ * @brief out = (1 - t) * from + t * to, e.g. for pose blending.
+ */
+inline void JointLerp(const JointArray& from, const JointArray& to, double t, JointArray& out) {
+#if defined(__AVX2__)
+  const __m256d vt = _mm256_set1_pd(t);
+  for (std::size_t i = 0; i < kLegJointNum; i += 4) {
+    const __m256d a = _mm256_load_pd(from.v + i);
+    const __m256d b = _mm256_load_pd(to.v + i);
+    _mm256_store_pd(out.v + i, _mm256_add_pd(a, _mm256_mul_pd(vt, _mm256_sub_pd(b, a))));
+  }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  const float64x2_t vt = vdupq_n_f64(t);
+  for (std::size_t i = 0; i < kLegJointNum; i += 2) {
+    const float64x2_t a = vld1q_f64(from.v + i);
+    const float64x2_t b = vld1q_f64(to.v + i);
+    vst1q_f64(out.v + i, vfmaq_f64(a, vt, vsubq_f64(b, a)));
+  }
+#else
+  for (std::size_t i = 0; i < kLegJointNum; ++i) {
+    out.v[i] = from.v[i] + t * (to.v[i] - from.v[i]);
+  }
+#endif
+}
+
+/**
+ * @brief Clamp every joint value into [lower, upper].
+ *
+ * Computes min(max(v, lower), upper) with the x86 MAXPD/MINPD operand rule (the second operand wins unless the
+ * comparison holds), so a NaN value becomes lower on every build instead of passing through the clamp.
+ */
+inline void JointClamp(JointArray& values, const JointArray& lower, const JointArray& upper) {
+#if defined(__AVX2__)
+  for (std::size_t i = 0; i < kLegJointNum; i += 4) {
+    const __m256d v = _mm256_load_pd(values.v + i);
+    const __m256d lo = _mm256_load_pd(lower.v + i);
+    const __m256d hi = _mm256_load_pd(upper.v + i);
+    _mm256_store_pd(values.v + i, _mm256_min_pd(_mm256_max_pd(v, lo), hi));
+  }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  // vmaxq_f64 would propagate NaN; select explicitly to match the AVX2 and scalar paths
+  for (std::size_t i = 0; i < kLegJointNum; i += 2) {
+    const float64x2_t v = vld1q_f64(values.v + i);
+    const float64x2_t lo = vld1q_f64(lower.v + i);
+    const float64x2_t hi = vld1q_f64(upper.v + i);
+    const float64x2_t above = vbslq_f64(vcgtq_f64(v, lo), v, lo);
+    vst1q_f64(values.v + i, vbslq_f64(vcltq_f64(above, hi), above, hi));
+  }
+#else
+  for (std::size_t i = 0; i < kLegJointNum; ++i) {
+    const double v = values.v[i] > lower.v[i] ? values.v[i] : lower.v[i];
+    values.v[i] = v < upper.v[i] ? v : upper.v[i];
+  }
+#endif
+}
+
+/**
+ * @brief Clamp every joint value into [-limit, limit], with the NaN handling of JointClamp().
+ */
+inline void JointClampSymmetric(JointArray& values, double limit) {
+#if defined(__AVX2__)
+  const __m256d lo = _mm256_set1_pd(-limit);
+  const __m256d hi = _mm256_set1_pd(limit);
+  for (std::size_t i = 0; i < kLegJointNum; i += 4) {
+    _mm256_store_pd(values.v + i, _mm256_min_pd(_mm256_max_pd(_mm256_load_pd(values.v + i), lo), hi));
+  }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  const float64x2_t lo = vdupq_n_f64(-limit);
+  const float64x2_t hi = vdupq_n_f64(limit);
+  for (std::size_t i = 0; i < kLegJointNum; i += 2) {
+    const float64x2_t v = vld1q_f64(values.v + i);
+    const float64x2_t above = vbslq_f64(vcgtq_f64(v, lo), v, lo);
+    vst1q_f64(values.v + i, vbslq_f64(vcltq_f64(above, hi), above, hi));
+  }
+#else
+  for (std::size_t i = 0; i < kLegJointNum; ++i) {
+    const double v = values.v[i] > -limit ? values.v[i] : -limit;
+    values.v[i] = v < limit ? v : limit;
+  }
+#endif
+}
+
+/**
+ * @brief Evaluate the joint PD law tau = kp * (q_des - q) + kd * (dq_des - dq) + tau_des.
+ * @param command Command in SoA form.
+ * @param state Measured state in SoA form.
+ * @param tau Output joint torques.
+ */
+inline void JointPdTorque(const LegCommandSoA& command, const LegStateSoA& state, JointArray& tau) {
+#if defined(__AVX2__)
+  for (std::size_t i = 0; i < kLegJointNum; i += 4) {
+    const __m256d ep = _mm256_sub_pd(_mm256_load_pd(command.q_des.v + i), _mm256_load_pd(state.q.v + i));
+    const __m256d ev = _mm256_sub_pd(_mm256_load_pd(command.dq_des.v + i), _mm256_load_pd(state.dq.v + i));
+    __m256d t = _mm256_add_pd(_mm256_load_pd(command.tau_des.v + i), _mm256_mul_pd(_mm256_load_pd(command.kp.v + i), ep));
+    t = _mm256_add_pd(t, _mm256_mul_pd(_mm256_load_pd(command.kd.v + i), ev));
+    _mm256_store_pd(tau.v + i, t);
+  }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  for (std::size_t i = 0; i < kLegJointNum; i += 2) {
+    const float64x2_t ep = vsubq_f64(vld1q_f64(command.q_des.v + i), vld1q_f64(state.q.v + i));
+    const float64x2_t ev = vsubq_f64(vld1q_f64(command.dq_des.v + i), vld1q_f64(state.dq.v + i));
+    float64x2_t t = vfmaq_f64(vld1q_f64(command.tau_des.v + i), vld1q_f64(command.kp.v + i), ep);
+    t = vfmaq_f64(t, vld1q_f64(command.kd.v + i), ev);
+    vst1q_f64(tau.v + i, t);
+  }
+#else
+  for (std::size_t i = 0; i < kLegJointNum; ++i) {
+    tau.v[i] = command.tau_des.v[i] + command.kp.v[i] * (command.q_des.v[i] - state.q.v[i]) +
+               command.kd.v[i] * (command.dq_des.v[i] - state.dq.v[i]);
+  }
+#endif
+}
+
+}  // namespace magic::dog::motion
@@ -0,0 +1,275 @@
+#pragma once
+
+#include "magic_frame_pool.h"
+#include "magic_type.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <numbers>
+#include <string>
+
+#if defined(__AVX2__)
+  #include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  #include <arm_neon.h>
+#endif
+
+namespace magic::dog::sensor {
+
+/************************************************************
+ *                       Scan geometry                      *
+ ************************************************************/
+
+/**
+ * @brief Scale factors turning the integer LaserScan header fields into SI units.
+ *
+ * The LaserScan message does not document the units of its int32 angle, time and range fields; set these to match
+ * the firmware. Ranges and intensities (double) are taken as meters and raw intensity.
+ */
+struct LaserScanUnits {
+  double angle = 1e-6;  ///< Radians per unit of angle_min / angle_max / angle_increment (default: microradians)
+  double time = 1e-9;   ///< Seconds per unit of time_increment / scan_time (default: nanoseconds, like Header::stamp)
+  double range = 1e-3;  ///< Meters per unit of range_min / range_max (default: millimeters)
+};
+
+/**
+ * @brief Scan geometry in SI units.
+ */
+struct LaserScanGeometry {
+  float angle_min = 0.0f;                                    ///< Angle of the first beam (rad)
+  float angle_increment = 0.0f;                              ///< Angle between beams (rad)
+  float time_increment = 0.0f;                               ///< Time between beams (s)
+  float scan_time = 0.0f;                                    ///< Time between scans (s)
+  float range_min = 0.0f;                                    ///< Minimum valid range (m)
+  float range_max = std::numeric_limits<float>::infinity();  ///< Maximum valid range (m)
+  uint32_t count = 0;                                        ///< Beams per scan
+
+  /// Whether two geometries have the same beam directions.
+  bool SameBeams(const LaserScanGeometry& other) const {
+    return count == other.count && angle_min == other.angle_min && angle_increment == other.angle_increment;
+  }
+};
+
+/**
+ * @brief Geometry of a LaserScan message.
+ *
+ * If angle_increment is 0 it is derived from angle_min, angle_max and the beam count; if all three angle fields are
+ * 0 the scan is taken as a full turn starting at -pi. A range_max of 0 means unbounded.
+ */
+inline LaserScanGeometry MakeLaserScanGeometry(const LaserScan& scan, const LaserScanUnits& units = LaserScanUnits()) {
+  LaserScanGeometry geometry;
+  geometry.count = static_cast<uint32_t>(scan.ranges.size());
+  const double angle_min = scan.angle_min * units.angle;
+  const double angle_max = scan.angle_max * units.angle;
+  double increment = scan.angle_increment * units.angle;
+  if (scan.angle_increment == 0 && geometry.count > 1) {
+    increment = scan.angle_min == scan.angle_max ? 2.0 * std::numbers::pi / geometry.count : (angle_max - angle_min) / (geometry.count - 1);
+  }
+  geometry.angle_min = static_cast<float>(scan.angle_min == 0 && scan.angle_max == 0 && scan.angle_increment == 0 ? -std::numbers::pi : angle_min);
+  geometry.angle_increment = static_cast<float>(increment);
+  geometry.time_increment = static_cast<float>(scan.time_increment * units.time);
+  geometry.scan_time = static_cast<float>(scan.scan_time * units.time);
+  geometry.range_min = static_cast<float>(scan.range_min * units.range);
+  if (scan.range_max != 0) {
+    geometry.range_max = static_cast<float>(scan.range_max * units.range);
+  }
+  return geometry;
+}
+
+/************************************************************
+ *                      Compact scans                       *
+ ************************************************************/
+
+/**
+ * @brief Float32 laser scan with aligned buffers and SI geometry, half the footprint of LaserScan.
+ */
+struct CompactLaserScan {
+  Header header;                     ///< Stamp and frame of the source scan
+  LaserScanGeometry geometry;        ///< Beam geometry
+  AlignedVector<float> ranges;       ///< Ranges (m), one per beam
+  AlignedVector<float> intensities;  ///< Intensities, empty if the source had none
+};
+
+namespace detail {
+
+// out[i] = float(in[i])
+inline void NarrowToFloat(const double* in, std::size_t count, float* out) {
+  std::size_t i = 0;
+#if defined(__AVX2__)
+  for (; i + 4 <= count; i += 4) {
+    _mm_storeu_ps(out + i, _mm256_cvtpd_ps(_mm256_loadu_pd(in + i)));
+  }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  for (; i + 4 <= count; i += 4) {
+    vst1q_f32(out + i, vcvt_high_f32_f64(vcvt_f32_f64(vld1q_f64(in + i)), vld1q_f64(in + i + 2)));
+  }
+#endif
+  for (; i < count; ++i) {
+    out[i] = static_cast<float>(in[i]);
+  }
+}
+
+}  // namespace detail
+
+/**
+ * @brief Convert a LaserScan into a compact scan, reusing the destination's buffers.
+ */
+inline void ToCompactLaserScan(const LaserScan& scan, CompactLaserScan& out, const LaserScanUnits& units = LaserScanUnits()) {
+  out.header.stamp = scan.header.stamp;
+  out.header.frame_id = scan.header.frame_id;
+  out.geometry = MakeLaserScanGeometry(scan, units);
+  out.ranges.resize(scan.ranges.size());
+  detail::NarrowToFloat(scan.ranges.data(), scan.ranges.size(), out.ranges.data());
+  out.intensities.resize(scan.intensities.size());
+  detail::NarrowToFloat(scan.intensities.data(), scan.intensities.size(), out.intensities.data());
+}
+
+/**
+ * @class LaserScanPool
+ * @brief FramePool of compact scans preallocated for a beam count.
+ */
+class LaserScanPool final : public NonCopyable {
+ public:
+  /**
+   * @param size Number of pooled scans.
+   * @param beams Beams per scan to reserve, e.g. 1440 for 360 deg at 0.25 deg.
+   */
+  LaserScanPool(std::size_t size, std::size_t beams, const LaserScanUnits& units = LaserScanUnits())
+      : units_(units), pool_(size, [beams](CompactLaserScan& scan) {
+          scan.ranges.reserve(beams);
+          scan.intensities.reserve(beams);
+        }) {}
+
+  /**
+   * @brief Take a free compact scan.
+   * @return Pooled scan, or nullptr if all are in use.
+   */
+  std::shared_ptr<CompactLaserScan> Acquire() { return pool_.Acquire(); }
+
+  /**
+   * @brief Convert a LaserScan into a recycled compact scan.
+   * @return Pooled scan, or nullptr if all are in use.
+   */
+  std::shared_ptr<CompactLaserScan> CopyFrom(const LaserScan& scan) {
+    auto compact = pool_.Acquire();
+    if (compact) {
+      ToCompactLaserScan(scan, *compact, units_);
+    }
+    return compact;
+  }
+
+  /// Underlying frame pool, for statistics.
+  const FramePool<CompactLaserScan>& GetPool() const { return pool_; }
+
+ private:
+  LaserScanUnits units_;              // Units of converted scans
+  FramePool<CompactLaserScan> pool_;  // Pooled scans
+};
+
+/************************************************************
+ *                 Polar to Cartesian conversion            *
+ ************************************************************/
+
+/**
+ * @class ScanTrigTable
+ * @brief Cached cos/sin of every beam angle, rebuilt only when the beam geometry changes.
+ *
+ * Not thread-safe; use one table per converting thread.
+ */
+class ScanTrigTable {
+ public:
+  /**
+   * @brief Make the table match a geometry.
+   * @return true if the table was rebuilt.
+   */
+  bool Prepare(const LaserScanGeometry& geometry) {
+    if (valid_ && geometry_.SameBeams(geometry)) {
+      return false;
+    }
+    geometry_ = geometry;
+    cos_.resize(geometry.count);
+    sin_.resize(geometry.count);
+    for (uint32_t i = 0; i < geometry.count; ++i) {
+      const double angle = static_cast<double>(geometry.angle_min) + static_cast<double>(geometry.angle_increment) * i;
+      cos_[i] = static_cast<float>(std::cos(angle));
+      sin_[i] = static_cast<float>(std::sin(angle));
+    }
+    valid_ = true;
+    return true;
+  }
+
+  const float* Cos() const { return cos_.data(); }
+  const float* Sin() const { return sin_.data(); }
+  std::size_t Size() const { return cos_.size(); }
+
+ private:
+  LaserScanGeometry geometry_;
+  bool valid_ = false;
+  AlignedVector<float> cos_;  // cos of each beam angle
+  AlignedVector<float> sin_;  // sin of each beam angle
+};
+
+/**
+ * @brief Cartesian scan points in structure-of-arrays form, in the scan frame.
+ */
+struct LaserPoints {
+  AlignedVector<float> x;  ///< x (m), NaN for invalid beams
+  AlignedVector<float> y;  ///< y (m), NaN for invalid beams
+};
+
+/**
+ * @brief Convert ranges to Cartesian points: x = r cos(a), y = r sin(a).
+ *
+ * Beams outside [range_min, range_max], NaN or infinite (also with an unbounded range_max) become NaN, keeping beam
+ * index = point index.
+ * AVX2 (8 beams) or NEON (4 beams) per iteration, scalar otherwise.
+ * @param table Trig table, prepared for the scan's geometry here.
+ */
+inline void ScanToCartesian(const CompactLaserScan& scan, ScanTrigTable& table, LaserPoints& points) {
+  table.Prepare(scan.geometry);
+  const std::size_t count = std::min<std::size_t>(scan.ranges.size(), table.Size());
+  points.x.resize(count);
+  points.y.resize(count);
+  const float* r = scan.ranges.data();
+  const float* c = table.Cos();
+  const float* s = table.Sin();
+  float* x = points.x.data();
+  float* y = points.y.data();
+  const float range_min = scan.geometry.range_min;
+  // An unbounded range_max becomes the largest finite float, so +inf ranges fail the upper bound.
+  const float range_max = std::min(scan.geometry.range_max, std::numeric_limits<float>::max());
+  std::size_t i = 0;
+#if defined(__AVX2__)
+  const __m256 lo = _mm256_set1_ps(range_min);
+  const __m256 hi = _mm256_set1_ps(range_max);
+  const __m256 nan = _mm256_set1_ps(std::numeric_limits<float>::quiet_NaN());
+  for (; i + 8 <= count; i += 8) {
+    const __m256 range = _mm256_load_ps(r + i);
+    // Ordered compares are false for NaN ranges; infinite ranges fail range_max.
+    const __m256 valid = _mm256_and_ps(_mm256_cmp_ps(range, lo, _CMP_GE_OQ), _mm256_cmp_ps(range, hi, _CMP_LE_OQ));
+    _mm256_store_ps(x + i, _mm256_blendv_ps(nan, _mm256_mul_ps(range, _mm256_load_ps(c + i)), valid));
+    _mm256_store_ps(y + i, _mm256_blendv_ps(nan, _mm256_mul_ps(range, _mm256_load_ps(s + i)), valid));
+  }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  const float32x4_t lo = vdupq_n_f32(range_min);
+  const float32x4_t hi = vdupq_n_f32(range_max);
+  const float32x4_t nan = vdupq_n_f32(std::numeric_limits<float>::quiet_NaN());
+  for (; i + 4 <= count; i += 4) {
+    const float32x4_t range = vld1q_f32(r + i);
+    const uint32x4_t valid = vandq_u32(vcgeq_f32(range, lo), vcleq_f32(range, hi));
+    vst1q_f32(x + i, vbslq_f32(valid, vmulq_f32(range, vld1q_f32(c + i)), nan));
+    vst1q_f32(y + i, vbslq_f32(valid, vmulq_f32(range, vld1q_f32(s + i)), nan));
+  }
+#endif
+  for (; i < count; ++i) {
+    const bool valid = r[i] >= range_min && r[i] <= range_max;
+    x[i] = valid ? r[i] * c[i] : std::numeric_limits<float>::quiet_NaN();
+    y[i] = valid ? r[i] * s[i] : std::numeric_limits<float>::quiet_NaN();
+  }
+}
+
+}  // namespace magic::dog::sensor
@@ -0,0 +1,508 @@
+#pragma once
+
+#include "magic_slam_navigation.h"
+#include "magic_type.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace magic::dog::slam {
+
+/************************************************************
+ *                      Map content hash                    *
+ ************************************************************/
+
+namespace detail {
+
+// 64-bit multiply-xor hash consuming 8-byte words, fast enough to hash multi-megabyte map images on every refresh.
+inline uint64_t HashBytes(const void* data, std::size_t size, uint64_t seed) {
+  constexpr uint64_t kMultiplier = 0x9E3779B97F4A7C15ull;
+  const auto* bytes = static_cast<const uint8_t*>(data);
+  uint64_t hash = seed ^ (size * kMultiplier);
+  std::size_t i = 0;
+  for (; i + 8 <= size; i += 8) {
+    uint64_t word;
+    std::memcpy(&word, bytes + i, sizeof(word));
+    hash = (hash ^ (word * kMultiplier)) * 0xFF51AFD7ED558CCDull;
+    hash ^= hash >> 32;
+  }
+  uint64_t tail = 0;
+  // data may be null for an empty buffer, and a null memcpy source is undefined even for zero bytes.
+  if (i < size) {
+    std::memcpy(&tail, bytes + i, size - i);
+  }
+  hash = (hash ^ (tail * kMultiplier)) * 0xC4CEB9FE1A85EC53ull;
+  return hash ^ (hash >> 29);
+}
+
+}  // namespace detail
+
+/**
+ * @brief Content hash of a map: resolution, origin, image header and pixels.
+ *
+ * Equal hashes mean identical map data, so a client holding a map with the same hash can skip fetching it.
+ */
+inline uint64_t MapContentHash(const MapMetaData& meta) {
+  const MapImageData& image = meta.map_image_data;
+  uint64_t hash = detail::HashBytes(&meta.resolution, sizeof(meta.resolution), 0);
+  hash = detail::HashBytes(meta.origin.position.data(), sizeof(double) * meta.origin.position.size(), hash);
+  hash = detail::HashBytes(meta.origin.orientation.data(), sizeof(double) * meta.origin.orientation.size(), hash);
+  hash = detail::HashBytes(image.type.data(), image.type.size(), hash);
+  const uint32_t header[3] = {image.width, image.height, image.max_gray_value};
+  hash = detail::HashBytes(header, sizeof(header), hash);
+  return detail::HashBytes(image.image.data(), image.image.size(), hash);
+}
+
+/************************************************************
+ *                     Map metadata listing                 *
+ ************************************************************/
+
+/**
+ * @brief Metadata of one map without its image payload.
+ */
+struct MapSummary {
+  std::string map_name;         ///< Map name
+  double resolution = 0.0;      ///< Map resolution (m/pixel)
+  Pose3DEuler origin{};         ///< Map origin
+  uint32_t width = 0;           ///< Image width (pixels)
+  uint32_t height = 0;          ///< Image height (pixels)
+  std::size_t image_bytes = 0;  ///< Size of the image payload
+  uint64_t content_hash = 0;    ///< MapContentHash of the map
+};
+
+/**
+ * @brief Build the summary of a map.
+ */
+inline MapSummary MakeMapSummary(const MapInfo& info) {
+  MapSummary summary;
+  summary.map_name = info.map_name;
+  summary.resolution = info.map_meta_data.resolution;
+  summary.origin = info.map_meta_data.origin;
+  summary.width = info.map_meta_data.map_image_data.width;
+  summary.height = info.map_meta_data.map_image_data.height;
+  summary.image_bytes = info.map_meta_data.map_image_data.image.size();
+  summary.content_hash = MapContentHash(info.map_meta_data);
+  return summary;
+}
+
+/************************************************************
+ *                   Map regions and tiles                  *
+ ************************************************************/
+
+/**
+ * @brief Rectangular pixel region of a map image, in image row order (row 0 is the first stored row).
+ */
+struct MapRegion {
+  uint32_t x = 0;       ///< First column
+  uint32_t y = 0;       ///< First row
+  uint32_t width = 0;   ///< Columns
+  uint32_t height = 0;  ///< Rows
+};
+
+/**
+ * @brief Copy a region of a map image, clipped to the image bounds.
+ * @param image Source image (8-bit "P5" PGM pixels).
+ * @param region Requested region.
+ * @param out Region image with the same type and max_gray_value; empty if the region is outside the image.
+ * @return INTERNAL_ERROR if the source image is smaller than width * height.
+ */
+inline Status ExtractMapRegion(const MapImageData& image, const MapRegion& region, MapImageData& out) {
+  if (image.image.size() < static_cast<std::size_t>(image.width) * image.height) {
+    return {ErrorCode::INTERNAL_ERROR, "map image is smaller than width * height"};
+  }
+  const uint32_t x0 = std::min(region.x, image.width);
+  const uint32_t y0 = std::min(region.y, image.height);
+  const uint32_t x1 = static_cast<uint32_t>(std::min<uint64_t>(static_cast<uint64_t>(region.x) + region.width, image.width));
+  const uint32_t y1 = static_cast<uint32_t>(std::min<uint64_t>(static_cast<uint64_t>(region.y) + region.height, image.height));
+  out.type = image.type;
+  out.max_gray_value = image.max_gray_value;
+  out.width = x1 - x0;
+  out.height = y1 - y0;
+  out.image.resize(static_cast<std::size_t>(out.width) * out.height);
+  for (uint32_t y = y0; y < y1; ++y) {
+    std::memcpy(out.image.data() + static_cast<std::size_t>(y - y0) * out.width,
+                image.image.data() + static_cast<std::size_t>(y) * image.width + x0, out.width);
+  }
+  return {ErrorCode::OK, ""};
+}
+
+/**
+ * @brief Number of tiles along x and y for a tile size.
+ */
+inline std::pair<uint32_t, uint32_t> MapTileCount(const MapImageData& image, uint32_t tile_size) {
+  if (tile_size == 0) {
+    return {0, 0};
+  }
+  return {(image.width + tile_size - 1) / tile_size, (image.height + tile_size - 1) / tile_size};
+}
+
+/**
+ * @brief Copy one square tile of a map image; edge tiles are clipped.
+ */
+inline Status ExtractMapTile(const MapImageData& image, uint32_t tile_size, uint32_t tile_x, uint32_t tile_y, MapImageData& out) {
+  return ExtractMapRegion(image, MapRegion{tile_x * tile_size, tile_y * tile_size, tile_size, tile_size}, out);
+}
+
+/************************************************************
+ *                    Map image encoding                    *
+ ************************************************************/
+
+/// Encoding of a map image payload.
+enum class MapImageEncoding : uint32_t {
+  RAW = 0,  ///< Image bytes as in MapImageData::image
+  RLE = 1,  ///< Run-length encoded image bytes, see EncodeMapImageRle
+};
+
+namespace detail {
+
+constexpr std::size_t kRleMinRun = 4;  // Shorter runs are cheaper as literals
+constexpr std::size_t kRleMaxLiteral = 128;
+
+inline void PutVarint(std::vector<uint8_t>& out, std::size_t value) {
+  while (value >= 0x80) {
+    out.push_back(static_cast<uint8_t>(value | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<uint8_t>(value));
+}
+
+inline bool GetVarint(const uint8_t*& in, const uint8_t* end, std::size_t& value) {
+  value = 0;
+  for (unsigned shift = 0; in < end && shift < 64; shift += 7) {
+    const uint8_t byte = *in++;
+    value |= static_cast<std::size_t>(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Decoded size of an RLE stream without decoding it, false if the stream is malformed or the size overflows.
+inline bool GetRleDecodedSize(const uint8_t* data, std::size_t size, std::size_t& decoded) {
+  const uint8_t* in = data;
+  const uint8_t* end = data + size;
+  decoded = 0;
+  while (in < end) {
+    const uint8_t tag = *in++;
+    std::size_t count = 0;
+    if (tag < 0x80) {
+      count = static_cast<std::size_t>(tag) + 1;
+      if (count > static_cast<std::size_t>(end - in)) {
+        return false;
+      }
+      in += count;
+    } else {
+      if (tag != 0x80 || !GetVarint(in, end, count) || in >= end) {
+        return false;
+      }
+      ++in;
+    }
+    if (count > SIZE_MAX - decoded) {
+      return false;
+    }
+    decoded += count;
+  }
+  return true;
+}
+
+}  // namespace detail
+
+/**
+ * @brief Run-length encode map image bytes.
+ *
+ * Occupancy grids are mostly long runs of free, unknown and occupied values and typically shrink 10-50x.
+ * Stream format: tag 0x00-0x7F is a literal of tag + 1 bytes that follow; tag 0x80 is a run, followed by
+ * the run length as LEB128 varint and the repeated byte.
+ */
+inline void EncodeMapImageRle(const uint8_t* pixels, std::size_t size, std::vector<uint8_t>& out) {
+  out.clear();
+  out.reserve(size / 16 + 16);
+  std::size_t literal_start = 0;
+  auto flush_literal = [&](std::size_t literal_end) {
+    while (literal_start < literal_end) {
+      const std::size_t count = std::min(detail::kRleMaxLiteral, literal_end - literal_start);
+      out.push_back(static_cast<uint8_t>(count - 1));
+      out.insert(out.end(), pixels + literal_start, pixels + literal_start + count);
+      literal_start += count;
+    }
+  };
+  std::size_t i = 0;
+  while (i < size) {
+    const uint8_t value = pixels[i];
+    std::size_t run = 1;
+    while (i + run < size && pixels[i + run] == value) {
+      ++run;
+    }
+    if (run >= detail::kRleMinRun) {
+      flush_literal(i);
+      out.push_back(0x80);
+      detail::PutVarint(out, run);
+      out.push_back(value);
+      literal_start = i + run;
+    }
+    i += run;
+  }
+  flush_literal(size);
+}
+
+/**
+ * @brief Decode run-length encoded map image bytes.
+ * @param data Encoded stream.
+ * @param size Encoded size.
+ * @param image_size Expected decoded size.
+ * @param out Decoded bytes.
+ * @return INTERNAL_ERROR if the stream is malformed or does not decode to exactly image_size bytes.
+ */
+inline Status DecodeMapImageRle(const uint8_t* data, std::size_t size, std::size_t image_size, std::vector<uint8_t>& out) {
+  // Check the stream before allocating, so a corrupt image_size cannot trigger a huge allocation.
+  std::size_t decoded = 0;
+  if (!detail::GetRleDecodedSize(data, size, decoded) || decoded != image_size) {
+    return {ErrorCode::INTERNAL_ERROR, "corrupt RLE map image: size mismatch"};
+  }
+  try {
+    out.resize(image_size);
+  } catch (const std::bad_alloc&) {
+    return {ErrorCode::INTERNAL_ERROR, "cannot allocate " + std::to_string(image_size) + " bytes for map image"};
+  } catch (const std::length_error&) {
+    return {ErrorCode::INTERNAL_ERROR, "map image of " + std::to_string(image_size) + " bytes is too large"};
+  }
+  const uint8_t* in = data;
+  const uint8_t* end = data + size;
+  std::size_t pos = 0;
+  while (in < end) {
+    const uint8_t tag = *in++;
+    std::size_t count = 0;
+    if (tag < 0x80) {
+      count = static_cast<std::size_t>(tag) + 1;
+      if (count > static_cast<std::size_t>(end - in) || count > image_size - pos) {
+        return {ErrorCode::INTERNAL_ERROR, "corrupt RLE map image: literal overruns"};
+      }
+      std::memcpy(out.data() + pos, in, count);
+      in += count;
+    } else {
+      if (tag != 0x80 || !detail::GetVarint(in, end, count) || in >= end || count > image_size - pos) {
+        return {ErrorCode::INTERNAL_ERROR, "corrupt RLE map image: bad run"};
+      }
+      std::memset(out.data() + pos, *in++, count);
+    }
+    pos += count;
+  }
+  if (pos != image_size) {
+    return {ErrorCode::INTERNAL_ERROR, "corrupt RLE map image: size mismatch"};
+  }
+  return {ErrorCode::OK, ""};
+}
+
+/**
+ * @brief Decode an encoded map image payload of image_size bytes.
+ * @return INTERNAL_ERROR if the payload is corrupt or the image cannot be allocated; never throws on bad input.
+ */
+inline Status DecodeMapImagePayload(const uint8_t* payload, std::size_t size, MapImageEncoding encoding, std::size_t image_size,
+                                    std::vector<uint8_t>& out) {
+  switch (encoding) {
+    case MapImageEncoding::RAW:
+      if (size != image_size) {
+        return {ErrorCode::INTERNAL_ERROR, "raw map image size mismatch"};
+      }
+      out.assign(payload, payload + size);
+      return {ErrorCode::OK, ""};
+    case MapImageEncoding::RLE:
+      return DecodeMapImageRle(payload, size, image_size, out);
+  }
+  return {ErrorCode::INTERNAL_ERROR, "unsupported map image encoding"};
+}
+
+/**
+ * @brief Map image with an encoded payload, for storage and transfer.
+ *
+ * Carries the MapImageData header fields unchanged; Decode() restores the original structure.
+ */
+struct EncodedMapImage {
+  std::string type;                                   ///< Image type, copied from MapImageData
+  uint32_t width = 0;                                 ///< Image width
+  uint32_t height = 0;                                ///< Image height
+  uint32_t max_gray_value = 0;                        ///< Max gray value
+  MapImageEncoding encoding = MapImageEncoding::RAW;  ///< Payload encoding
+  std::size_t image_size = 0;                         ///< Decoded payload size (bytes)
+  std::vector<uint8_t> data;                          ///< Encoded payload
+
+  /**
+   * @brief Encode a map image.
+   */
+  static EncodedMapImage Encode(const MapImageData& image, MapImageEncoding encoding) {
+    EncodedMapImage encoded;
+    encoded.type = image.type;
+    encoded.width = image.width;
+    encoded.height = image.height;
+    encoded.max_gray_value = image.max_gray_value;
+    encoded.encoding = encoding;
+    encoded.image_size = image.image.size();
+    if (encoding == MapImageEncoding::RLE) {
+      EncodeMapImageRle(image.image.data(), image.image.size(), encoded.data);
+    } else {
+      encoded.data = image.image;
+    }
+    return encoded;
+  }
+
+  /**
+   * @brief Decode into the SDK structure.
+   */
+  Status Decode(MapImageData& image) const {
+    image.type = type;
+    image.width = width;
+    image.height = height;
+    image.max_gray_value = max_gray_value;
+    return DecodeMapImagePayload(data.data(), data.size(), encoding, image_size, image.image);
+  }
+};
+
+/************************************************************
+ *                        Map catalog                       *
+ ************************************************************/
+
+/**
+ * @class MapCatalog
+ * @brief Map listing, per-map access and region retrieval over one GetAllMapInfo transfer.
+ *
+ * Refresh() performs the single full transfer; afterwards ListMaps(), GetMap() and GetMapRegion() are served locally
+ * until the next Refresh(). Summaries carry content hashes, so GetChangedMaps() tells a client which maps it must
+ * fetch compared to its own copies.
+ */
+class MapCatalog final : public NonCopyable {
+ public:
+  /// Full map query used by Refresh().
+  using MapSource = std::function<Status(AllMapInfo&)>;
+  using MapInfoPtr = std::shared_ptr<const MapInfo>;
+
+  /**
+   * @brief Read maps from an initialized SLAM navigation controller, which must outlive this object.
+   */
+  explicit MapCatalog(SlamNavController& controller)
+      : source_([&controller](AllMapInfo& all_map_info) { return controller.GetAllMapInfo(all_map_info); }) {}
+
+  /**
+   * @brief Read maps from a custom source, e.g. a local stand-in for the robot.
+   */
+  explicit MapCatalog(MapSource source) : source_(std::move(source)) {}
+
+  /**
+   * @brief Fetch all maps from the source and rebuild the catalog.
+   */
+  Status Refresh() {
+    AllMapInfo all_map_info;
+    Status status = source_(all_map_info);
+    if (status.code != ErrorCode::OK) {
+      return status;
+    }
+    Replace(std::move(all_map_info));
+    return status;
+  }
+
+  /**
+   * @brief Replace the catalog contents with maps obtained elsewhere, e.g. from a local cache.
+   */
+  void Replace(AllMapInfo all_map_info) {
+    std::map<std::string, Entry> entries;
+    for (auto& info : all_map_info.map_infos) {
+      Entry entry;
+      entry.summary = MakeMapSummary(info);
+      entry.info = std::make_shared<const MapInfo>(std::move(info));
+      entries[entry.summary.map_name] = std::move(entry);
+    }
+    std::lock_guard<std::mutex> guard(mutex_);
+    entries_ = std::move(entries);
+    current_map_name_ = std::move(all_map_info.current_map_name);
+  }
+
+  /**
+   * @brief Drop one map from the catalog, e.g. after it was deleted on the robot.
+   */
+  void Remove(const std::string& map_name) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    entries_.erase(map_name);
+  }
+
+  /**
+   * @brief Metadata of all maps, without image payloads.
+   */
+  std::vector<MapSummary> ListMaps() const {
+    std::lock_guard<std::mutex> guard(mutex_);
+    std::vector<MapSummary> summaries;
+    summaries.reserve(entries_.size());
+    for (const auto& [name, entry] : entries_) {
+      summaries.push_back(entry.summary);
+    }
+    return summaries;
+  }
+
+  /**
+   * @brief Name of the map loaded on the robot at the last refresh.
+   */
+  std::string GetCurrentMapName() const {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return current_map_name_;
+  }
+
+  /**
+   * @brief One map with its image, shared without copying; nullptr if unknown.
+   */
+  MapInfoPtr GetMap(const std::string& map_name) const {
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto it = entries_.find(map_name);
+    return it != entries_.end() ? it->second.info : nullptr;
+  }
+
+  /**
+   * @brief Copy a region of one map's image.
+   * @return INTERNAL_ERROR if the map is unknown.
+   */
+  Status GetMapRegion(const std::string& map_name, const MapRegion& region, MapImageData& out) const {
+    MapInfoPtr info = GetMap(map_name);
+    if (!info) {
+      return {ErrorCode::INTERNAL_ERROR, "unknown map: " + map_name};
+    }
+    return ExtractMapRegion(info->map_meta_data.map_image_data, region, out);
+  }
+
+  /**
+   * @brief Names of maps whose content differs from the caller's copies (missing from known_hashes or a different hash).
+   * @param known_hashes Content hashes the caller already holds, by map name.
+   */
+  std::vector<std::string> GetChangedMaps(const std::map<std::string, uint64_t>& known_hashes) const {
+    std::lock_guard<std::mutex> guard(mutex_);
+    std::vector<std::string> changed;
+    for (const auto& [name, entry] : entries_) {
+      auto it = known_hashes.find(name);
+      if (it == known_hashes.end() || it->second != entry.summary.content_hash) {
+        changed.push_back(name);
+      }
+    }
+    return changed;
+  }
+
+ private:
+  struct Entry {
+    MapSummary summary;
+    MapInfoPtr info;
+  };
+
+  MapSource source_;                      // Full map query
+  mutable std::mutex mutex_;              // Guards entries_ and current_map_name_
+  std::map<std::string, Entry> entries_;  // Maps by name
+  std::string current_map_name_;
+};
+
+}  // namespace magic::dog::slam
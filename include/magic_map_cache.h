@@ -0,0 +1,488 @@
+#pragma once
+
+#include "magic_map.h"
+#include "magic_slam_navigation.h"
+#include "magic_type.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace magic::dog::slam {
+
+/************************************************************
+ *                      Map cache files                     *
+ ************************************************************/
+
+constexpr char kMapCacheMagic[8] = {'M', 'D', 'M', 'A', 'P', 'C', '\0', '\1'};  ///< File signature
+constexpr uint32_t kMapCacheVersion = 1;                                        ///< File layout version
+constexpr std::size_t kMapCachePayloadAlignment = 64;                           ///< Alignment of the image payload
+
+/**
+ * @brief Fixed header of a map cache file, followed by the map name and, at payload_offset, the image payload.
+ */
+struct MapCacheFileHeader {
+  char magic[8];                 ///< kMapCacheMagic
+  uint32_t version;              ///< kMapCacheVersion
+  uint32_t encoding;             ///< MapImageEncoding of the payload
+  uint64_t content_hash;         ///< MapContentHash of the map
+  double resolution;             ///< Map resolution (m/pixel)
+  double origin_position[3];     ///< Map origin position
+  double origin_orientation[3];  ///< Map origin orientation
+  char type[8];                  ///< PGM magic number, e.g. "P5"
+  uint32_t width;                ///< Image width (pixels)
+  uint32_t height;               ///< Image height (pixels)
+  uint32_t max_gray_value;       ///< Max gray value
+  uint32_t name_size;            ///< Bytes of the map name following the header
+  uint64_t payload_offset;       ///< File offset of the image payload
+  uint64_t payload_size;         ///< Bytes of the encoded image payload
+  uint64_t image_size;           ///< Bytes of the decoded image
+};
+
+namespace detail {
+
+inline Status MapCacheErrno(const std::string& what) {
+  return {ErrorCode::INTERNAL_ERROR, what + ": " + std::strerror(errno)};
+}
+
+inline bool WriteAll(int fd, const void* data, std::size_t size) {
+  const auto* bytes = static_cast<const uint8_t*>(data);
+  while (size > 0) {
+    const ssize_t written = ::write(fd, bytes, size);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    bytes += written;
+    size -= static_cast<std::size_t>(written);
+  }
+  return true;
+}
+
+}  // namespace detail
+
+/**
+ * @class MappedMapFile
+ * @brief Read-only memory mapping of one map cache file.
+ *
+ * For RAW payloads Pixels() points straight into the page cache, so opening a cached map costs no copy;
+ * RLE payloads are smaller on disk and are decoded by ToMapInfo().
+ */
+class MappedMapFile final : public NonCopyable {
+ public:
+  /**
+   * @brief Map a cache file and validate its header.
+   * @return nullptr if the file cannot be opened or is not a valid map cache file.
+   */
+  static std::shared_ptr<const MappedMapFile> Open(const std::string& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+      return nullptr;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < sizeof(MapCacheFileHeader)) {
+      ::close(fd);
+      return nullptr;
+    }
+    const std::size_t size = static_cast<std::size_t>(st.st_size);
+    void* base = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED) {
+      return nullptr;
+    }
+    std::shared_ptr<const MappedMapFile> file(new MappedMapFile(static_cast<const uint8_t*>(base), size));
+    return file->IsValid() ? file : nullptr;
+  }
+
+  ~MappedMapFile() { munmap(const_cast<uint8_t*>(base_), size_); }
+
+  /// File header.
+  const MapCacheFileHeader& Header() const { return *reinterpret_cast<const MapCacheFileHeader*>(base_); }
+
+  /// Map name.
+  std::string Name() const { return std::string(reinterpret_cast<const char*>(base_ + sizeof(MapCacheFileHeader)), Header().name_size); }
+
+  /// Encoded image payload.
+  const uint8_t* Payload() const { return base_ + Header().payload_offset; }
+
+  /// Image pixels without copying, nullptr unless the payload is RAW.
+  const uint8_t* Pixels() const { return Header().encoding == static_cast<uint32_t>(MapImageEncoding::RAW) ? Payload() : nullptr; }
+
+  /**
+   * @brief Summary of the cached map, read from the header only.
+   */
+  MapSummary Summary() const {
+    const MapCacheFileHeader& header = Header();
+    MapSummary summary;
+    summary.map_name = Name();
+    summary.resolution = header.resolution;
+    for (std::size_t i = 0; i < 3; ++i) {
+      summary.origin.position[i] = header.origin_position[i];
+      summary.origin.orientation[i] = header.origin_orientation[i];
+    }
+    summary.width = header.width;
+    summary.height = header.height;
+    summary.image_bytes = static_cast<std::size_t>(header.image_size);
+    summary.content_hash = header.content_hash;
+    return summary;
+  }
+
+  /**
+   * @brief Decode the cached map into the SDK structure.
+   */
+  Status ToMapInfo(MapInfo& info) const {
+    const MapCacheFileHeader& header = Header();
+    info.map_name = Name();
+    MapMetaData& meta = info.map_meta_data;
+    meta.resolution = header.resolution;
+    for (std::size_t i = 0; i < 3; ++i) {
+      meta.origin.position[i] = header.origin_position[i];
+      meta.origin.orientation[i] = header.origin_orientation[i];
+    }
+    MapImageData& image = meta.map_image_data;
+    image.type.assign(header.type, strnlen(header.type, sizeof(header.type)));
+    image.width = header.width;
+    image.height = header.height;
+    image.max_gray_value = header.max_gray_value;
+    return DecodeMapImagePayload(Payload(), header.payload_size, static_cast<MapImageEncoding>(header.encoding), header.image_size,
+                                 image.image);
+  }
+
+ private:
+  MappedMapFile(const uint8_t* base, std::size_t size) : base_(base), size_(size) {}
+
+  bool IsValid() const {
+    const MapCacheFileHeader& header = Header();
+    if (std::memcmp(header.magic, kMapCacheMagic, sizeof(kMapCacheMagic)) != 0 || header.version != kMapCacheVersion) {
+      return false;
+    }
+    // Bounds by subtraction, so corrupt sizes cannot wrap around.
+    if (header.payload_offset < sizeof(MapCacheFileHeader) || header.payload_offset > size_ ||
+        header.name_size > header.payload_offset - sizeof(MapCacheFileHeader) || header.payload_size > size_ - header.payload_offset) {
+      return false;
+    }
+    // One byte per pixel; two uint32 factors cannot overflow uint64.
+    if (header.image_size != static_cast<uint64_t>(header.width) * header.height || header.image_size > SIZE_MAX) {
+      return false;
+    }
+    switch (static_cast<MapImageEncoding>(header.encoding)) {
+      case MapImageEncoding::RAW:
+        // Pixels() exposes image_size bytes, which must lie inside the mapping.
+        return header.payload_size == header.image_size;
+      case MapImageEncoding::RLE:
+        return true;
+    }
+    return false;
+  }
+
+  const uint8_t* base_;  // Mapping base
+  std::size_t size_;     // Mapping size
+};
+
+/************************************************************
+ *                         Map cache                        *
+ ************************************************************/
+
+/**
+ * @class MapCache
+ * @brief Directory of memory-mappable map files keyed by map name and content hash.
+ *
+ * Each map is one file named after a hash of the map name; the header holds the content hash, so listing the
+ * cache reads a few hundred bytes per map. Files are replaced atomically (write to a temporary file, then rename).
+ */
+class MapCache final : public NonCopyable {
+ public:
+  /**
+   * @param directory Cache directory, created on first Store().
+   * @param encoding Payload encoding of stored maps: RAW is memory-mappable, RLE is typically 10-50x smaller.
+   */
+  explicit MapCache(std::string directory, MapImageEncoding encoding = MapImageEncoding::RAW)
+      : directory_(std::move(directory)), encoding_(encoding) {}
+
+  /**
+   * @brief Write a map to the cache, replacing any previous version.
+   * @return INTERNAL_ERROR if the image is not width * height bytes, as such a file would be rejected when opened.
+   */
+  Status Store(const MapInfo& info) const {
+    const MapImageData& image = info.map_meta_data.map_image_data;
+    if (image.image.size() != static_cast<uint64_t>(image.width) * image.height) {
+      return {ErrorCode::INTERNAL_ERROR, "map " + info.map_name + ": image size does not match width * height"};
+    }
+    std::error_code error;
+    std::filesystem::create_directories(directory_, error);
+    if (error) {
+      return {ErrorCode::INTERNAL_ERROR, "create " + directory_ + ": " + error.message()};
+    }
+    MapCacheFileHeader header{};
+    std::memcpy(header.magic, kMapCacheMagic, sizeof(kMapCacheMagic));
+    header.version = kMapCacheVersion;
+    header.encoding = static_cast<uint32_t>(encoding_);
+    header.content_hash = MapContentHash(info.map_meta_data);
+    header.resolution = info.map_meta_data.resolution;
+    for (std::size_t i = 0; i < 3; ++i) {
+      header.origin_position[i] = info.map_meta_data.origin.position[i];
+      header.origin_orientation[i] = info.map_meta_data.origin.orientation[i];
+    }
+    std::strncpy(header.type, image.type.c_str(), sizeof(header.type) - 1);
+    header.width = image.width;
+    header.height = image.height;
+    header.max_gray_value = image.max_gray_value;
+    header.name_size = static_cast<uint32_t>(info.map_name.size());
+    const std::size_t name_end = sizeof(header) + info.map_name.size();
+    header.payload_offset = (name_end + kMapCachePayloadAlignment - 1) / kMapCachePayloadAlignment * kMapCachePayloadAlignment;
+    std::vector<uint8_t> encoded;
+    if (encoding_ == MapImageEncoding::RLE) {
+      EncodeMapImageRle(image.image.data(), image.image.size(), encoded);
+    }
+    const std::vector<uint8_t>& payload = encoding_ == MapImageEncoding::RAW ? image.image : encoded;
+    header.payload_size = payload.size();
+    header.image_size = image.image.size();
+
+    const std::string path = PathOf(info.map_name);
+    const std::string temp_path = path + ".tmp";
+    const int fd = ::open(temp_path.c_str(), O_CREAT | O_TRUNC | O_WRONLY | O_CLOEXEC, 0644);
+    if (fd < 0) {
+      return detail::MapCacheErrno("open " + temp_path);
+    }
+    const std::vector<uint8_t> padding(header.payload_offset - name_end, 0);
+    const bool written = detail::WriteAll(fd, &header, sizeof(header)) && detail::WriteAll(fd, info.map_name.data(), info.map_name.size()) &&
+                         detail::WriteAll(fd, padding.data(), padding.size()) && detail::WriteAll(fd, payload.data(), payload.size());
+    // Flush before the rename, so a crash cannot leave a renamed but empty or partial file.
+    if (!written || ::fsync(fd) != 0) {
+      auto status = detail::MapCacheErrno("write " + temp_path);
+      ::close(fd);
+      std::remove(temp_path.c_str());
+      return status;
+    }
+    if (::close(fd) != 0) {
+      auto status = detail::MapCacheErrno("write " + temp_path);
+      std::remove(temp_path.c_str());
+      return status;
+    }
+    if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+      auto status = detail::MapCacheErrno("rename " + temp_path);
+      std::remove(temp_path.c_str());
+      return status;
+    }
+    return {ErrorCode::OK, ""};
+  }
+
+  /**
+   * @brief Map one cached map file, nullptr if the map is not cached.
+   */
+  std::shared_ptr<const MappedMapFile> Open(const std::string& map_name) const {
+    auto file = MappedMapFile::Open(PathOf(map_name));
+    return file && file->Name() == map_name ? file : nullptr;
+  }
+
+  /**
+   * @brief Summaries of all cached maps, from the file headers only.
+   */
+  std::vector<MapSummary> List() const {
+    std::vector<MapSummary> summaries;
+    for (const auto& file : OpenAll()) {
+      summaries.push_back(file->Summary());
+    }
+    return summaries;
+  }
+
+  /**
+   * @brief Content hashes of all cached maps, by map name.
+   */
+  std::map<std::string, uint64_t> GetHashes() const {
+    std::map<std::string, uint64_t> hashes;
+    for (const auto& file : OpenAll()) {
+      hashes[file->Name()] = file->Header().content_hash;
+    }
+    return hashes;
+  }
+
+  /**
+   * @brief Decode all cached maps, e.g. to fill a MapCatalog at startup without a transfer.
+   * @return INTERNAL_ERROR naming the map if a payload is corrupt; files with invalid headers are skipped.
+   */
+  Status Load(AllMapInfo& all_map_info) const {
+    all_map_info.map_infos.clear();
+    for (const auto& file : OpenAll()) {
+      MapInfo info;
+      Status status = file->ToMapInfo(info);
+      if (status.code != ErrorCode::OK) {
+        return {status.code, "map " + info.map_name + ": " + status.message};
+      }
+      all_map_info.map_infos.push_back(std::move(info));
+    }
+    return {ErrorCode::OK, ""};
+  }
+
+  /**
+   * @brief Remove a map from the cache.
+   */
+  void Invalidate(const std::string& map_name) const { std::remove(PathOf(map_name).c_str()); }
+
+  /**
+   * @brief Remove all cached maps.
+   */
+  void Clear() const {
+    for (const auto& path : ListFiles()) {
+      std::remove(path.c_str());
+    }
+  }
+
+  /// Cache directory.
+  const std::string& GetDirectory() const { return directory_; }
+
+ private:
+  std::string PathOf(const std::string& map_name) const {
+    char file_name[32];
+    std::snprintf(file_name, sizeof(file_name), "%016llx.map",
+                  static_cast<unsigned long long>(detail::HashBytes(map_name.data(), map_name.size(), 0)));
+    return (std::filesystem::path(directory_) / file_name).string();
+  }
+
+  std::vector<std::string> ListFiles() const {
+    std::vector<std::string> paths;
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(directory_, error)) {
+      if (entry.path().extension() == ".map") {
+        paths.push_back(entry.path().string());
+      }
+    }
+    return paths;
+  }
+
+  std::vector<std::shared_ptr<const MappedMapFile>> OpenAll() const {
+    std::vector<std::shared_ptr<const MappedMapFile>> files;
+    for (const auto& path : ListFiles()) {
+      if (auto file = MappedMapFile::Open(path)) {
+        files.push_back(std::move(file));
+      }
+    }
+    return files;
+  }
+
+  std::string directory_;
+  MapImageEncoding encoding_;  // Payload encoding of stored maps
+};
+
+/************************************************************
+ *                     Cached map store                     *
+ ************************************************************/
+
+/**
+ * @class CachedMapStore
+ * @brief MapCatalog backed by a MapCache, with cache invalidation on SaveMap / DeleteMap.
+ *
+ * Open() fills the catalog from disk, so listing maps after a restart needs no transfer. Validate() refreshes
+ * from the robot and rewrites only maps whose content hash changed, and removes maps deleted on the robot.
+ */
+class CachedMapStore final : public NonCopyable {
+ public:
+  /// Map command forwarded to the robot, e.g. SaveMap or DeleteMap.
+  using MapCommand = std::function<Status(const std::string&)>;
+
+  /**
+   * @brief Store maps of an initialized SLAM navigation controller, which must outlive this object.
+   */
+  CachedMapStore(SlamNavController& controller, const std::string& directory, MapImageEncoding encoding = MapImageEncoding::RAW)
+      : CachedMapStore([&controller](AllMapInfo& all_map_info) { return controller.GetAllMapInfo(all_map_info); },
+                       [&controller](const std::string& map_name) { return controller.SaveMap(map_name); },
+                       [&controller](const std::string& map_name) { return controller.DeleteMap(map_name); }, directory, encoding) {}
+
+  /**
+   * @brief Store maps of custom sources, e.g. a local stand-in for the robot.
+   */
+  CachedMapStore(MapCatalog::MapSource source, MapCommand save_map, MapCommand delete_map, const std::string& directory,
+                 MapImageEncoding encoding = MapImageEncoding::RAW)
+      : catalog_(std::move(source)), save_map_(std::move(save_map)), delete_map_(std::move(delete_map)), cache_(directory, encoding) {}
+
+  /**
+   * @brief Fill the catalog from the on-disk cache, no transfer.
+   */
+  Status Open() {
+    AllMapInfo all_map_info;
+    Status status = cache_.Load(all_map_info);
+    if (status.code != ErrorCode::OK) {
+      return status;
+    }
+    catalog_.Replace(std::move(all_map_info));
+    return status;
+  }
+
+  /**
+   * @brief Refresh from the robot and bring the cache in line with it.
+   */
+  Status Validate() {
+    Status status = catalog_.Refresh();
+    if (status.code != ErrorCode::OK) {
+      return status;
+    }
+    const auto cached = cache_.GetHashes();
+    for (const auto& name : catalog_.GetChangedMaps(cached)) {
+      if (auto info = catalog_.GetMap(name)) {
+        status = cache_.Store(*info);
+        if (status.code != ErrorCode::OK) {
+          return status;
+        }
+      }
+    }
+    for (const auto& [name, hash] : cached) {
+      if (!catalog_.GetMap(name)) {
+        cache_.Invalidate(name);
+      }
+    }
+    return {ErrorCode::OK, ""};
+  }
+
+  /**
+   * @brief Save the current map on the robot and drop its cached copy and catalog entry; Validate() fetches the new one.
+   */
+  Status SaveMap(const std::string& map_name) {
+    Status status = save_map_(map_name);
+    if (status.code == ErrorCode::OK) {
+      cache_.Invalidate(map_name);
+      catalog_.Remove(map_name);
+    }
+    return status;
+  }
+
+  /**
+   * @brief Delete a map on the robot and, if that succeeded, from the cache.
+   */
+  Status DeleteMap(const std::string& map_name) {
+    Status status = delete_map_(map_name);
+    if (status.code == ErrorCode::OK) {
+      cache_.Invalidate(map_name);
+      catalog_.Remove(map_name);
+    }
+    return status;
+  }
+
+  /// Catalog served from the cache and the last validation.
+  const MapCatalog& GetCatalog() const { return catalog_; }
+
+  /// Underlying on-disk cache.
+  const MapCache& GetCache() const { return cache_; }
+
+ private:
+  MapCatalog catalog_;
+  MapCommand save_map_;
+  MapCommand delete_map_;
+  MapCache cache_;
+};
+
+}  // namespace magic::dog::slam
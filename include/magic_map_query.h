@@ -0,0 +1,532 @@
+#pragma once
+
+#include "magic_dispatch.h"
+#include "magic_type.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#if defined(__AVX2__)
+  #include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  #include <arm_neon.h>
+#endif
+
+namespace magic::dog::slam {
+
+/************************************************************
+ *                         Map frame                        *
+ ************************************************************/
+
+/// Cell coordinates: x to the right and y up, counted from the lower-left pixel of the map image.
+struct MapCell {
+  int32_t x = 0;
+  int32_t y = 0;
+};
+
+/// Point in the map's world frame (m).
+struct MapPoint {
+  double x = 0.0;
+  double y = 0.0;
+};
+
+/**
+ * @class MapFrame
+ * @brief World <-> cell conversion for a map, from MapMetaData::resolution and origin.
+ *
+ * The origin is the world pose of the lower-left corner of the image; its yaw rotates the grid. Image rows are stored
+ * top to bottom, so cell y maps to image row height - 1 - y.
+ */
+class MapFrame {
+ public:
+  MapFrame() = default;
+
+  explicit MapFrame(const MapMetaData& meta)
+      : resolution_(meta.resolution),
+        width_(static_cast<int32_t>(meta.map_image_data.width)),
+        height_(static_cast<int32_t>(meta.map_image_data.height)),
+        origin_x_(meta.origin.position[0]),
+        origin_y_(meta.origin.position[1]),
+        cos_yaw_(std::cos(meta.origin.orientation[2])),
+        sin_yaw_(std::sin(meta.origin.orientation[2])) {}
+
+  double GetResolution() const { return resolution_; }
+  int32_t GetWidth() const { return width_; }
+  int32_t GetHeight() const { return height_; }
+
+  /// Whether a cell lies inside the map.
+  bool Contains(const MapCell& cell) const { return cell.x >= 0 && cell.y >= 0 && cell.x < width_ && cell.y < height_; }
+
+  /**
+   * @brief World point to continuous map coordinates in cells (not bounds-checked).
+   */
+  void WorldToMap(double x, double y, double& map_x, double& map_y) const {
+    const double dx = x - origin_x_;
+    const double dy = y - origin_y_;
+    map_x = (cos_yaw_ * dx + sin_yaw_ * dy) / resolution_;
+    map_y = (-sin_yaw_ * dx + cos_yaw_ * dy) / resolution_;
+  }
+
+  /**
+   * @brief Map-grid point (cells) to the cell containing it.
+   * @return false if the point is outside the map (cell is still set), or not finite or beyond the int32 cell range
+   *         (cell is set to {-1, -1}).
+   */
+  bool MapToCell(double map_x, double map_y, MapCell& cell) const {
+    constexpr double kMin = std::numeric_limits<int32_t>::min();
+    constexpr double kMax = std::numeric_limits<int32_t>::max();
+    const double floor_x = std::floor(map_x);
+    const double floor_y = std::floor(map_y);
+    // Converting NaN, infinity or an out-of-range value to int32 is undefined; the comparisons are false for NaN.
+    if (!(floor_x >= kMin && floor_x <= kMax && floor_y >= kMin && floor_y <= kMax)) {
+      cell = {-1, -1};
+      return false;
+    }
+    cell.x = static_cast<int32_t>(floor_x);
+    cell.y = static_cast<int32_t>(floor_y);
+    return Contains(cell);
+  }
+
+  /**
+   * @brief World point to the cell containing it.
+   * @return false if the point is outside the map or not finite, see MapToCell().
+   */
+  bool WorldToCell(double x, double y, MapCell& cell) const {
+    double map_x = 0.0;
+    double map_y = 0.0;
+    WorldToMap(x, y, map_x, map_y);
+    return MapToCell(map_x, map_y, cell);
+  }
+
+  /**
+   * @brief World position of a cell center.
+   */
+  MapPoint CellToWorld(const MapCell& cell) const {
+    const double map_x = (cell.x + 0.5) * resolution_;
+    const double map_y = (cell.y + 0.5) * resolution_;
+    return {origin_x_ + cos_yaw_ * map_x - sin_yaw_ * map_y, origin_y_ + sin_yaw_ * map_x + cos_yaw_ * map_y};
+  }
+
+  /**
+   * @brief Rotate a world-frame heading into the map grid.
+   */
+  double WorldToMapAngle(double angle) const { return angle - std::atan2(sin_yaw_, cos_yaw_); }
+
+  /**
+   * @brief Index of a cell in MapImageData::image.
+   */
+  std::size_t PixelIndex(const MapCell& cell) const {
+    return static_cast<std::size_t>(height_ - 1 - cell.y) * static_cast<std::size_t>(width_) + static_cast<std::size_t>(cell.x);
+  }
+
+ private:
+  double resolution_ = 1.0;
+  int32_t width_ = 0;
+  int32_t height_ = 0;
+  double origin_x_ = 0.0;
+  double origin_y_ = 0.0;
+  double cos_yaw_ = 1.0;
+  double sin_yaw_ = 0.0;
+};
+
+/************************************************************
+ *                       Tiled storage                      *
+ ************************************************************/
+
+/**
+ * @class TiledGrid
+ * @brief 2D grid stored in 16x16-cell tiles, so neighbouring cells in both directions share cache lines.
+ */
+template <typename T>
+class TiledGrid {
+ public:
+  static constexpr uint32_t kTileBits = 4;
+  static constexpr uint32_t kTileSize = 1u << kTileBits;  ///< Tile edge in cells
+  static constexpr uint32_t kTileMask = kTileSize - 1;
+
+  TiledGrid() = default;
+
+  TiledGrid(uint32_t width, uint32_t height, T fill) { Reset(width, height, fill); }
+
+  /// Resize to width x height cells, all set to fill.
+  void Reset(uint32_t width, uint32_t height, T fill) {
+    width_ = width;
+    height_ = height;
+    tiles_x_ = (width + kTileMask) >> kTileBits;
+    const std::size_t tiles_y = (height + kTileMask) >> kTileBits;
+    cells_.assign(tiles_x_ * tiles_y << (2 * kTileBits), fill);
+  }
+
+  uint32_t GetWidth() const { return width_; }
+  uint32_t GetHeight() const { return height_; }
+
+  /// Cell value; x < width and y < height.
+  T Get(uint32_t x, uint32_t y) const { return cells_[Index(x, y)]; }
+
+  /// Set a cell; x < width and y < height.
+  void Set(uint32_t x, uint32_t y, T value) { cells_[Index(x, y)] = value; }
+
+ private:
+  std::size_t Index(uint32_t x, uint32_t y) const {
+    const std::size_t tile = static_cast<std::size_t>(y >> kTileBits) * tiles_x_ + (x >> kTileBits);
+    return (tile << (2 * kTileBits)) | ((y & kTileMask) << kTileBits) | (x & kTileMask);
+  }
+
+  uint32_t width_ = 0;
+  uint32_t height_ = 0;
+  std::size_t tiles_x_ = 0;  // Tiles per tile row
+  std::vector<T> cells_;     // Tile-major cells
+};
+
+/************************************************************
+ *                     Distance transform                   *
+ ************************************************************/
+
+namespace detail {
+
+// out[i] = min(out[i], prev[i] + 1) over a row; AVX2 (8 lanes), NEON (4 lanes), scalar remainder.
+inline void MinPlusOneRow(float* out, const float* prev, std::size_t count) {
+  std::size_t i = 0;
+#if defined(__AVX2__)
+  const __m256 one = _mm256_set1_ps(1.0f);
+  for (; i + 8 <= count; i += 8) {
+    const __m256 candidate = _mm256_add_ps(_mm256_loadu_ps(prev + i), one);
+    _mm256_storeu_ps(out + i, _mm256_min_ps(_mm256_loadu_ps(out + i), candidate));
+  }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  const float32x4_t one = vdupq_n_f32(1.0f);
+  for (; i + 4 <= count; i += 4) {
+    const float32x4_t candidate = vaddq_f32(vld1q_f32(prev + i), one);
+    vst1q_f32(out + i, vminq_f32(vld1q_f32(out + i), candidate));
+  }
+#endif
+  for (; i < count; ++i) {
+    out[i] = std::min(out[i], prev[i] + 1.0f);
+  }
+}
+
+// values[i] = values[i]^2 over a row.
+inline void SquareRow(float* values, std::size_t count) {
+  std::size_t i = 0;
+#if defined(__AVX2__)
+  for (; i + 8 <= count; i += 8) {
+    const __m256 v = _mm256_loadu_ps(values + i);
+    _mm256_storeu_ps(values + i, _mm256_mul_ps(v, v));
+  }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  for (; i + 4 <= count; i += 4) {
+    const float32x4_t v = vld1q_f32(values + i);
+    vst1q_f32(values + i, vmulq_f32(v, v));
+  }
+#endif
+  for (; i < count; ++i) {
+    values[i] *= values[i];
+  }
+}
+
+// Exact 1D squared distance transform of f (Felzenszwalb & Huttenlocher), using scratch v (n) and z (n + 1).
+// Parabola intersections are computed in double: f holds squared distances up to (width + height)^2.
+inline void DistanceTransform1D(const float* f, std::size_t n, float* d, int32_t* v, double* z) {
+  auto intersect = [f](std::size_t q, int32_t p) {
+    const double dq = static_cast<double>(q);
+    const double dp = static_cast<double>(p);
+    return ((f[q] + dq * dq) - (f[p] + dp * dp)) / (2.0 * (dq - dp));
+  };
+  std::size_t k = 0;
+  v[0] = 0;
+  z[0] = -std::numeric_limits<double>::infinity();
+  z[1] = std::numeric_limits<double>::infinity();
+  for (std::size_t q = 1; q < n; ++q) {
+    double s = intersect(q, v[k]);
+    while (s <= z[k]) {
+      --k;
+      s = intersect(q, v[k]);
+    }
+    ++k;
+    v[k] = static_cast<int32_t>(q);
+    z[k] = s;
+    z[k + 1] = std::numeric_limits<double>::infinity();
+  }
+  k = 0;
+  for (std::size_t q = 0; q < n; ++q) {
+    while (z[k + 1] < static_cast<double>(q)) {
+      ++k;
+    }
+    const double delta = static_cast<double>(q) - v[k];
+    d[q] = static_cast<float>(delta * delta + f[v[k]]);
+  }
+}
+
+}  // namespace detail
+
+/************************************************************
+ *                      Occupancy grid                      *
+ ************************************************************/
+
+/// Occupancy class of a map cell.
+enum class CellOccupancy : uint8_t {
+  FREE = 0,
+  UNKNOWN = 1,
+  OCCUPIED = 2,
+};
+
+/**
+ * @brief OccupancyGrid options.
+ */
+struct OccupancyGridOptions {
+  double occupied_threshold = 0.65;  ///< Occupancy probability (max_gray_value - pixel) / max_gray_value above which a cell is occupied
+  double free_threshold = 0.196;     ///< Occupancy probability below which a cell is free
+  bool unknown_is_obstacle = true;   ///< Whether unknown cells block rays and count in the distance layer
+  std::size_t threads = 0;           ///< Worker threads for batch queries and Load(), 0 for hardware concurrency
+  std::size_t min_batch_chunk = 256; ///< Minimum queries per worker task
+};
+
+/// Ray for batch ray casting, in the map's world frame.
+struct MapRay {
+  double x = 0.0;          ///< Start x (m)
+  double y = 0.0;          ///< Start y (m)
+  double angle = 0.0;      ///< Heading (rad)
+  double max_range = 0.0;  ///< Maximum range (m)
+};
+
+/**
+ * @class OccupancyGrid
+ * @brief Occupancy and obstacle-distance queries over MapMetaData.
+ *
+ * Load() classifies the image into tiled occupancy storage and computes an exact Euclidean distance layer (meters
+ * to the nearest obstacle), so a clearance check for any robot radius is one lookup. Batch queries are split across
+ * a worker pool. All query methods are const and thread-safe; Load() must not run concurrently with queries.
+ */
+class OccupancyGrid final : public NonCopyable {
+ public:
+  explicit OccupancyGrid(const OccupancyGridOptions& options = OccupancyGridOptions()) : options_(options) {
+    std::size_t threads = options_.threads != 0 ? options_.threads : std::max(1u, std::thread::hardware_concurrency());
+    // The calling thread runs one share of every batch.
+    if (threads > 1) {
+      executor_ = std::make_unique<Executor>(ExecutorOptions{"map_query", threads - 1, {}, SCHED_OTHER, 0});
+    }
+  }
+
+  /**
+   * @brief Build the occupancy and distance layers from a map.
+   * @return INTERNAL_ERROR if the resolution is not positive or the image is smaller than width * height.
+   */
+  Status Load(const MapMetaData& meta) {
+    const MapImageData& image = meta.map_image_data;
+    const std::size_t width = image.width;
+    const std::size_t height = image.height;
+    if (!(meta.resolution > 0.0)) {
+      return {ErrorCode::INTERNAL_ERROR, "map resolution must be positive"};
+    }
+    if (image.image.size() < width * height) {
+      return {ErrorCode::INTERNAL_ERROR, "map image is smaller than width * height"};
+    }
+    frame_ = MapFrame(meta);
+
+    // Pixel value -> occupancy class
+    CellOccupancy classes[256];
+    const double max_gray = image.max_gray_value != 0 ? image.max_gray_value : 255.0;
+    for (int value = 0; value < 256; ++value) {
+      const double occupancy = (max_gray - std::min<double>(value, max_gray)) / max_gray;
+      classes[value] = occupancy > options_.occupied_threshold ? CellOccupancy::OCCUPIED
+                       : occupancy < options_.free_threshold   ? CellOccupancy::FREE
+                                                               : CellOccupancy::UNKNOWN;
+    }
+
+    // Occupancy layer, plus the vertical distance pass over a row-major buffer (row y is cell row y).
+    occupancy_.Reset(static_cast<uint32_t>(width), static_cast<uint32_t>(height), CellOccupancy::UNKNOWN);
+    const float far = static_cast<float>(width + height);
+    std::vector<float> field(width * height);
+    for (std::size_t y = 0; y < height; ++y) {
+      const uint8_t* row = image.image.data() + (height - 1 - y) * width;
+      float* out = field.data() + y * width;
+      for (std::size_t x = 0; x < width; ++x) {
+        const CellOccupancy occupancy = classes[row[x]];
+        occupancy_.Set(static_cast<uint32_t>(x), static_cast<uint32_t>(y), occupancy);
+        out[x] = IsObstacle(occupancy) ? 0.0f : far;
+      }
+    }
+    for (std::size_t y = 1; y < height; ++y) {
+      detail::MinPlusOneRow(field.data() + y * width, field.data() + (y - 1) * width, width);
+    }
+    for (std::size_t y = height; y-- > 1;) {
+      detail::MinPlusOneRow(field.data() + (y - 1) * width, field.data() + y * width, width);
+    }
+    for (std::size_t y = 0; y < height; ++y) {
+      detail::SquareRow(field.data() + y * width, width);
+    }
+
+    // Horizontal pass per row, rows split across workers.
+    distance_.Reset(static_cast<uint32_t>(width), static_cast<uint32_t>(height), 0.0f);
+    const float resolution = static_cast<float>(meta.resolution);
+    ParallelFor(height, 1, [&](std::size_t begin, std::size_t end) {
+      std::vector<float> d(width);
+      std::vector<int32_t> v(width);
+      std::vector<double> z(width + 1);
+      for (std::size_t y = begin; y < end; ++y) {
+        detail::DistanceTransform1D(field.data() + y * width, width, d.data(), v.data(), z.data());
+        for (std::size_t x = 0; x < width; ++x) {
+          distance_.Set(static_cast<uint32_t>(x), static_cast<uint32_t>(y), std::sqrt(d[x]) * resolution);
+        }
+      }
+    });
+    return {ErrorCode::OK, ""};
+  }
+
+  /// World <-> cell conversion of the loaded map.
+  const MapFrame& GetFrame() const { return frame_; }
+
+  /**
+   * @brief Occupancy at a world point, UNKNOWN outside the map.
+   */
+  CellOccupancy GetOccupancy(double x, double y) const {
+    MapCell cell;
+    if (!frame_.WorldToCell(x, y, cell)) {
+      return CellOccupancy::UNKNOWN;
+    }
+    return occupancy_.Get(static_cast<uint32_t>(cell.x), static_cast<uint32_t>(cell.y));
+  }
+
+  /**
+   * @brief Distance (m) from a world point's cell to the nearest obstacle cell, 0 outside the map.
+   */
+  double GetDistance(double x, double y) const {
+    MapCell cell;
+    if (!frame_.WorldToCell(x, y, cell)) {
+      return 0.0;
+    }
+    return distance_.Get(static_cast<uint32_t>(cell.x), static_cast<uint32_t>(cell.y));
+  }
+
+  /**
+   * @brief Whether a robot of the given clearance radius (m) fits at a world point: the cell is FREE and no obstacle
+   * lies closer than clearance.
+   */
+  bool IsFree(double x, double y, double clearance) const {
+    MapCell cell;
+    if (!frame_.WorldToCell(x, y, cell)) {
+      return false;
+    }
+    const uint32_t cx = static_cast<uint32_t>(cell.x);
+    const uint32_t cy = static_cast<uint32_t>(cell.y);
+    return occupancy_.Get(cx, cy) == CellOccupancy::FREE && distance_.Get(cx, cy) >= clearance;
+  }
+
+  /**
+   * @brief Distance along a ray to the first obstacle cell.
+   * @return Hit distance (m), or max_range if nothing is hit within max_range or the ray starts outside or leaves the map.
+   */
+  double CastRay(double x, double y, double angle, double max_range) const {
+    double map_x = 0.0;
+    double map_y = 0.0;
+    frame_.WorldToMap(x, y, map_x, map_y);
+    const double heading = frame_.WorldToMapAngle(angle);
+    const double dir_x = std::cos(heading);
+    const double dir_y = std::sin(heading);
+    const double max_t = max_range / frame_.GetResolution();
+    MapCell cell;
+    if (!frame_.MapToCell(map_x, map_y, cell)) {
+      return max_range;
+    }
+
+    // Amanatides & Woo grid traversal, t in cells along the ray.
+    constexpr double kInf = std::numeric_limits<double>::infinity();
+    const int32_t step_x = dir_x > 0.0 ? 1 : -1;
+    const int32_t step_y = dir_y > 0.0 ? 1 : -1;
+    const double delta_x = dir_x != 0.0 ? 1.0 / std::abs(dir_x) : kInf;
+    const double delta_y = dir_y != 0.0 ? 1.0 / std::abs(dir_y) : kInf;
+    double next_x = dir_x != 0.0 ? (dir_x > 0.0 ? cell.x + 1 - map_x : map_x - cell.x) * delta_x : kInf;
+    double next_y = dir_y != 0.0 ? (dir_y > 0.0 ? cell.y + 1 - map_y : map_y - cell.y) * delta_y : kInf;
+    double t = 0.0;
+    while (t <= max_t && frame_.Contains(cell)) {
+      if (IsObstacle(occupancy_.Get(static_cast<uint32_t>(cell.x), static_cast<uint32_t>(cell.y)))) {
+        return t * frame_.GetResolution();
+      }
+      if (next_x < next_y) {
+        t = next_x;
+        next_x += delta_x;
+        cell.x += step_x;
+      } else {
+        t = next_y;
+        next_y += delta_y;
+        cell.y += step_y;
+      }
+    }
+    return max_range;
+  }
+
+  /**
+   * @brief Occupancy of many world points.
+   */
+  void QueryOccupancy(const std::vector<MapPoint>& points, std::vector<CellOccupancy>& out) const {
+    out.resize(points.size());
+    ParallelFor(points.size(), options_.min_batch_chunk, [&](std::size_t begin, std::size_t end) {
+      for (std::size_t i = begin; i < end; ++i) {
+        out[i] = GetOccupancy(points[i].x, points[i].y);
+      }
+    });
+  }
+
+  /**
+   * @brief Obstacle distance (m) of many world points.
+   */
+  void QueryDistance(const std::vector<MapPoint>& points, std::vector<float>& out) const {
+    out.resize(points.size());
+    ParallelFor(points.size(), options_.min_batch_chunk, [&](std::size_t begin, std::size_t end) {
+      for (std::size_t i = begin; i < end; ++i) {
+        out[i] = static_cast<float>(GetDistance(points[i].x, points[i].y));
+      }
+    });
+  }
+
+  /**
+   * @brief IsFree() for many candidate navigation targets.
+   * @param targets Candidate targets; the goal position is used, the frame is assumed to be the map frame.
+   * @param clearance Robot clearance radius (m).
+   * @param free 1 for each target that fits, 0 otherwise.
+   */
+  void CheckNavTargets(const std::vector<NavTarget>& targets, double clearance, std::vector<uint8_t>& free) const {
+    free.resize(targets.size());
+    ParallelFor(targets.size(), options_.min_batch_chunk, [&](std::size_t begin, std::size_t end) {
+      for (std::size_t i = begin; i < end; ++i) {
+        free[i] = IsFree(targets[i].goal.position[0], targets[i].goal.position[1], clearance) ? 1 : 0;
+      }
+    });
+  }
+
+  /**
+   * @brief CastRay() for many rays.
+   */
+  void CastRays(const std::vector<MapRay>& rays, std::vector<float>& ranges) const {
+    ranges.resize(rays.size());
+    ParallelFor(rays.size(), options_.min_batch_chunk / 4, [&](std::size_t begin, std::size_t end) {
+      for (std::size_t i = begin; i < end; ++i) {
+        ranges[i] = static_cast<float>(CastRay(rays[i].x, rays[i].y, rays[i].angle, rays[i].max_range));
+      }
+    });
+  }
+
+ private:
+  bool IsObstacle(CellOccupancy occupancy) const {
+    return occupancy == CellOccupancy::OCCUPIED || (options_.unknown_is_obstacle && occupancy == CellOccupancy::UNKNOWN);
+  }
+
+  template <typename Body>
+  void ParallelFor(std::size_t count, std::size_t min_chunk, const Body& body) const {
+    magic::dog::ParallelFor(executor_.get(), count, min_chunk, body);
+  }
+
+  OccupancyGridOptions options_;
+  std::unique_ptr<Executor> executor_;   // Batch workers, nullptr when single-threaded
+  MapFrame frame_;
+  TiledGrid<CellOccupancy> occupancy_;   // Occupancy class per cell
+  TiledGrid<float> distance_;            // Distance to the nearest obstacle cell (m)
+};
+
+}  // namespace magic::dog::slam
@@ -0,0 +1,553 @@
+#pragma once
+
+#include "magic_motion.h"
+#include "magic_realtime.h"
+#include "magic_type.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+
+namespace magic::dog::motion {
+
+/************************************************************
+ *                   Leg command wire format                *
+ ************************************************************/
+
+constexpr std::size_t kSingleLegJointCommandFields = 5;  ///< q_des, dq_des, tau_des, kp, kd
+constexpr std::size_t kLegJointCommandWireSize =
+    sizeof(int64_t) + kLegJointNum * kSingleLegJointCommandFields * sizeof(double);  ///< Bytes per serialized command
+
+/**
+ * @brief Fixed-size serialized LegJointCommand (host byte order).
+ *
+ * Layout: timestamp, then for each joint q_des, dq_des, tau_des, kp, kd.
+ */
+using LegJointCommandWire = std::array<uint8_t, kLegJointCommandWireSize>;
+
+/**
+ * @brief Serialize a leg command into a fixed wire buffer, never allocates.
+ */
+inline void SerializeLegJointCommand(const LegJointCommand& command, LegJointCommandWire& wire) noexcept {
+  uint8_t* out = wire.data();
+  std::memcpy(out, &command.timestamp, sizeof(int64_t));
+  out += sizeof(int64_t);
+  for (const auto& joint : command.cmd) {
+    const double fields[kSingleLegJointCommandFields] = {joint.q_des, joint.dq_des, joint.tau_des, joint.kp, joint.kd};
+    std::memcpy(out, fields, sizeof(fields));
+    out += sizeof(fields);
+  }
+}
+
+/**
+ * @brief Deserialize a leg command from a fixed wire buffer, never allocates.
+ */
+inline void DeserializeLegJointCommand(const LegJointCommandWire& wire, LegJointCommand& command) noexcept {
+  const uint8_t* in = wire.data();
+  std::memcpy(&command.timestamp, in, sizeof(int64_t));
+  in += sizeof(int64_t);
+  for (auto& joint : command.cmd) {
+    double fields[kSingleLegJointCommandFields];
+    std::memcpy(fields, in, sizeof(fields));
+    in += sizeof(fields);
+    joint.q_des = fields[0];
+    joint.dq_des = fields[1];
+    joint.tau_des = fields[2];
+    joint.kp = fields[3];
+    joint.kd = fields[4];
+  }
+}
+
+/************************************************************
+ *                 Sense-to-act latency tracing             *
+ ************************************************************/
+
+/**
+ * @brief Stages measured by LegLatencyTracer.
+ */
+enum class LegLatencyStage : int8_t {
+  TRANSPORT_RECEIVE = 0,  ///< LegState::timestamp to arrival in the SDK callback
+  CALLBACK_DISPATCH = 1,  ///< Arrival in the SDK callback to pickup by the control thread
+  USER_COMPUTE = 2,       ///< Pickup by the control thread to publishing the resulting command
+  END_TO_END = 3,         ///< Arrival in the SDK callback to publishing the resulting command
+};
+
+constexpr std::size_t kLegLatencyStageNum = 4;  ///< Number of LegLatencyStage values
+
+/**
+ * @brief Correlation between a published command and the state sample it was computed from.
+ */
+struct LegLatencyRecord {
+  int64_t state_timestamp = 0;    ///< LegState::timestamp of the source sample (ns)
+  int64_t command_timestamp = 0;  ///< LegJointCommand::timestamp of the published command (ns)
+  int64_t receive_ns = 0;         ///< Transport receive latency (ns)
+  int64_t dispatch_ns = 0;        ///< Callback dispatch latency (ns)
+  int64_t compute_ns = 0;         ///< User compute time (ns)
+};
+
+/**
+ * @brief Options of LegLatencyTracer.
+ */
+struct LegLatencyTracerOptions {
+  /**
+   * @brief Offset added to LegState::timestamp to map it onto the local system clock (ns).
+   *
+   * Transport receive latency is measured against std::chrono::system_clock, so the robot and the PC clocks
+   * should be synchronized (e.g. via NTP/PTP), or the known offset set here.
+   */
+  int64_t clock_offset_ns = 0;
+};
+
+/**
+ * @class LegLatencyTracer
+ * @brief Sense-to-act latency instrumentation for the low-level leg control path.
+ *
+ * Set it on a LegStateMailbox and a RealtimeLegCommandPublisher (SetTracer) to correlate each published command
+ * with the leg state sample it was computed from. Running histograms are kept for transport receive latency,
+ * callback dispatch latency, user compute time and the overall callback-to-publish latency.
+ * All hooks are lock-free and allocation-free.
+ *
+ * Threading: OnStateReceived() is called from the SDK callback thread, OnStateConsumed() and OnCommandPublished()
+ * from the control thread. Queries and DumpToFile() may be called from any thread.
+ */
+class LegLatencyTracer final : public NonCopyable {
+ public:
+  explicit LegLatencyTracer(const LegLatencyTracerOptions& options = LegLatencyTracerOptions()) : options_(options) {}
+
+  /**
+   * @brief A leg state sample arrived in the SDK callback.
+   */
+  void OnStateReceived(const LegState& state) noexcept {
+    ReceiveStamp stamp;
+    stamp.state_timestamp = state.timestamp;
+    stamp.steady_ns = SteadyNowNs();
+    stamp.transport_ns = SystemNowNs() - (state.timestamp + options_.clock_offset_ns);
+    histograms_[Index(LegLatencyStage::TRANSPORT_RECEIVE)].Record(stamp.transport_ns);
+    last_receive_.Store(stamp);
+  }
+
+  /**
+   * @brief The control thread picked up a leg state sample and starts computing a command from it.
+   */
+  void OnStateConsumed(const LegState& state) noexcept {
+    const int64_t now = SteadyNowNs();
+    consumed_state_timestamp_ = state.timestamp;
+    consumed_ns_ = now;
+    received_ns_ = now;
+    transport_ns_ = 0;
+    ReceiveStamp stamp;
+    uint64_t version = 0;
+    if (last_receive_.Load(stamp, version) == RtErrorCode::OK && stamp.state_timestamp == state.timestamp) {
+      received_ns_ = stamp.steady_ns;
+      transport_ns_ = stamp.transport_ns;
+      if (stamp.state_timestamp != last_dispatched_timestamp_) {
+        histograms_[Index(LegLatencyStage::CALLBACK_DISPATCH)].Record(now - stamp.steady_ns);
+        last_dispatched_timestamp_ = stamp.state_timestamp;
+      }
+    }
+  }
+
+  /**
+   * @brief The control thread published a command computed from the last consumed state.
+   */
+  void OnCommandPublished(const LegJointCommand& command) noexcept {
+    if (consumed_ns_ == 0) {
+      return;
+    }
+    const int64_t now = SteadyNowNs();
+    LegLatencyRecord record;
+    record.state_timestamp = consumed_state_timestamp_;
+    record.command_timestamp = command.timestamp;
+    record.receive_ns = transport_ns_;
+    record.dispatch_ns = consumed_ns_ - received_ns_;
+    record.compute_ns = now - consumed_ns_;
+    histograms_[Index(LegLatencyStage::USER_COMPUTE)].Record(record.compute_ns);
+    histograms_[Index(LegLatencyStage::END_TO_END)].Record(now - received_ns_);
+    if (consumed_state_timestamp_ == last_published_timestamp_) {
+      stale_commands_.fetch_add(1, std::memory_order_relaxed);
+    }
+    last_published_timestamp_ = consumed_state_timestamp_;
+    last_record_.Store(record);
+  }
+
+  /**
+   * @brief Get the running summary of one stage.
+   */
+  LatencySummary GetSummary(LegLatencyStage stage) const noexcept { return Summarize(histograms_[Index(stage)]); }
+
+  /**
+   * @brief Get the histogram of one stage.
+   */
+  const LatencyHistogram& GetHistogram(LegLatencyStage stage) const noexcept { return histograms_[Index(stage)]; }
+
+  /**
+   * @brief Get the correlation record of the most recently published command.
+   * @return RtErrorCode::OK, or RtErrorCode::NO_DATA if nothing has been published yet.
+   */
+  RtErrorCode GetLastRecord(LegLatencyRecord& record) const noexcept {
+    uint64_t version = 0;
+    return last_record_.Load(record, version);
+  }
+
+  /**
+   * @brief Number of commands published without a new leg state since the previous command.
+   */
+  uint64_t GetStaleCommandCount() const noexcept { return stale_commands_.load(std::memory_order_relaxed); }
+
+  /**
+   * @brief Clear all histograms and counters.
+   */
+  void Reset() noexcept {
+    for (auto& histogram : histograms_) {
+      histogram.Reset();
+    }
+    stale_commands_.store(0, std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Write the summaries and non-empty histogram buckets of all stages to a text file.
+   * @param path Output file path, overwritten.
+   * @return Operation status.
+   */
+  Status DumpToFile(const std::string& path) const {
+    std::ofstream out(path, std::ios::trunc);
+    if (!out) {
+      return {ErrorCode::INTERNAL_ERROR, "failed to open " + path};
+    }
+    static const char* const kStageNames[kLegLatencyStageNum] = {"transport_receive", "callback_dispatch", "user_compute", "end_to_end"};
+    out << "# stage count mean_ns p50_ns p99_ns p999_ns max_ns\n";
+    for (std::size_t i = 0; i < kLegLatencyStageNum; ++i) {
+      const auto summary = Summarize(histograms_[i]);
+      out << kStageNames[i] << ' ' << summary.count << ' ' << summary.mean << ' ' << summary.p50 << ' '
+          << summary.p99 << ' ' << summary.p999 << ' ' << summary.max << '\n';
+    }
+    out << "# stale_commands " << GetStaleCommandCount() << '\n';
+    out << "# stage bucket_upper_bound_ns count\n";
+    for (std::size_t i = 0; i < kLegLatencyStageNum; ++i) {
+      for (std::size_t bucket = 0; bucket < LatencyHistogram::kBucketCount; ++bucket) {
+        const uint64_t count = histograms_[i].BucketCount(bucket);
+        if (count != 0) {
+          out << kStageNames[i] << ' ' << LatencyHistogram::BucketUpperBound(bucket) << ' ' << count << '\n';
+        }
+      }
+    }
+    out.flush();
+    if (!out) {
+      return {ErrorCode::INTERNAL_ERROR, "failed to write " + path};
+    }
+    return {ErrorCode::OK, ""};
+  }
+
+ private:
+  struct ReceiveStamp {
+    int64_t state_timestamp = 0;  // LegState::timestamp
+    int64_t steady_ns = 0;        // Local arrival time (steady clock)
+    int64_t transport_ns = 0;     // Transport receive latency
+  };
+
+  static constexpr std::size_t Index(LegLatencyStage stage) noexcept { return static_cast<std::size_t>(stage); }
+
+  static int64_t SystemNowNs() noexcept {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+  }
+
+  LegLatencyTracerOptions options_;                                // Tracer configuration
+  std::array<LatencyHistogram, kLegLatencyStageNum> histograms_;  // Per-stage histograms (ns)
+  SeqLock<ReceiveStamp> last_receive_;                             // Written by the SDK callback thread
+  SeqLock<LegLatencyRecord> last_record_;                          // Written by the control thread
+  std::atomic<uint64_t> stale_commands_{0};                        // Commands without a fresh state
+  // Control thread only
+  int64_t consumed_state_timestamp_ = 0;
+  int64_t consumed_ns_ = 0;
+  int64_t received_ns_ = 0;
+  int64_t transport_ns_ = 0;
+  int64_t last_dispatched_timestamp_ = 0;
+  int64_t last_published_timestamp_ = 0;
+};
+
+/************************************************************
+ *                  Real-time command publisher             *
+ ************************************************************/
+
+/**
+ * @brief Counters of RealtimeLegCommandPublisher.
+ */
+struct RealtimePublisherStats {
+  uint64_t published = 0;      ///< Commands accepted by Publish()
+  uint64_t dropped = 0;        ///< Commands rejected because the queue was full
+  uint64_t sent = 0;           ///< Commands handed to the transport
+  uint64_t send_failures = 0;  ///< Transport calls that did not return ErrorCode::OK
+};
+
+/**
+ * @brief Options of RealtimeLegCommandPublisher.
+ */
+struct RealtimePublisherOptions {
+  /**
+   * @brief Sender wake-up mode.
+   *
+   * Positive (default 200 us): the sender polls the queue at this interval, so Publish() never enters the kernel,
+   * at the cost of up to one interval of extra send latency. 0: the sender sleeps on a futex and Publish() wakes it,
+   * which halves the send latency but costs one FUTEX_WAKE syscall on the control thread whenever the sender is
+   * idle (every cycle at 500 Hz), adding several microseconds and a long tail to each Publish().
+   */
+  std::chrono::microseconds poll_interval{200};
+};
+
+/**
+ * @class RealtimeLegCommandPublisher
+ * @brief Real-time publish mode for leg joint commands.
+ *
+ * The control thread calls Publish(), which only serializes the command into a preallocated lock-free ring
+ * and returns a POD RtErrorCode: no heap allocation, no lock and no Status string on the caller's thread.
+ * A sender thread owned by this class drains the ring and forwards each command to
+ * LowLevelMotionController::PublishLegCommand (or a custom sink). By default the sender polls, so Publish() makes no
+ * syscall; see RealtimePublisherOptions::poll_interval for the wake-up mode.
+ */
+class RealtimeLegCommandPublisher final : public NonCopyable {
+ public:
+  static constexpr std::size_t kQueueCapacity = 16;  ///< Preallocated command slots
+
+  /// Transport used by the sender thread.
+  using Sink = std::function<Status(const LegJointCommand&)>;
+
+  /**
+   * @brief Publish through the given low-level controller.
+   * @param controller Initialized low-level controller, must outlive this object.
+   */
+  explicit RealtimeLegCommandPublisher(LowLevelMotionController& controller,
+                                       const RealtimePublisherOptions& options = RealtimePublisherOptions())
+      : options_(options),
+        sink_([&controller](const LegJointCommand& command) { return controller.PublishLegCommand(command); }) {}
+
+  /**
+   * @brief Publish through a custom sink, e.g. a local stand-in for the robot.
+   */
+  explicit RealtimeLegCommandPublisher(Sink sink, const RealtimePublisherOptions& options = RealtimePublisherOptions())
+      : options_(options), sink_(std::move(sink)) {}
+
+  /// Destructor, stops the sender thread.
+  ~RealtimeLegCommandPublisher() { Stop(); }
+
+  /**
+   * @brief Start the sender thread. Call before entering the control loop.
+   * @return false if already running or no sink is set.
+   */
+  bool Start() {
+    if (!sink_ || running_.exchange(true)) {
+      return false;
+    }
+    sender_ = std::thread(&RealtimeLegCommandPublisher::SenderLoop, this);
+    return true;
+  }
+
+  /**
+   * @brief Flush queued commands and stop the sender thread.
+   */
+  void Stop() {
+    if (!running_.exchange(false)) {
+      return;
+    }
+    wake_seq_.fetch_add(1, std::memory_order_release);
+    wake_seq_.notify_one();
+    if (sender_.joinable()) {
+      sender_.join();
+    }
+  }
+
+  /**
+   * @brief Queue a leg command for transmission. Real-time safe, single producer only.
+   * @param command Leg joint command.
+   * @return RtErrorCode::OK, RtErrorCode::NOT_RUNNING or RtErrorCode::QUEUE_FULL.
+   */
+  RtErrorCode Publish(const LegJointCommand& command) noexcept {
+    if (!running_.load(std::memory_order_acquire)) {
+      return RtErrorCode::NOT_RUNNING;
+    }
+    SerializeLegJointCommand(command, scratch_);
+    if (!ring_.TryPush(scratch_)) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return RtErrorCode::QUEUE_FULL;
+    }
+    published_.fetch_add(1, std::memory_order_relaxed);
+    if (tracer_ != nullptr) {
+      tracer_->OnCommandPublished(command);
+    }
+    // Pairs with the fence in SenderLoop(): either the sender sees the push or this thread sees it waiting.
+    // A busy sender is not woken, so the common case costs no futex syscall on the control thread.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sender_waiting_.load(std::memory_order_relaxed)) {
+      wake_seq_.fetch_add(1, std::memory_order_release);
+      wake_seq_.notify_one();
+    }
+    return RtErrorCode::OK;
+  }
+
+  /**
+   * @brief Get publisher counters, safe to call from any thread.
+   */
+  RealtimePublisherStats GetStats() const {
+    RealtimePublisherStats stats;
+    stats.published = published_.load(std::memory_order_relaxed);
+    stats.dropped = dropped_.load(std::memory_order_relaxed);
+    stats.sent = sent_.load(std::memory_order_relaxed);
+    stats.send_failures = send_failures_.load(std::memory_order_relaxed);
+    return stats;
+  }
+
+  /**
+   * @brief Whether the sender thread is running.
+   */
+  bool IsRunning() const { return running_.load(std::memory_order_acquire); }
+
+  /**
+   * @brief Report every accepted command to a latency tracer. Set before Start().
+   * @param tracer Tracer, must outlive this publisher, nullptr to disable.
+   */
+  void SetTracer(LegLatencyTracer* tracer) { tracer_ = tracer; }
+
+ private:
+  void SenderLoop() {
+    LegJointCommandWire wire;
+    LegJointCommand command;
+    while (true) {
+      const uint32_t seen = wake_seq_.load(std::memory_order_acquire);
+      while (ring_.TryPop(wire)) {
+        DeserializeLegJointCommand(wire, command);
+        auto status = sink_(command);
+        sent_.fetch_add(1, std::memory_order_relaxed);
+        if (status.code != ErrorCode::OK) {
+          send_failures_.fetch_add(1, std::memory_order_relaxed);
+        }
+      }
+      if (!running_.load(std::memory_order_acquire)) {
+        break;
+      }
+      if (options_.poll_interval.count() > 0) {
+        std::this_thread::sleep_for(options_.poll_interval);
+        continue;
+      }
+      sender_waiting_.store(true, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (ring_.Size() == 0 && running_.load(std::memory_order_relaxed)) {
+        wake_seq_.wait(seen, std::memory_order_acquire);
+      }
+      sender_waiting_.store(false, std::memory_order_relaxed);
+    }
+  }
+
+  RealtimePublisherOptions options_;                        // Publisher configuration
+  Sink sink_;                                               // Transport, only called on the sender thread
+  SpscRing<LegJointCommandWire, kQueueCapacity> ring_;      // Preallocated command queue
+  LegJointCommandWire scratch_{};                           // Producer-side serialization buffer
+  std::atomic<uint32_t> wake_seq_{0};                       // Bumped to wake a waiting sender
+  std::atomic_bool sender_waiting_{false};                  // Set while the sender is about to wait or waiting
+  std::atomic_bool running_{false};                         // Whether the sender thread is running
+  std::thread sender_;                                      // Sender thread
+  std::atomic<uint64_t> published_{0};                      // Statistics, see RealtimePublisherStats
+  std::atomic<uint64_t> dropped_{0};
+  std::atomic<uint64_t> sent_{0};
+  std::atomic<uint64_t> send_failures_{0};
+  LegLatencyTracer* tracer_ = nullptr;                      // Optional latency tracer
+};
+
+/************************************************************
+ *                    Latest leg state mailbox              *
+ ************************************************************/
+
+/**
+ * @class LegStateMailbox
+ * @brief Latest-value LegState mailbox for polling from the control thread.
+ *
+ * Attach() subscribes to leg state and stores every sample into a SeqLock. The control thread then calls Read()
+ * to get the newest sample without shared_ptr copies, refcount traffic, mutexes or per-message allocation.
+ * Several readers may poll concurrently.
+ */
+class LegStateMailbox final : public NonCopyable {
+ public:
+  LegStateMailbox() = default;
+
+  /// Destructor, unsubscribes if still attached.
+  ~LegStateMailbox() { Detach(); }
+
+  /**
+   * @brief Subscribe to leg state on the given controller and feed this mailbox.
+   * @param controller Initialized low-level controller, must outlive the attachment.
+   * @note Replaces any leg state callback previously registered on the controller.
+   */
+  void Attach(LowLevelMotionController& controller) {
+    Detach();
+    controller_ = &controller;
+    controller.SubscribeLegState([this](const std::shared_ptr<LegState>& msg) {
+      if (msg) {
+        Update(*msg);
+      }
+    });
+  }
+
+  /**
+   * @brief Unsubscribe from the attached controller.
+   */
+  void Detach() {
+    if (controller_ != nullptr) {
+      controller_->UnsubscribeLegState();
+      controller_ = nullptr;
+    }
+  }
+
+  /**
+   * @brief Store a new sample (single writer, normally the subscription callback).
+   */
+  void Update(const LegState& state) noexcept {
+    if (tracer_ != nullptr) {
+      tracer_->OnStateReceived(state);
+    }
+    latest_.Store(state);
+  }
+
+  /**
+   * @brief Copy out the newest leg state. Real-time safe.
+   * @param state Output leg state.
+   * @param sequence Optional output, number of samples received so far.
+   * @return RtErrorCode::OK, or RtErrorCode::NO_DATA before the first sample.
+   */
+  RtErrorCode Read(LegState& state, uint64_t* sequence = nullptr) const noexcept {
+    uint64_t version = 0;
+    auto code = latest_.Load(state, version);
+    if (tracer_ != nullptr && code == RtErrorCode::OK) {
+      tracer_->OnStateConsumed(state);
+    }
+    if (sequence != nullptr) {
+      *sequence = version;
+    }
+    return code;
+  }
+
+  /**
+   * @brief Number of samples received so far, compare between polls to detect fresh data.
+   */
+  uint64_t Sequence() const noexcept { return latest_.Version(); }
+
+  /**
+   * @brief Report received and consumed samples to a latency tracer. Set before Attach().
+   * @param tracer Tracer, must outlive this mailbox, nullptr to disable.
+   * @note With a tracer set, Read() is treated as the control thread picking up the sample, so only the
+   *       control thread should call it.
+   */
+  void SetTracer(LegLatencyTracer* tracer) { tracer_ = tracer; }
+
+ private:
+  SeqLock<LegState> latest_;                         // Newest leg state
+  LowLevelMotionController* controller_ = nullptr;   // Attached controller, if any
+  LegLatencyTracer* tracer_ = nullptr;               // Optional latency tracer
+};
+
+}  // namespace magic::dog::motion
@@ -0,0 +1,416 @@
+#pragma once
+
+#include "magic_audio.h"
+#include "magic_dispatch.h"
+#include "magic_motion.h"
+#include "magic_nav_watcher.h"
+#include "magic_slam_navigation.h"
+#include "magic_type.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace magic::dog::slam {
+
+/************************************************************
+ *                         Waypoints                        *
+ ************************************************************/
+
+/**
+ * @brief Action run when a waypoint is reached.
+ */
+struct WaypointAction {
+  std::string name;             ///< Name reported in ACTION_FINISHED events
+  std::function<Status()> run;  ///< Action body
+  bool wait = true;             ///< Finish before departing; false runs it while driving to the next waypoint
+};
+
+/**
+ * @brief One mission waypoint: a navigation target and the actions to run on arrival.
+ */
+struct NavWaypoint {
+  NavTarget target;                     ///< Navigation target; consecutive waypoints need distinct IDs
+  std::vector<WaypointAction> actions;  ///< Actions run in order on arrival
+};
+
+/**
+ * @brief Waypoint action executing a trick.
+ * @param controller High-level motion controller, which must outlive the mission.
+ */
+inline WaypointAction MakeTrickAction(motion::HighLevelMotionController& controller, TrickAction trick, int timeout_ms = 5000) {
+  return {"trick " + std::to_string(static_cast<int>(trick)),
+          [&controller, trick, timeout_ms] { return controller.ExecuteTrick(trick, timeout_ms); }, true};
+}
+
+/**
+ * @brief Waypoint action playing TTS, by default while the robot drives on.
+ * @param controller Audio controller, which must outlive the mission.
+ */
+inline WaypointAction MakePlayAction(audio::AudioController& controller, const TtsCommand& command, bool wait = false,
+                                     int timeout_ms = 5000) {
+  return {"play " + command.id, [&controller, command, timeout_ms] { return controller.Play(command, timeout_ms); }, wait};
+}
+
+/************************************************************
+ *                      Mission progress                    *
+ ************************************************************/
+
+enum class MissionEventType {
+  WAYPOINT_STARTED = 0,   // Target sent, robot driving to the waypoint
+  WAYPOINT_REACHED = 1,   // Navigation ended with END_SUCCESS
+  WAYPOINT_FAILED = 2,    // Navigation failed, was cancelled or timed out
+  ACTION_FINISHED = 3,    // A waypoint action returned
+  MISSION_FINISHED = 4,   // All waypoints done
+  MISSION_FAILED = 5,     // Stopped at a failed waypoint or action
+  MISSION_CANCELLED = 6,  // Cancel() was called
+};
+
+/**
+ * @brief Mission progress event.
+ */
+struct MissionEvent {
+  MissionEventType type = MissionEventType::WAYPOINT_STARTED;
+  std::size_t waypoint_index = 0;          ///< Waypoint the event refers to
+  std::size_t waypoint_count = 0;          ///< Waypoints in the mission
+  std::string action_name;                 ///< ACTION_FINISHED only
+  NavStatus nav_status{};                  ///< Final navigation status for WAYPOINT_REACHED / WAYPOINT_FAILED
+  Status status{ErrorCode::OK, ""};        ///< Result of the step
+};
+
+/**
+ * @brief NavMission options.
+ */
+struct NavMissionOptions {
+  int waypoint_timeout_ms = 600000;  ///< Maximum driving time per waypoint
+  bool stop_on_failure = true;       ///< End the mission at the first failed waypoint or action
+  std::size_t action_threads = 1;    ///< Threads running non-waiting actions
+};
+
+/************************************************************
+ *                        Nav mission                       *
+ ************************************************************/
+
+/**
+ * @class NavMission
+ * @brief Runs an ordered list of waypoints back-to-back on a mission thread.
+ *
+ * The next target is sent as soon as the watcher reports the previous task ended and the waiting actions returned,
+ * without a client round trip per waypoint. Non-waiting actions (e.g. TTS) run on an action thread while the robot
+ * drives on. Progress events are delivered on the mission thread (ACTION_FINISHED of non-waiting actions on the
+ * action thread).
+ */
+class NavMission final : public NonCopyable {
+ public:
+  using MissionCallback = std::function<void(const MissionEvent&)>;
+  /// Sends one navigation target, e.g. SlamNavController::SetNavTarget.
+  using TargetSink = std::function<Status(const NavTarget&)>;
+  /// Cancels the running navigation task, e.g. SlamNavController::CancelNavTask.
+  using CancelSink = std::function<Status()>;
+
+  /**
+   * @param controller Initialized SLAM navigation controller, in navigation mode with a map loaded.
+   * @param watcher Started navigation status watcher on the same controller.
+   */
+  NavMission(SlamNavController& controller, NavStatusWatcher& watcher, const NavMissionOptions& options = NavMissionOptions())
+      : NavMission([&controller](const NavTarget& target) { return controller.SetNavTarget(target); },
+                   [&controller] { return controller.CancelNavTask(); }, watcher, options) {}
+
+  /**
+   * @brief Drive custom sinks, e.g. a local stand-in for the robot.
+   */
+  NavMission(TargetSink set_target, CancelSink cancel, NavStatusWatcher& watcher, const NavMissionOptions& options = NavMissionOptions())
+      : options_(options),
+        set_target_(std::move(set_target)),
+        cancel_(std::move(cancel)),
+        watcher_(watcher),
+        actions_(std::max<std::size_t>(options.action_threads, 1)) {}
+
+  /// Destructor, cancels a running mission.
+  ~NavMission() {
+    Cancel();
+    Join();
+  }
+
+  /**
+   * @brief Start a mission.
+   * @param waypoints Ordered waypoints.
+   * @param callback Progress events, may be empty.
+   * @return SERVICE_ERROR if a mission is already running, INTERNAL_ERROR if two consecutive waypoints share a target ID
+   *         (the second task's result could not be told from the first one's).
+   */
+  Status Start(std::vector<NavWaypoint> waypoints, MissionCallback callback = nullptr) {
+    for (std::size_t i = 1; i < waypoints.size(); ++i) {
+      if (waypoints[i].target.id == waypoints[i - 1].target.id) {
+        return {ErrorCode::INTERNAL_ERROR, "consecutive nav waypoints share target ID " + std::to_string(waypoints[i].target.id)};
+      }
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (running_) {
+      return {ErrorCode::SERVICE_ERROR, "a nav mission is already running"};
+    }
+    // Claim the mission before releasing the lock, so a concurrent Start() fails instead of joining the same thread.
+    running_ = true;
+    cancelled_ = false;
+    current_ = 0;
+    result_ = {ErrorCode::OK, ""};
+    lock.unlock();
+    Join();
+    lock.lock();
+    mission_ = std::thread(&NavMission::Run, this, std::move(waypoints), std::move(callback));
+    return {ErrorCode::OK, ""};
+  }
+
+  /**
+   * @brief Cancel the running mission and its navigation task.
+   *
+   * If a target is being sent, the mission thread cancels once the send returns, so the cancel cannot reach the
+   * robot ahead of the target it is meant to stop.
+   */
+  void Cancel() {
+    bool deferred = false;
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      if (!running_ || cancelled_) {
+        return;
+      }
+      cancelled_ = true;
+      deferred = dispatching_;
+    }
+    cv_.notify_all();
+    if (!deferred && cancel_) {
+      cancel_();
+    }
+  }
+
+  /**
+   * @brief Block until the mission ends.
+   * @return Mission result: OK, the first failure, SERVICE_ERROR if cancelled, or TIMEOUT if still running.
+   */
+  Status Wait(int timeout_ms) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!cv_.wait_for(lock, std::chrono::milliseconds(timeout_ms), [this] { return !running_; })) {
+      return {ErrorCode::TIMEOUT, "nav mission still running"};
+    }
+    return result_;
+  }
+
+  /// Whether a mission is running.
+  bool IsRunning() const {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return running_;
+  }
+
+  /// Index of the waypoint being driven to or acted on.
+  std::size_t GetCurrentIndex() const {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return current_;
+  }
+
+ private:
+  void Join() {
+    if (mission_.joinable() && mission_.get_id() != std::this_thread::get_id()) {
+      mission_.join();
+    }
+  }
+
+  bool IsCancelled() const {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return cancelled_;
+  }
+
+  void Run(std::vector<NavWaypoint> waypoints, MissionCallback callback) {
+    auto emit = [&](MissionEvent event) {
+      event.waypoint_count = waypoints.size();
+      if (callback) {
+        callback(event);
+      }
+    };
+    // Non-waiting actions still in flight; the mission ends only after they return.
+    auto pending = std::make_shared<ActionTracker>();
+    Status result{ErrorCode::OK, ""};
+
+    for (std::size_t i = 0; i < waypoints.size(); ++i) {
+      const NavWaypoint& waypoint = waypoints[i];
+      MissionEvent event;
+      event.waypoint_index = i;
+
+      NavStatus nav_status{};
+      // Mark before sending, so only a result reported for this dispatch ends the wait.
+      const NavResultMark mark = watcher_.MarkNavResult();
+      {
+        // Checked and flagged under one lock: a Cancel() from here on is left to this thread (see below).
+        std::lock_guard<std::mutex> guard(mutex_);
+        if (cancelled_) {
+          break;
+        }
+        current_ = i;
+        dispatching_ = true;
+      }
+      Status status = set_target_(waypoint.target);
+      bool cancelled_while_sending = false;
+      {
+        std::lock_guard<std::mutex> guard(mutex_);
+        dispatching_ = false;
+        cancelled_while_sending = cancelled_;
+      }
+      if (cancelled_while_sending) {
+        // Cancel() skipped the cancel call while the target was in flight; stop the task it may have started.
+        if (cancel_) {
+          cancel_();
+        }
+        break;
+      }
+      if (status.code == ErrorCode::OK) {
+        event.type = MissionEventType::WAYPOINT_STARTED;
+        emit(event);
+        status = WaitForArrival(waypoint.target.id, mark, nav_status);
+      }
+      event.nav_status = nav_status;
+      event.status = status;
+      if (IsCancelled()) {
+        break;
+      }
+      if (status.code != ErrorCode::OK) {
+        event.type = MissionEventType::WAYPOINT_FAILED;
+        emit(event);
+        if (options_.stop_on_failure) {
+          result = status;
+          break;
+        }
+        continue;
+      }
+      event.type = MissionEventType::WAYPOINT_REACHED;
+      emit(event);
+
+      for (const WaypointAction& action : waypoint.actions) {
+        if (IsCancelled()) {
+          break;
+        }
+        if (!action.wait) {
+          pending->Add();
+          actions_.Post([action, i, emit, pending] {
+            MissionEvent done;
+            done.type = MissionEventType::ACTION_FINISHED;
+            done.waypoint_index = i;
+            done.action_name = action.name;
+            done.status = action.run ? action.run() : Status{ErrorCode::OK, ""};
+            emit(done);
+            pending->Done();
+          });
+          continue;
+        }
+        MissionEvent done;
+        done.type = MissionEventType::ACTION_FINISHED;
+        done.waypoint_index = i;
+        done.action_name = action.name;
+        done.status = action.run ? action.run() : Status{ErrorCode::OK, ""};
+        emit(done);
+        if (done.status.code != ErrorCode::OK && options_.stop_on_failure) {
+          result = done.status;
+          break;
+        }
+      }
+      if (result.code != ErrorCode::OK) {
+        break;
+      }
+    }
+    pending->WaitIdle();
+
+    MissionEvent end;
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      end.waypoint_index = current_;
+      if (cancelled_) {
+        result = {ErrorCode::SERVICE_ERROR, "nav mission cancelled"};
+        end.type = MissionEventType::MISSION_CANCELLED;
+      } else {
+        end.type = result.code == ErrorCode::OK ? MissionEventType::MISSION_FINISHED : MissionEventType::MISSION_FAILED;
+      }
+    }
+    end.status = result;
+    emit(end);
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      result_ = result;
+      running_ = false;
+    }
+    cv_.notify_all();
+  }
+
+  // Wait in short slices so Cancel() is noticed while driving.
+  Status WaitForArrival(int32_t target_id, const NavResultMark& mark, NavStatus& nav_status) {
+    constexpr int kSliceMs = 100;
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(options_.waypoint_timeout_ms);
+    while (!IsCancelled()) {
+      const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+      if (left <= 0) {
+        return {ErrorCode::TIMEOUT, "timed out driving to nav target " + std::to_string(target_id)};
+      }
+      Status status = watcher_.WaitForNavResult(target_id, nav_status, static_cast<int>(std::min<long long>(left, kSliceMs)), mark);
+      if (status.code == ErrorCode::TIMEOUT) {
+        continue;
+      }
+      if (status.code != ErrorCode::OK) {
+        return status;
+      }
+      if (nav_status.status != NavStatusType::END_SUCCESS) {
+        return {ErrorCode::SERVICE_ERROR, "nav target " + std::to_string(target_id) + " ended with status " +
+                                              std::to_string(static_cast<int>(nav_status.status))};
+      }
+      return {ErrorCode::OK, ""};
+    }
+    return {ErrorCode::SERVICE_ERROR, "nav mission cancelled"};
+  }
+
+  // Counts non-waiting actions in flight.
+  class ActionTracker {
+   public:
+    void Add() {
+      std::lock_guard<std::mutex> guard(mutex_);
+      ++count_;
+    }
+
+    void Done() {
+      std::lock_guard<std::mutex> guard(mutex_);
+      if (--count_ == 0) {
+        cv_.notify_all();
+      }
+    }
+
+    void WaitIdle() {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.wait(lock, [this] { return count_ == 0; });
+    }
+
+   private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::size_t count_ = 0;
+  };
+
+  NavMissionOptions options_;
+  TargetSink set_target_;           // Sends navigation targets
+  CancelSink cancel_;               // Cancels the navigation task
+  NavStatusWatcher& watcher_;       // Navigation results
+  Executor actions_;                // Runs non-waiting actions
+  mutable std::mutex mutex_;        // Guards the fields below
+  std::condition_variable cv_;      // Signals mission end and Cancel()
+  std::thread mission_;             // Mission thread
+  bool running_ = false;
+  bool cancelled_ = false;
+  bool dispatching_ = false;        // set_target_ in progress, Cancel() leaves the cancel call to the mission thread
+  std::size_t current_ = 0;         // Current waypoint index
+  Status result_{ErrorCode::OK, ""};
+};
+
+}  // namespace magic::dog::slam
@@ -0,0 +1,379 @@
+#pragma once
+
+#include "magic_slam_navigation.h"
+#include "magic_type.h"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <numbers>
+#include <string>
+#include <thread>
+#include <utility>
+
+namespace magic::dog::slam {
+
+/**
+ * @brief NavStatusWatcher options.
+ */
+struct NavStatusWatcherOptions {
+  std::chrono::milliseconds nav_status_interval{10};    ///< GetNavTaskStatus period while subscribed or waiting
+  std::chrono::milliseconds localization_interval{50};  ///< GetCurrentLocalizationInfo period while subscribed
+  double position_tolerance = 0.01;                     ///< Localization changes below this (m) are not delivered
+  double orientation_tolerance = 0.01;                  ///< Localization changes below this (rad) are not delivered
+};
+
+/**
+ * @brief Whether a navigation status ends the task (END_SUCCESS, END_FAILED or CANCEL).
+ */
+inline bool IsNavTaskFinished(NavStatusType status) {
+  return status == NavStatusType::END_SUCCESS || status == NavStatusType::END_FAILED || status == NavStatusType::CANCEL;
+}
+
+/**
+ * @brief Point in the navigation status stream that a WaitForNavResult() result must come after.
+ */
+struct NavResultMark {
+  uint64_t active_after = 0;  ///< A task in progress reported after this report counts
+  uint64_t change_after = 0;  ///< A status change reported after this report counts
+};
+
+/**
+ * @class NavStatusWatcher
+ * @brief Change-only navigation status and localization streams on top of SlamNavController.
+ *
+ * One watcher thread queries the navigation status and localization only while a subscription or wait needs them,
+ * and delivers a callback only when the value changes (status or target ID; pose beyond the configured tolerance).
+ * Notify*() let a push source deliver updates directly, bypassing the query.
+ */
+class NavStatusWatcher final : public NonCopyable {
+ public:
+  using NavStatusPtr = std::shared_ptr<NavStatus>;
+  using LocalizationInfoPtr = std::shared_ptr<LocalizationInfo>;
+  using NavStatusCallback = std::function<void(const NavStatusPtr)>;
+  using LocalizationInfoCallback = std::function<void(const LocalizationInfoPtr)>;
+
+  /// Navigation status query used by the watcher thread.
+  using NavStatusSource = std::function<Status(NavStatus&)>;
+  /// Localization query used by the watcher thread.
+  using LocalizationSource = std::function<Status(LocalizationInfo&)>;
+
+  /**
+   * @brief Watch an initialized SLAM navigation controller, which must outlive this object.
+   */
+  explicit NavStatusWatcher(SlamNavController& controller, const NavStatusWatcherOptions& options = NavStatusWatcherOptions())
+      : NavStatusWatcher([&controller](NavStatus& status) { return controller.GetNavTaskStatus(status); },
+                         [&controller](LocalizationInfo& info) { return controller.GetCurrentLocalizationInfo(info); }, options) {}
+
+  /**
+   * @brief Watch custom sources, e.g. a local stand-in for the robot.
+   */
+  NavStatusWatcher(NavStatusSource nav_status_source, LocalizationSource localization_source,
+                   const NavStatusWatcherOptions& options = NavStatusWatcherOptions())
+      : options_(options), nav_status_source_(std::move(nav_status_source)), localization_source_(std::move(localization_source)) {}
+
+  /// Destructor, stops the watcher thread.
+  ~NavStatusWatcher() { Stop(); }
+
+  /**
+   * @brief Start the watcher thread.
+   * @return false if already running.
+   */
+  bool Start() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (running_) {
+      return false;
+    }
+    lock.unlock();
+    if (watcher_.joinable()) {
+      watcher_.join();
+    }
+    lock.lock();
+    running_ = true;
+    watcher_ = std::thread(&NavStatusWatcher::WatchLoop, this);
+    return true;
+  }
+
+  /**
+   * @brief Stop the watcher thread, pending waits return SERVICE_NOT_READY.
+   */
+  void Stop() {
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      running_ = false;
+    }
+    cv_.notify_all();
+    if (watcher_.joinable() && watcher_.get_id() != std::this_thread::get_id()) {
+      watcher_.join();
+    }
+  }
+
+  /**
+   * @brief Subscribe to navigation status changes, replacing any previous callback.
+   */
+  void SubscribeNavStatus(const NavStatusCallback& callback) {
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      nav_status_callback_ = callback;
+    }
+    cv_.notify_all();
+  }
+
+  /**
+   * @brief Unsubscribe from navigation status changes.
+   */
+  void UnsubscribeNavStatus() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    nav_status_callback_ = nullptr;
+  }
+
+  /**
+   * @brief Subscribe to localization changes, replacing any previous callback.
+   */
+  void SubscribeLocalizationInfo(const LocalizationInfoCallback& callback) {
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      localization_callback_ = callback;
+    }
+    cv_.notify_all();
+  }
+
+  /**
+   * @brief Unsubscribe from localization changes.
+   */
+  void UnsubscribeLocalizationInfo() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    localization_callback_ = nullptr;
+  }
+
+  /**
+   * @brief Deliver a navigation status reported by a push source. Thread-safe.
+   */
+  void NotifyNavStatus(const NavStatus& status) { UpdateNavStatus(status); }
+
+  /**
+   * @brief Deliver localization reported by a push source. Thread-safe.
+   */
+  void NotifyLocalizationInfo(const LocalizationInfo& info) { UpdateLocalization(info); }
+
+  /**
+   * @brief Last reported navigation status, nullptr before the first report.
+   */
+  NavStatusPtr GetNavStatus() const {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return nav_status_;
+  }
+
+  /**
+   * @brief Last reported localization, nullptr before the first report.
+   */
+  LocalizationInfoPtr GetLocalizationInfo() const {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return localization_;
+  }
+
+  /**
+   * @brief Mark the current point of the status stream, before sending a target whose result is waited for later.
+   *
+   * If nothing is polling, the cached status may be stale, so the status is queried once first.
+   */
+  NavResultMark MarkNavResult() {
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      if (NeedsNavStatus() || !running_ || !nav_status_source_) {
+        return {nav_status_seq_, nav_status_seq_};
+      }
+    }
+    NavStatus status;
+    polls_.fetch_add(1, std::memory_order_relaxed);
+    const bool refreshed = nav_status_source_(status).code == ErrorCode::OK;
+    if (refreshed) {
+      UpdateNavStatus(status);
+    }
+    std::lock_guard<std::mutex> guard(mutex_);
+    // Without a fresh baseline, the first report after the mark is not taken as a change.
+    return {nav_status_seq_, refreshed ? nav_status_seq_ : nav_status_seq_ + 1};
+  }
+
+  /**
+   * @brief Block until the navigation task to a target ends.
+   *
+   * Only an end reported after the call counts, see the overload taking a NavResultMark. As the target was already
+   * sent, a cached status is not refreshed: if nothing was polling, the first report after the call is not taken as
+   * a change. Prefer MarkNavResult() before sending the target.
+   * @param target_id Target point ID passed to SetNavTarget.
+   * @param result Final navigation status (END_SUCCESS, END_FAILED or CANCEL).
+   * @param timeout_ms Timeout in milliseconds.
+   * @return OK when the task ended, TIMEOUT, or SERVICE_NOT_READY if the watcher is not running.
+   */
+  Status WaitForNavResult(int32_t target_id, NavStatus& result, int timeout_ms) {
+    NavResultMark mark;
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      mark = {nav_status_seq_, NeedsNavStatus() ? nav_status_seq_ : nav_status_seq_ + 1};
+    }
+    return WaitForNavResult(target_id, result, timeout_ms, mark);
+  }
+
+  /**
+   * @brief Block until the navigation task to a target ends after a mark.
+   *
+   * Only an end reported after the mark counts: the task must be seen in progress after the mark, or the status must
+   * change to the finished one after the mark. A repeated task to the same target that ends with the same status
+   * before any poll sees it times out. Waiting in slices with the same mark never loses a result reported between
+   * the slices.
+   * @param target_id Target point ID passed to SetNavTarget.
+   * @param result Final navigation status (END_SUCCESS, END_FAILED or CANCEL).
+   * @param timeout_ms Timeout in milliseconds.
+   * @param mark Result of MarkNavResult() taken before the target was sent.
+   * @return OK when the task ended, TIMEOUT, or SERVICE_NOT_READY if the watcher is not running.
+   */
+  Status WaitForNavResult(int32_t target_id, NavStatus& result, int timeout_ms, const NavResultMark& mark) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!running_) {
+      return {ErrorCode::SERVICE_NOT_READY, "nav status watcher is not running"};
+    }
+    ++waiters_;
+    cv_.notify_all();
+    const bool finished = cv_.wait_until(lock, deadline, [&] {
+      return !running_ || (nav_status_ && nav_status_->id == target_id && IsNavTaskFinished(nav_status_->status) &&
+                           (nav_active_seq_ > mark.active_after || nav_change_seq_ > mark.change_after));
+    });
+    --waiters_;
+    if (!running_) {
+      return {ErrorCode::SERVICE_NOT_READY, "nav status watcher stopped"};
+    }
+    if (!finished) {
+      return {ErrorCode::TIMEOUT, "timed out waiting for nav target " + std::to_string(target_id)};
+    }
+    result = *nav_status_;
+    return {ErrorCode::OK, ""};
+  }
+
+  /// Number of queries issued by the watcher thread.
+  uint64_t GetPollCount() const { return polls_.load(std::memory_order_relaxed); }
+
+ private:
+  void WatchLoop() {
+    auto next_nav_status = std::chrono::steady_clock::now();
+    auto next_localization = next_nav_status;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (running_) {
+      cv_.wait(lock, [this] { return !running_ || NeedsNavStatus() || NeedsLocalization(); });
+      if (!running_) {
+        break;
+      }
+      const bool query_nav_status = NeedsNavStatus() && std::chrono::steady_clock::now() >= next_nav_status;
+      const bool query_localization = NeedsLocalization() && std::chrono::steady_clock::now() >= next_localization;
+      lock.unlock();
+      if (query_nav_status && nav_status_source_) {
+        NavStatus status;
+        polls_.fetch_add(1, std::memory_order_relaxed);
+        if (nav_status_source_(status).code == ErrorCode::OK) {
+          UpdateNavStatus(status);
+        }
+        next_nav_status = std::chrono::steady_clock::now() + options_.nav_status_interval;
+      }
+      if (query_localization && localization_source_) {
+        LocalizationInfo info;
+        polls_.fetch_add(1, std::memory_order_relaxed);
+        if (localization_source_(info).code == ErrorCode::OK) {
+          UpdateLocalization(info);
+        }
+        next_localization = std::chrono::steady_clock::now() + options_.localization_interval;
+      }
+      lock.lock();
+      auto wake = next_nav_status;
+      if (!NeedsNavStatus() || (NeedsLocalization() && next_localization < wake)) {
+        wake = next_localization;
+      }
+      cv_.wait_until(lock, wake, [this] { return !running_; });
+    }
+  }
+
+  // Callers hold mutex_.
+  bool NeedsNavStatus() const { return waiters_ > 0 || static_cast<bool>(nav_status_callback_); }
+  bool NeedsLocalization() const { return static_cast<bool>(localization_callback_); }
+
+  void UpdateNavStatus(const NavStatus& status) {
+    NavStatusCallback callback;
+    NavStatusPtr message;
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      ++nav_status_seq_;
+      if (!IsNavTaskFinished(status.status)) {
+        nav_active_seq_ = nav_status_seq_;
+      }
+      if (!nav_status_ || nav_status_->id != status.id || nav_status_->status != status.status) {
+        nav_change_seq_ = nav_status_seq_;
+        message = std::make_shared<NavStatus>(status);
+        nav_status_ = message;
+        callback = nav_status_callback_;
+      }
+    }
+    cv_.notify_all();
+    if (callback) {
+      callback(message);
+    }
+  }
+
+  void UpdateLocalization(const LocalizationInfo& info) {
+    LocalizationInfoCallback callback;
+    LocalizationInfoPtr message;
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      if (localization_ && !LocalizationChanged(*localization_, info)) {
+        return;
+      }
+      message = std::make_shared<LocalizationInfo>(info);
+      localization_ = message;
+      callback = localization_callback_;
+    }
+    if (callback) {
+      callback(message);
+    }
+  }
+
+  bool LocalizationChanged(const LocalizationInfo& last, const LocalizationInfo& current) const {
+    if (last.is_localization != current.is_localization) {
+      return true;
+    }
+    for (std::size_t i = 0; i < 3; ++i) {
+      if (std::abs(current.pose.position[i] - last.pose.position[i]) > options_.position_tolerance) {
+        return true;
+      }
+      // Compare angles on the circle, so a wrap from pi to -pi is not a change.
+      const double delta = std::remainder(current.pose.orientation[i] - last.pose.orientation[i], 2.0 * std::numbers::pi);
+      if (std::abs(delta) > options_.orientation_tolerance) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  NavStatusWatcherOptions options_;
+  NavStatusSource nav_status_source_;                // Navigation status query
+  LocalizationSource localization_source_;           // Localization query
+  mutable std::mutex mutex_;                         // Guards the fields below
+  std::condition_variable cv_;                       // Signals status reports, demand and Stop()
+  std::thread watcher_;                              // Watcher thread
+  bool running_ = false;
+  int waiters_ = 0;                                  // Threads inside WaitForNavResult()
+  NavStatusPtr nav_status_;                          // Last delivered navigation status
+  uint64_t nav_status_seq_ = 0;                      // Incremented on every navigation status report
+  uint64_t nav_active_seq_ = 0;                      // nav_status_seq_ of the last report of a task in progress
+  uint64_t nav_change_seq_ = 0;                      // nav_status_seq_ of the last report that changed the status
+  LocalizationInfoPtr localization_;                 // Last delivered localization
+  NavStatusCallback nav_status_callback_;
+  LocalizationInfoCallback localization_callback_;
+  std::atomic<uint64_t> polls_{0};
+};
+
+}  // namespace magic::dog::slam
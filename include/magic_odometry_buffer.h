@@ -0,0 +1,215 @@
+#pragma once
+
+#include "magic_realtime.h"
+#include "magic_slam_navigation.h"
+#include "magic_type.h"
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace magic::dog::slam {
+
+/************************************************************
+ *                      Odometry samples                    *
+ ************************************************************/
+
+/**
+ * @brief Trivially copyable odometry sample, the Odometry message without strings.
+ */
+struct OdometrySample {
+  int64_t stamp = 0;                              ///< Header stamp (ns)
+  std::array<double, 3> position{};               ///< Position (x, y, z)
+  std::array<double, 4> orientation{1, 0, 0, 0};  ///< Orientation (w, x, y, z)
+  std::array<double, 3> linear_velocity{};        ///< Linear velocity (x, y, z)
+  std::array<double, 3> angular_velocity{};       ///< Angular velocity (x, y, z)
+};
+
+/**
+ * @brief Strip an Odometry message down to its sample.
+ */
+inline OdometrySample ToOdometrySample(const Odometry& odometry) {
+  OdometrySample sample;
+  sample.stamp = odometry.header.stamp;
+  sample.position = odometry.position;
+  sample.orientation = odometry.orientation;
+  sample.linear_velocity = odometry.linear_velocity;
+  sample.angular_velocity = odometry.angular_velocity;
+  return sample;
+}
+
+/**
+ * @brief Spherical linear interpolation of unit quaternions (w, x, y, z); t outside [0, 1] extrapolates.
+ */
+inline std::array<double, 4> QuaternionSlerp(const std::array<double, 4>& from, std::array<double, 4> to, double t) noexcept {
+  double cos_theta = from[0] * to[0] + from[1] * to[1] + from[2] * to[2] + from[3] * to[3];
+  // Take the short way around.
+  if (cos_theta < 0.0) {
+    cos_theta = -cos_theta;
+    for (auto& v : to) {
+      v = -v;
+    }
+  }
+  // Normalized lerp for nearly equal orientations, where sin(theta) ~ 0.
+  double w0 = 1.0 - t;
+  double w1 = t;
+  if (cos_theta < 0.9999999) {
+    const double theta = std::acos(cos_theta);
+    const double sin_theta = std::sin(theta);
+    w0 = std::sin((1.0 - t) * theta) / sin_theta;
+    w1 = std::sin(t * theta) / sin_theta;
+  }
+  std::array<double, 4> out;
+  double norm = 0.0;
+  for (std::size_t i = 0; i < 4; ++i) {
+    out[i] = w0 * from[i] + w1 * to[i];
+    norm += out[i] * out[i];
+  }
+  norm = std::sqrt(norm);
+  for (auto& v : out) {
+    v /= norm;
+  }
+  return out;
+}
+
+/**
+ * @brief Pose at fraction t between two samples: linear in position and velocity, slerp in orientation.
+ * @param t 0 gives from, 1 gives to; t > 1 extrapolates at the motion between the two samples.
+ */
+inline OdometrySample InterpolateOdometry(const OdometrySample& from, const OdometrySample& to, double t) noexcept {
+  OdometrySample out;
+  out.stamp = from.stamp + static_cast<int64_t>(std::llround(t * static_cast<double>(to.stamp - from.stamp)));
+  for (std::size_t i = 0; i < 3; ++i) {
+    out.position[i] = from.position[i] + t * (to.position[i] - from.position[i]);
+    out.linear_velocity[i] = from.linear_velocity[i] + t * (to.linear_velocity[i] - from.linear_velocity[i]);
+    out.angular_velocity[i] = from.angular_velocity[i] + t * (to.angular_velocity[i] - from.angular_velocity[i]);
+  }
+  out.orientation = QuaternionSlerp(from.orientation, to.orientation, t);
+  return out;
+}
+
+/************************************************************
+ *                      Odometry buffer                     *
+ ************************************************************/
+
+/**
+ * @brief OdometryBuffer options.
+ */
+struct OdometryBufferOptions {
+  std::size_t capacity = 2048;               ///< Samples kept, rounded up to a power of two
+  int64_t max_extrapolation_ns = 100000000;  ///< Furthest Lookup() may extrapolate past the newest sample
+};
+
+/**
+ * @class OdometryBuffer
+ * @brief Time-indexed ring of odometry samples answering "where was the robot at time t".
+ *
+ * One writer (the odometry subscription) appends samples with increasing stamps; any number of readers call
+ * Lookup() concurrently without locks. Samples live in a StampedRing, so Lookup() binary searches the window,
+ * O(log capacity), and interpolates between the bracketing samples, or extrapolates from the newest two.
+ */
+class OdometryBuffer final : public NonCopyable {
+ public:
+  explicit OdometryBuffer(const OdometryBufferOptions& options = OdometryBufferOptions())
+      : max_extrapolation_ns_(options.max_extrapolation_ns), ring_(options.capacity) {}
+
+  /// Destructor, unsubscribes if still attached.
+  ~OdometryBuffer() { Detach(); }
+
+  /**
+   * @brief Subscribe to odometry on the given controller and feed this buffer.
+   * @param controller Initialized SLAM navigation controller, must outlive the attachment.
+   * @note Replaces any odometry callback previously registered on the controller.
+   */
+  void Attach(SlamNavController& controller) {
+    Detach();
+    controller_ = &controller;
+    controller.SubscribeOdometry([this](const std::shared_ptr<Odometry> msg) {
+      if (msg) {
+        Update(*msg);
+      }
+    });
+  }
+
+  /**
+   * @brief Unsubscribe from the attached controller.
+   */
+  void Detach() {
+    if (controller_ != nullptr) {
+      controller_->UnsubscribeOdometry();
+      controller_ = nullptr;
+    }
+  }
+
+  /**
+   * @brief Append a sample (single writer, normally the subscription callback).
+   * @return false if the stamp does not increase; the sample is dropped.
+   */
+  bool Update(const Odometry& odometry) noexcept { return ring_.Push(ToOdometrySample(odometry)); }
+
+  /// @copydoc Update(const Odometry&)
+  bool Update(const OdometrySample& sample) noexcept { return ring_.Push(sample); }
+
+  /**
+   * @brief Odometry at an arbitrary stamp. Lock-free, real-time safe.
+   * @param stamp Query time (ns, same clock as Header::stamp).
+   * @param sample Interpolated or extrapolated sample, with stamp set to the query time.
+   * @return RtErrorCode::OK; NO_DATA with fewer than two samples; OUT_OF_RANGE if the stamp is older than the
+   *         window or further past the newest sample than max_extrapolation_ns.
+   */
+  RtErrorCode Lookup(int64_t stamp, OdometrySample& sample) const noexcept {
+    uint64_t index = 0;
+    uint64_t head = 0;
+    const RtErrorCode code = ring_.Find(stamp, index, head);
+    if (code == RtErrorCode::NO_DATA || head < 2) {
+      return RtErrorCode::NO_DATA;
+    }
+    if (code != RtErrorCode::OK) {
+      return code;
+    }
+    OdometrySample older;
+    OdometrySample newer;
+    if (index + 1 < head) {
+      // Bracketed: older.stamp <= stamp < newer.stamp
+      if (!ring_.Read(index, older) || !ring_.Read(index + 1, newer)) {
+        return RtErrorCode::OUT_OF_RANGE;
+      }
+    } else if (!ring_.Read(head - 2, older) || !ring_.Read(head - 1, newer) || stamp - newer.stamp > max_extrapolation_ns_) {
+      return RtErrorCode::OUT_OF_RANGE;
+    }
+    const double t = static_cast<double>(stamp - older.stamp) / static_cast<double>(newer.stamp - older.stamp);
+    sample = InterpolateOdometry(older, newer, t);
+    sample.stamp = stamp;
+    return RtErrorCode::OK;
+  }
+
+  /**
+   * @brief Newest sample.
+   * @return RtErrorCode::OK, or NO_DATA before the first sample.
+   */
+  RtErrorCode GetLatest(OdometrySample& sample) const noexcept {
+    const uint64_t head = ring_.GetHead();
+    if (head == 0) {
+      return RtErrorCode::NO_DATA;
+    }
+    return ring_.Read(head - 1, sample) ? RtErrorCode::OK : RtErrorCode::OUT_OF_RANGE;
+  }
+
+  /// Number of samples appended so far.
+  uint64_t GetSampleCount() const noexcept { return ring_.GetHead(); }
+
+  /// Number of samples dropped for non-increasing stamps.
+  uint64_t GetDroppedCount() const noexcept { return ring_.GetDroppedCount(); }
+
+  /// Number of samples kept.
+  std::size_t GetCapacity() const noexcept { return ring_.GetCapacity(); }
+
+ private:
+  const int64_t max_extrapolation_ns_;
+  StampedRing<OdometrySample> ring_;  // Sample history
+  SlamNavController* controller_ = nullptr;
+};
+
+}  // namespace magic::dog::slam
@@ -0,0 +1,589 @@
+#pragma once
+
+#include "magic_type.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#if defined(__AVX2__)
+  #include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  #include <arm_neon.h>
+#endif
+
+namespace magic::dog::sensor {
+
+/************************************************************
+ *                       Point layouts                      *
+ ************************************************************/
+
+/// PointField::datatype values, as in ROS sensor_msgs/PointField.
+enum class PointFieldType : int8_t {
+  INT8 = 1,
+  UINT8 = 2,
+  INT16 = 3,
+  UINT16 = 4,
+  INT32 = 5,
+  UINT32 = 6,
+  FLOAT32 = 7,
+  FLOAT64 = 8,
+};
+
+/**
+ * @brief Point with float32 x, y, z at offsets 0, 4, 8.
+ */
+struct PointXYZ {
+  float x;  ///< x (m)
+  float y;  ///< y (m)
+  float z;  ///< z (m)
+};
+
+/**
+ * @brief Point with float32 x, y, z, intensity at offsets 0, 4, 8, 12.
+ */
+struct PointXYZI {
+  float x;          ///< x (m)
+  float y;          ///< y (m)
+  float z;          ///< z (m)
+  float intensity;  ///< Intensity
+};
+
+/**
+ * @brief Compile-time field layout of a point type: float32 fields, count 1, packed from offset 0 in this order.
+ */
+template <typename PointT>
+struct PointTraits;
+
+template <>
+struct PointTraits<PointXYZ> {
+  static constexpr std::array<const char*, 3> kFields{{"x", "y", "z"}};
+};
+
+template <>
+struct PointTraits<PointXYZI> {
+  static constexpr std::array<const char*, 4> kFields{{"x", "y", "z", "intensity"}};
+};
+
+/**
+ * @brief Whether a cloud stores points with PointT's layout, so it can be read through PointCloudView<PointT>.
+ *
+ * Extra fields after the PointT fields (padding, rgb, ring, ...) are allowed; point_step is the stride. Rows must be
+ * contiguous (row_step == width * point_step when height > 1) and the data little-endian.
+ */
+template <typename PointT>
+bool HasPointLayout(const PointCloud2& cloud) {
+  using Traits = PointTraits<PointT>;
+  static_assert(std::is_trivially_copyable_v<PointT> && sizeof(PointT) == Traits::kFields.size() * sizeof(float),
+                "PointT must be packed float32 fields");
+  if (cloud.is_bigendian || cloud.width < 0 || cloud.height < 0 || cloud.point_step < static_cast<int32_t>(sizeof(PointT)) ||
+      cloud.point_step % static_cast<int32_t>(sizeof(float)) != 0) {
+    return false;
+  }
+  if (cloud.height > 1 && static_cast<int64_t>(cloud.row_step) != static_cast<int64_t>(cloud.width) * cloud.point_step) {
+    return false;
+  }
+  const std::size_t bytes =
+      static_cast<std::size_t>(cloud.width) * static_cast<std::size_t>(cloud.height) * static_cast<std::size_t>(cloud.point_step);
+  if (bytes > cloud.data.size()) {
+    return false;
+  }
+  for (std::size_t k = 0; k < Traits::kFields.size(); ++k) {
+    const auto field = std::find_if(cloud.fields.begin(), cloud.fields.end(),
+                                    [&](const PointField& f) { return f.name == Traits::kFields[k]; });
+    if (field == cloud.fields.end() || field->offset != static_cast<int32_t>(k * sizeof(float)) ||
+        field->datatype != static_cast<int8_t>(PointFieldType::FLOAT32) || field->count > 1) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Give a cloud PointT's packed layout with count points in one row (contents unspecified, is_dense = true).
+ */
+template <typename PointT>
+void SetPointLayout(PointCloud2& cloud, std::size_t count) {
+  using Traits = PointTraits<PointT>;
+  cloud.fields.resize(Traits::kFields.size());
+  for (std::size_t k = 0; k < Traits::kFields.size(); ++k) {
+    cloud.fields[k].name = Traits::kFields[k];
+    cloud.fields[k].offset = static_cast<int32_t>(k * sizeof(float));
+    cloud.fields[k].datatype = static_cast<int8_t>(PointFieldType::FLOAT32);
+    cloud.fields[k].count = 1;
+  }
+  cloud.is_bigendian = false;
+  cloud.point_step = static_cast<int32_t>(sizeof(PointT));
+  cloud.height = 1;
+  cloud.width = static_cast<int32_t>(count);
+  cloud.row_step = cloud.width * cloud.point_step;
+  cloud.data.resize(count * sizeof(PointT));
+  cloud.is_dense = true;
+}
+
+/************************************************************
+ *                        Cloud views                       *
+ ************************************************************/
+
+/**
+ * @class BasicPointCloudView
+ * @brief Typed, copy-free access to the points of a PointCloud2 whose layout matches PointT.
+ *
+ * Field offsets and types are compile-time constants, so each access is a single load at data + i * point_step
+ * instead of a per-point lookup of PointField offset/datatype. Valid as long as the cloud's data is not reallocated.
+ * Use the PointCloudView / MutablePointCloudView aliases.
+ */
+template <typename PointT, typename Byte>
+class BasicPointCloudView {
+ public:
+  using Cloud = std::conditional_t<std::is_const_v<Byte>, const PointCloud2, PointCloud2>;
+
+  /// Forward iterator yielding points by value.
+  class Iterator {
+   public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = PointT;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const PointT*;
+    using reference = PointT;
+
+    Iterator(Byte* data, std::size_t step) : data_(data), step_(step) {}
+    PointT operator*() const {
+      PointT point;
+      std::memcpy(&point, data_, sizeof(PointT));
+      return point;
+    }
+    Iterator& operator++() {
+      data_ += step_;
+      return *this;
+    }
+    bool operator==(const Iterator& other) const { return data_ == other.data_; }
+    bool operator!=(const Iterator& other) const { return data_ != other.data_; }
+
+   private:
+    Byte* data_;
+    std::size_t step_;
+  };
+
+  BasicPointCloudView() = default;
+
+  /// View a cloud; check IsValid() for a layout match.
+  explicit BasicPointCloudView(Cloud& cloud) { Bind(cloud); }
+
+  /**
+   * @brief Point the view at a cloud.
+   * @return false, leaving an empty invalid view, if the cloud's layout does not match PointT.
+   */
+  bool Bind(Cloud& cloud) {
+    if (!HasPointLayout<PointT>(cloud)) {
+      *this = BasicPointCloudView();
+      return false;
+    }
+    data_ = cloud.data.data();
+    size_ = static_cast<std::size_t>(cloud.width) * static_cast<std::size_t>(cloud.height);
+    step_ = static_cast<std::size_t>(cloud.point_step);
+    valid_ = true;
+    return true;
+  }
+
+  /// Whether the view is bound to a matching cloud.
+  bool IsValid() const { return valid_; }
+
+  /// Number of points (width * height).
+  std::size_t Size() const { return size_; }
+
+  /// Bytes between points.
+  std::size_t Step() const { return step_; }
+
+  /// First byte of the first point.
+  Byte* Data() const { return data_; }
+
+  /// Point i.
+  PointT operator[](std::size_t i) const { return *Iterator(data_ + i * step_, step_); }
+
+  /// Field k (in PointTraits order) of point i, e.g. Get<3>(i) for intensity.
+  template <std::size_t Field>
+  float Get(std::size_t i) const {
+    static_assert(Field < PointTraits<PointT>::kFields.size(), "PointT has no such field");
+    float value;
+    std::memcpy(&value, data_ + i * step_ + Field * sizeof(float), sizeof(float));
+    return value;
+  }
+
+  float X(std::size_t i) const { return Get<0>(i); }
+  float Y(std::size_t i) const { return Get<1>(i); }
+  float Z(std::size_t i) const { return Get<2>(i); }
+
+  /// Overwrite point i; extra fields beyond PointT are kept. Mutable views only.
+  void Set(std::size_t i, const PointT& point) const {
+    static_assert(!std::is_const_v<Byte>, "Set() needs a MutablePointCloudView");
+    std::memcpy(data_ + i * step_, &point, sizeof(PointT));
+  }
+
+  Iterator begin() const { return Iterator(data_, step_); }
+  Iterator end() const { return Iterator(data_ + size_ * step_, step_); }
+
+ private:
+  Byte* data_ = nullptr;
+  std::size_t size_ = 0;
+  std::size_t step_ = 0;
+  bool valid_ = false;
+};
+
+/// Read-only typed view of a PointCloud2.
+template <typename PointT>
+using PointCloudView = BasicPointCloudView<PointT, const uint8_t>;
+
+/// Writable typed view of a PointCloud2.
+template <typename PointT>
+using MutablePointCloudView = BasicPointCloudView<PointT, uint8_t>;
+
+/************************************************************
+ *                      Cloud filters                       *
+ ************************************************************/
+
+/**
+ * @brief Axis-aligned box for CropPointCloud().
+ */
+struct CropBox {
+  std::array<float, 3> min{-std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity(),
+                           -std::numeric_limits<float>::infinity()};  ///< Lower corner (m), inclusive
+  std::array<float, 3> max{std::numeric_limits<float>::infinity(), std::numeric_limits<float>::infinity(),
+                           std::numeric_limits<float>::infinity()};  ///< Upper corner (m), inclusive
+  bool negative = false;  ///< Keep the points outside the box instead
+};
+
+namespace detail {
+
+// Copy everything but the points; the result is one row of count points.
+inline void CopyCloudLayout(const PointCloud2& in, std::size_t count, PointCloud2& out) {
+  if (&in != &out) {
+    out.header.stamp = in.header.stamp;
+    out.header.frame_id = in.header.frame_id;
+    out.fields = in.fields;
+    out.is_bigendian = in.is_bigendian;
+    out.point_step = in.point_step;
+  }
+  out.height = 1;
+  out.width = static_cast<int32_t>(count);
+  out.row_step = out.width * out.point_step;
+}
+
+// Points that can be read with a 16-byte load (x, y, z and one more float) without leaving the buffer.
+inline std::size_t WideLoadCount(std::size_t count, std::size_t step, std::size_t bytes) {
+  return bytes < 16 ? 0 : std::min(count, (bytes - 16) / step + 1);
+}
+
+// Keep-test of one point: xyz not NaN (kCheckNaN) and inside the box unless negative.
+template <bool kCheckNaN>
+inline bool KeepPoint(const uint8_t* point, const CropBox& box) {
+  float p[3];
+  std::memcpy(p, point, sizeof(p));
+  if (kCheckNaN && (std::isnan(p[0]) || std::isnan(p[1]) || std::isnan(p[2]))) {
+    return false;
+  }
+  const bool inside = p[0] >= box.min[0] && p[0] <= box.max[0] && p[1] >= box.min[1] && p[1] <= box.max[1] &&
+                      p[2] >= box.min[2] && p[2] <= box.max[2];
+  return inside != box.negative;
+}
+
+// Compact the points passing KeepPoint() into out (which may equal in), returns the number kept.
+template <bool kCheckNaN>
+std::size_t FilterPoints(const uint8_t* in, std::size_t count, std::size_t step, std::size_t bytes, const CropBox& box,
+                         uint8_t* out) {
+  std::size_t kept = 0;
+  auto keep = [&](std::size_t i) {
+    uint8_t* dst = out + kept * step;
+    const uint8_t* src = in + i * step;
+    // kept <= i, so in-place copies never overlap; fixed sizes of the common layouts compile to plain moves.
+    if (dst == src) {
+    } else if (step == sizeof(PointXYZ)) {
+      std::memcpy(dst, src, sizeof(PointXYZ));
+    } else if (step == sizeof(PointXYZI)) {
+      std::memcpy(dst, src, sizeof(PointXYZI));
+    } else {
+      std::memcpy(dst, src, step);
+    }
+    ++kept;
+  };
+  std::size_t i = 0;
+#if defined(__AVX2__)
+  const std::size_t wide = WideLoadCount(count, step, bytes);
+  // Two points per iteration, one per 128-bit lane; lane element 3 is ignored.
+  const __m128 lo4 = _mm_setr_ps(box.min[0], box.min[1], box.min[2], 0.0f);
+  const __m128 hi4 = _mm_setr_ps(box.max[0], box.max[1], box.max[2], 0.0f);
+  const __m256 lo = _mm256_insertf128_ps(_mm256_castps128_ps256(lo4), lo4, 1);
+  const __m256 hi = _mm256_insertf128_ps(_mm256_castps128_ps256(hi4), hi4, 1);
+  for (; i + 2 <= wide; i += 2) {
+    const uint8_t* p = in + i * step;
+    const __m256 v = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(reinterpret_cast<const float*>(p))),
+                                          _mm_loadu_ps(reinterpret_cast<const float*>(p + step)), 1);
+    const int inside = _mm256_movemask_ps(_mm256_and_ps(_mm256_cmp_ps(v, lo, _CMP_GE_OQ), _mm256_cmp_ps(v, hi, _CMP_LE_OQ)));
+    const int ordered = kCheckNaN ? _mm256_movemask_ps(_mm256_cmp_ps(v, v, _CMP_ORD_Q)) : 0x77;
+    if ((ordered & 0x07) == 0x07 && ((inside & 0x07) == 0x07) != box.negative) {
+      keep(i);
+    }
+    if ((ordered & 0x70) == 0x70 && ((inside & 0x70) == 0x70) != box.negative) {
+      keep(i + 1);
+    }
+  }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  const float lo_values[4] = {box.min[0], box.min[1], box.min[2], 0.0f};
+  const float hi_values[4] = {box.max[0], box.max[1], box.max[2], 0.0f};
+  const float32x4_t lo = vld1q_f32(lo_values);
+  const float32x4_t hi = vld1q_f32(hi_values);
+  // Lane 3 forced true so only xyz decide.
+  const uint32_t lane3_values[4] = {0, 0, 0, 0xffffffffu};
+  const uint32x4_t lane3 = vld1q_u32(lane3_values);
+  const std::size_t wide = WideLoadCount(count, step, bytes);
+  for (; i < wide; ++i) {
+    const float32x4_t v = vld1q_f32(reinterpret_cast<const float*>(in + i * step));
+    const bool inside = vminvq_u32(vorrq_u32(vandq_u32(vcgeq_f32(v, lo), vcleq_f32(v, hi)), lane3)) != 0;
+    const bool ordered = !kCheckNaN || vminvq_u32(vorrq_u32(vceqq_f32(v, v), lane3)) != 0;
+    if (ordered && inside != box.negative) {
+      keep(i);
+    }
+  }
+#else
+  (void)bytes;
+#endif
+  for (; i < count; ++i) {
+    if (KeepPoint<kCheckNaN>(in + i * step, box)) {
+      keep(i);
+    }
+  }
+  return kept;
+}
+
+// Shared body of RemoveNaNPoints() and CropPointCloud().
+template <typename PointT>
+bool FilterCloud(const PointCloud2& in, const CropBox& box, PointCloud2& out) {
+  if (!HasPointLayout<PointT>(in)) {
+    return false;
+  }
+  const std::size_t count = static_cast<std::size_t>(in.width) * static_cast<std::size_t>(in.height);
+  const std::size_t step = static_cast<std::size_t>(in.point_step);
+  const std::size_t bytes = in.data.size();
+  if (&in != &out) {
+    out.data.resize(count * step);
+  }
+  // A dense cloud has no NaN points to test for.
+  const std::size_t kept = in.is_dense ? FilterPoints<false>(in.data.data(), count, step, bytes, box, out.data.data())
+                                       : FilterPoints<true>(in.data.data(), count, step, bytes, box, out.data.data());
+  detail::CopyCloudLayout(in, kept, out);
+  out.data.resize(kept * step);
+  out.is_dense = true;
+  return true;
+}
+
+}  // namespace detail
+
+/**
+ * @brief Drop points whose x, y or z is NaN. A cloud marked is_dense is copied unchanged.
+ * @param out Filtered cloud (one row, is_dense = true); may be the input cloud.
+ * @return false if the cloud's layout does not match PointT.
+ */
+template <typename PointT>
+bool RemoveNaNPoints(const PointCloud2& in, PointCloud2& out) {
+  if (in.is_dense && HasPointLayout<PointT>(in)) {
+    if (&in != &out) {
+      out = in;
+    }
+    return true;
+  }
+  return detail::FilterCloud<PointT>(in, CropBox(), out);
+}
+
+/**
+ * @brief Keep the points inside (or, with box.negative, outside) an axis-aligned box; NaN points are dropped.
+ *
+ * AVX2 tests two points and NEON one point per iteration with a single packed compare on x, y, z; the NaN test is
+ * skipped for clouds marked is_dense.
+ * @param out Filtered cloud (one row, is_dense = true); may be the input cloud.
+ * @return false if the cloud's layout does not match PointT.
+ */
+template <typename PointT>
+bool CropPointCloud(const PointCloud2& in, const CropBox& box, PointCloud2& out) {
+  return detail::FilterCloud<PointT>(in, box, out);
+}
+
+/**
+ * @brief VoxelGridFilter options.
+ */
+struct VoxelGridOptions {
+  float leaf_size = 0.05f;                ///< Voxel edge (m)
+  std::size_t min_points_per_voxel = 1;  ///< Voxels with fewer points produce no output
+};
+
+/**
+ * @class VoxelGridFilter
+ * @brief Downsample a cloud to the centroid of the points in each occupied voxel.
+ *
+ * Voxel indices are computed with SIMD (two points per AVX2 iteration, one per NEON iteration) and accumulated in an
+ * open-addressing table, O(n) per cloud; output voxels are in order of first appearance. Buffers are kept between
+ * calls, so steady state does not allocate; use one filter per thread. Voxel coordinates are limited to +-2^20
+ * leaves around the origin (+-52 km at 5 cm); points outside that, and NaN or infinite points, are dropped.
+ */
+template <typename PointT>
+class VoxelGridFilter {
+ public:
+  explicit VoxelGridFilter(const VoxelGridOptions& options = VoxelGridOptions()) : options_(options) {}
+
+  /**
+   * @brief Downsample a cloud.
+   * @param out Centroids in PointT's packed layout (one row, is_dense = true); must not be the input cloud.
+   * @return false if the cloud's layout does not match PointT or the leaf size is not positive.
+   */
+  bool Apply(const PointCloud2& in, PointCloud2& out) {
+    if (!HasPointLayout<PointT>(in) || !(options_.leaf_size > 0.0f) || &in == &out) {
+      return false;
+    }
+    const std::size_t count = static_cast<std::size_t>(in.width) * static_cast<std::size_t>(in.height);
+    Reset(count);
+    Accumulate(in.data.data(), count, static_cast<std::size_t>(in.point_step), in.data.size());
+
+    SetPointLayout<PointT>(out, counts_.size());
+    out.header.stamp = in.header.stamp;
+    out.header.frame_id = in.header.frame_id;
+    std::size_t produced = 0;
+    for (std::size_t voxel = 0; voxel < counts_.size(); ++voxel) {
+      if (counts_[voxel] < options_.min_points_per_voxel) {
+        continue;
+      }
+      float* sum = &sums_[voxel * kFields];
+      const float scale = 1.0f / static_cast<float>(counts_[voxel]);
+      for (std::size_t k = 0; k < kFields; ++k) {
+        sum[k] *= scale;
+      }
+      std::memcpy(out.data.data() + produced * sizeof(PointT), sum, sizeof(PointT));
+      ++produced;
+    }
+    out.width = static_cast<int32_t>(produced);
+    out.row_step = out.width * out.point_step;
+    out.data.resize(produced * sizeof(PointT));
+    return true;
+  }
+
+  const VoxelGridOptions& GetOptions() const { return options_; }
+
+ private:
+  static constexpr std::size_t kFields = PointTraits<PointT>::kFields.size();
+  static constexpr int32_t kAxisBias = 1 << 20;           // Voxel coordinates span [-kAxisBias, kAxisBias)
+  static constexpr uint64_t kEmpty = ~uint64_t{0};        // Free table entry; real keys use 63 bits
+  static constexpr uint64_t kHashMultiplier = 0x9e3779b97f4a7c15ull;
+
+  // Size the table to at most 50 % load and clear it.
+  void Reset(std::size_t count) {
+    std::size_t capacity = 16;
+    table_bits_ = 4;
+    while (capacity < 2 * count) {
+      capacity <<= 1;
+      ++table_bits_;
+    }
+    table_keys_.assign(capacity, kEmpty);
+    table_voxels_.resize(capacity);
+    counts_.clear();
+    sums_.clear();
+  }
+
+  // Add the point to the centroid sums of its voxel.
+  void AddPoint(const int32_t* cell, const uint8_t* point) {
+    const uint64_t key = (static_cast<uint64_t>(cell[0] + kAxisBias) << 42) |
+                         (static_cast<uint64_t>(cell[1] + kAxisBias) << 21) | static_cast<uint64_t>(cell[2] + kAxisBias);
+    const std::size_t mask = table_keys_.size() - 1;
+    std::size_t slot = static_cast<std::size_t>((key * kHashMultiplier) >> (64 - table_bits_));
+    while (table_keys_[slot] != key && table_keys_[slot] != kEmpty) {
+      slot = (slot + 1) & mask;
+    }
+    if (table_keys_[slot] == kEmpty) {
+      table_keys_[slot] = key;
+      table_voxels_[slot] = static_cast<uint32_t>(counts_.size());
+      counts_.push_back(0);
+      sums_.resize(sums_.size() + kFields, 0.0f);
+    }
+    const uint32_t voxel = table_voxels_[slot];
+    float values[kFields];
+    std::memcpy(values, point, sizeof(values));
+    float* sum = &sums_[static_cast<std::size_t>(voxel) * kFields];
+    for (std::size_t k = 0; k < kFields; ++k) {
+      sum[k] += values[k];
+    }
+    ++counts_[voxel];
+  }
+
+  void Accumulate(const uint8_t* data, std::size_t count, std::size_t step, std::size_t bytes) {
+    const float inv_leaf = 1.0f / options_.leaf_size;
+    const float limit = static_cast<float>(kAxisBias);
+    std::size_t i = 0;
+#if defined(__AVX2__)
+    const std::size_t wide = detail::WideLoadCount(count, step, bytes);
+    const __m256 scale = _mm256_set1_ps(inv_leaf);
+    const __m256 lo = _mm256_set1_ps(-limit);
+    const __m256 hi = _mm256_set1_ps(limit);
+    alignas(32) int32_t cells[8];
+    for (; i + 2 <= wide; i += 2) {
+      const uint8_t* p = data + i * step;
+      const __m256 v = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(reinterpret_cast<const float*>(p))),
+                                            _mm_loadu_ps(reinterpret_cast<const float*>(p + step)), 1);
+      const __m256 cell = _mm256_floor_ps(_mm256_mul_ps(v, scale));
+      // Ordered compares also reject NaN and infinite coordinates.
+      const int valid = _mm256_movemask_ps(_mm256_and_ps(_mm256_cmp_ps(cell, lo, _CMP_GE_OQ), _mm256_cmp_ps(cell, hi, _CMP_LT_OQ)));
+      _mm256_store_si256(reinterpret_cast<__m256i*>(cells), _mm256_cvttps_epi32(cell));
+      if ((valid & 0x07) == 0x07) {
+        AddPoint(cells, p);
+      }
+      if ((valid & 0x70) == 0x70) {
+        AddPoint(cells + 4, p + step);
+      }
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    const std::size_t wide = detail::WideLoadCount(count, step, bytes);
+    const float32x4_t lo = vdupq_n_f32(-limit);
+    const float32x4_t hi = vdupq_n_f32(limit);
+    const uint32_t lane3_values[4] = {0, 0, 0, 0xffffffffu};
+    const uint32x4_t lane3 = vld1q_u32(lane3_values);
+    int32_t cells[4];
+    for (; i < wide; ++i) {
+      const uint8_t* p = data + i * step;
+      const float32x4_t cell = vrndmq_f32(vmulq_n_f32(vld1q_f32(reinterpret_cast<const float*>(p)), inv_leaf));
+      if (vminvq_u32(vorrq_u32(vandq_u32(vcgeq_f32(cell, lo), vcltq_f32(cell, hi)), lane3)) != 0) {
+        vst1q_s32(cells, vcvtq_s32_f32(cell));
+        AddPoint(cells, p);
+      }
+    }
+#else
+    (void)bytes;
+#endif
+    for (; i < count; ++i) {
+      const uint8_t* p = data + i * step;
+      float xyz[3];
+      std::memcpy(xyz, p, sizeof(xyz));
+      int32_t cells[3];
+      bool valid = true;
+      for (int k = 0; k < 3; ++k) {
+        const float cell = std::floor(xyz[k] * inv_leaf);
+        valid = valid && cell >= -limit && cell < limit;
+        cells[k] = valid ? static_cast<int32_t>(cell) : 0;
+      }
+      if (valid) {
+        AddPoint(cells, p);
+      }
+    }
+  }
+
+  VoxelGridOptions options_;
+  int table_bits_ = 4;
+  std::vector<uint64_t> table_keys_;    // Open-addressing table: voxel key, kEmpty if free
+  std::vector<uint32_t> table_voxels_;  // Voxel number of each table entry
+  std::vector<uint32_t> counts_;        // Points per voxel
+  std::vector<float> sums_;             // Field sums per voxel, kFields each
+};
+
+}  // namespace magic::dog::sensor
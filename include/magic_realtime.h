@@ -0,0 +1,440 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+
+namespace magic::dog {
+
+/************************************************************
+ *                   Real-time primitives                   *
+ ************************************************************/
+
+constexpr std::size_t kCacheLineSize = 64;  ///< Cache line size used to pad shared atomics
+
+/**
+ * @brief Result code for real-time paths.
+ *
+ * Plain enum without message string, so it can be returned from hot paths without heap allocation.
+ */
+enum class RtErrorCode : int8_t {
+  OK = 0,           ///< Success
+  NOT_RUNNING = 1,  ///< The real-time component has not been started
+  QUEUE_FULL = 2,   ///< No free slot, the item was dropped
+  NO_DATA = 3,      ///< Nothing has been received yet
+  OUT_OF_RANGE = 4,  ///< Requested time is outside the buffered window
+};
+
+/**
+ * @brief Bounded lock-free single-producer/single-consumer ring.
+ *
+ * All storage is preallocated inline, push and pop never allocate or lock.
+ * Exactly one thread may call TryPush and exactly one (other) thread may call TryPop.
+ *
+ * @tparam T Element type, must be trivially copyable.
+ * @tparam Capacity Number of slots, must be a power of two.
+ */
+template <typename T, std::size_t Capacity>
+class SpscRing {
+  static_assert(std::is_trivially_copyable_v<T>, "SpscRing element must be trivially copyable");
+  static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "SpscRing capacity must be a power of two");
+
+ public:
+  /**
+   * @brief Push an element (producer thread only).
+   * @param item Element to copy into the ring.
+   * @return false if the ring is full.
+   */
+  bool TryPush(const T& item) noexcept {
+    const std::size_t head = head_.load(std::memory_order_relaxed);
+    if (head - cached_tail_ >= Capacity) {
+      cached_tail_ = tail_.load(std::memory_order_acquire);
+      if (head - cached_tail_ >= Capacity) {
+        return false;
+      }
+    }
+    slots_[head & (Capacity - 1)] = item;
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief Pop the oldest element (consumer thread only).
+   * @param item Output element.
+   * @return false if the ring is empty.
+   */
+  bool TryPop(T& item) noexcept {
+    const std::size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail == cached_head_) {
+      cached_head_ = head_.load(std::memory_order_acquire);
+      if (tail == cached_head_) {
+        return false;
+      }
+    }
+    item = slots_[tail & (Capacity - 1)];
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @brief Approximate number of queued elements, safe to call from any thread.
+   */
+  std::size_t Size() const noexcept {
+    return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+  }
+
+  static constexpr std::size_t capacity() noexcept { return Capacity; }
+
+ private:
+  alignas(kCacheLineSize) std::atomic<std::size_t> head_{0};  // Written by producer
+  std::size_t cached_tail_ = 0;                               // Producer-local copy of tail_
+  alignas(kCacheLineSize) std::atomic<std::size_t> tail_{0};  // Written by consumer
+  std::size_t cached_head_ = 0;                               // Consumer-local copy of head_
+  alignas(kCacheLineSize) std::array<T, Capacity> slots_{};
+};
+
+/**
+ * @brief Latest-value mailbox based on a sequence lock.
+ *
+ * One writer publishes snapshots with Store(); any number of readers poll the most recent snapshot with Load().
+ * Neither side allocates, locks or touches a reference count. The payload is kept in atomic words, so a reader
+ * racing with the writer simply retries instead of observing a torn value.
+ *
+ * @tparam T Snapshot type, must be trivially copyable.
+ */
+template <typename T>
+class SeqLock {
+  static_assert(std::is_trivially_copyable_v<T>, "SeqLock payload must be trivially copyable");
+
+  static constexpr std::size_t kWords = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+ public:
+  /**
+   * @brief Publish a new snapshot (single writer only).
+   */
+  void Store(const T& value) noexcept {
+    std::array<uint64_t, kWords> words{};
+    std::memcpy(words.data(), &value, sizeof(T));
+    const uint64_t seq = seq_.load(std::memory_order_relaxed);
+    seq_.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (std::size_t i = 0; i < kWords; ++i) {
+      words_[i].store(words[i], std::memory_order_relaxed);
+    }
+    seq_.store(seq + 2, std::memory_order_release);
+  }
+
+  /**
+   * @brief Copy out the most recent snapshot (any thread).
+   * @param value Output snapshot.
+   * @param version Output number of snapshots published so far, may be used to detect new data.
+   * @return RtErrorCode::OK, or RtErrorCode::NO_DATA if nothing has been stored yet.
+   */
+  RtErrorCode Load(T& value, uint64_t& version) const noexcept {
+    std::array<uint64_t, kWords> words;
+    uint64_t begin = 0;
+    while (true) {
+      begin = seq_.load(std::memory_order_acquire);
+      if (begin == 0) {
+        return RtErrorCode::NO_DATA;
+      }
+      if (begin & 1) {
+        continue;
+      }
+      for (std::size_t i = 0; i < kWords; ++i) {
+        words[i] = words_[i].load(std::memory_order_relaxed);
+      }
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (seq_.load(std::memory_order_relaxed) == begin) {
+        break;
+      }
+    }
+    std::memcpy(static_cast<void*>(&value), words.data(), sizeof(T));
+    version = begin / 2;
+    return RtErrorCode::OK;
+  }
+
+  /**
+   * @brief Number of snapshots published so far.
+   */
+  uint64_t Version() const noexcept { return seq_.load(std::memory_order_acquire) / 2; }
+
+ private:
+  alignas(kCacheLineSize) std::atomic<uint64_t> seq_{0};  // Odd while a write is in progress
+  std::array<std::atomic<uint64_t>, kWords> words_{};       // Payload storage
+};
+
+/**
+ * @brief Bounded history of timestamped samples, one writer and lock-free readers.
+ *
+ * Every slot is a sequence lock whose sequence encodes the absolute sample index (2 * index + 2 once stored), so a
+ * reader detects a slot overwritten under it and treats the sample as outside the window. Samples must arrive with
+ * increasing stamps, which makes the window searchable in O(log capacity).
+ *
+ * @tparam T Sample type, trivially copyable with an int64_t `stamp` member.
+ */
+template <typename T>
+class StampedRing {
+  static_assert(std::is_trivially_copyable_v<T>, "StampedRing sample must be trivially copyable");
+
+  static constexpr std::size_t kWords = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+ public:
+  /**
+   * @param capacity Samples kept, rounded up to a power of two.
+   */
+  explicit StampedRing(std::size_t capacity) : capacity_(RoundUpPowerOfTwo(capacity)), slots_(std::make_unique<Slot[]>(capacity_)) {}
+
+  /**
+   * @brief Append a sample (single writer only).
+   * @return false if the stamp does not increase; the sample is dropped.
+   */
+  bool Push(const T& sample) noexcept {
+    const uint64_t index = head_.load(std::memory_order_relaxed);
+    if (index > 0 && sample.stamp <= last_stamp_) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    std::array<uint64_t, kWords> words{};
+    std::memcpy(words.data(), &sample, sizeof(T));
+    Slot& slot = slots_[index & (capacity_ - 1)];
+    slot.seq.store(2 * index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (std::size_t i = 0; i < kWords; ++i) {
+      slot.words[i].store(words[i], std::memory_order_relaxed);
+    }
+    slot.seq.store(2 * index + 2, std::memory_order_release);
+    head_.store(index + 1, std::memory_order_release);
+    last_stamp_ = sample.stamp;
+    return true;
+  }
+
+  /**
+   * @brief Copy out sample `index` (any thread).
+   * @return false if the sample has not been stored or its slot was reused for a newer one.
+   */
+  bool Read(uint64_t index, T& sample) const noexcept {
+    const Slot& slot = slots_[index & (capacity_ - 1)];
+    const uint64_t expected = 2 * index + 2;
+    if (slot.seq.load(std::memory_order_acquire) != expected) {
+      return false;
+    }
+    std::array<uint64_t, kWords> words;
+    for (std::size_t i = 0; i < kWords; ++i) {
+      words[i] = slot.words[i].load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.seq.load(std::memory_order_relaxed) != expected) {
+      return false;
+    }
+    std::memcpy(static_cast<void*>(&sample), words.data(), sizeof(T));
+    return true;
+  }
+
+  /**
+   * @brief Index of the last sample with stamp <= the query, in O(log capacity).
+   * @param index Output sample index, valid for Read() until overwritten.
+   * @param head Samples stored when the search started.
+   * @return RtErrorCode::OK; NO_DATA if empty; OUT_OF_RANGE if the stamp is older than the window.
+   */
+  RtErrorCode Find(int64_t stamp, uint64_t& index, uint64_t& head) const noexcept {
+    head = head_.load(std::memory_order_acquire);
+    if (head == 0) {
+      return RtErrorCode::NO_DATA;
+    }
+    // First sample with stamp > query in [lo, head]; slots overwritten meanwhile compare as too old.
+    uint64_t lo = head > capacity_ ? head - capacity_ : 0;
+    uint64_t hi = head;
+    T sample;
+    while (lo < hi) {
+      const uint64_t mid = lo + (hi - lo) / 2;
+      if (!Read(mid, sample) || sample.stamp <= stamp) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    if (lo == 0 || !Read(lo - 1, sample)) {
+      return RtErrorCode::OUT_OF_RANGE;
+    }
+    index = lo - 1;
+    return RtErrorCode::OK;
+  }
+
+  /// Number of samples appended so far; the newest has index GetHead() - 1.
+  uint64_t GetHead() const noexcept { return head_.load(std::memory_order_acquire); }
+
+  /// Number of samples dropped for non-increasing stamps.
+  uint64_t GetDroppedCount() const noexcept { return dropped_.load(std::memory_order_relaxed); }
+
+  /// Number of samples kept.
+  std::size_t GetCapacity() const noexcept { return capacity_; }
+
+ private:
+  struct alignas(kCacheLineSize) Slot {
+    std::atomic<uint64_t> seq{0};                        // 2 * index + 2 once sample index is stored, odd while writing
+    std::array<std::atomic<uint64_t>, kWords> words{};  // Payload storage
+  };
+
+  static std::size_t RoundUpPowerOfTwo(std::size_t value) {
+    std::size_t capacity = 2;
+    while (capacity < value) {
+      capacity <<= 1;
+    }
+    return capacity;
+  }
+
+  const std::size_t capacity_;
+  std::unique_ptr<Slot[]> slots_;                           // Sample ring
+  alignas(kCacheLineSize) std::atomic<uint64_t> head_{0};  // Samples appended, published after the slot
+  int64_t last_stamp_ = 0;                                 // Writer only
+  std::atomic<uint64_t> dropped_{0};
+};
+
+/**
+ * @brief Read CLOCK_MONOTONIC (std::chrono::steady_clock) in nanoseconds.
+ */
+inline int64_t SteadyNowNs() noexcept {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief Fixed-memory log-linear latency histogram.
+ *
+ * Values are bucketed with 8 linear sub-buckets per power of two (at most 12.5% relative error).
+ * Record() is lock-free and allocation-free and may be called from several threads; the query
+ * functions may run concurrently and see an approximate, monotonically growing snapshot.
+ */
+class LatencyHistogram {
+ public:
+  static constexpr std::size_t kSubBucketBits = 3;
+  static constexpr std::size_t kSubBuckets = 1u << kSubBucketBits;
+  static constexpr std::size_t kLinearLimit = 2 * kSubBuckets;  ///< Values below are counted exactly
+  static constexpr std::size_t kBucketCount = kLinearLimit + (64 - (kSubBucketBits + 1)) * kSubBuckets;
+
+  /**
+   * @brief Add one sample. Negative values are counted as zero.
+   * @param value_ns Sample value, usually nanoseconds.
+   */
+  void Record(int64_t value_ns) noexcept {
+    const uint64_t value = value_ns > 0 ? static_cast<uint64_t>(value_ns) : 0;
+    buckets_[BucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(value, std::memory_order_relaxed);
+    uint64_t max = max_.load(std::memory_order_relaxed);
+    while (value > max && !max_.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+    }
+  }
+
+  /**
+   * @brief Clear all samples. Not synchronized with concurrent Record() calls.
+   */
+  void Reset() noexcept {
+    for (auto& bucket : buckets_) {
+      bucket.store(0, std::memory_order_relaxed);
+    }
+    count_.store(0, std::memory_order_relaxed);
+    sum_.store(0, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+  }
+
+  /// Number of recorded samples.
+  uint64_t Count() const noexcept { return count_.load(std::memory_order_relaxed); }
+
+  /// Largest recorded sample.
+  int64_t Max() const noexcept { return static_cast<int64_t>(max_.load(std::memory_order_relaxed)); }
+
+  /// Mean of the recorded samples, 0 if empty.
+  double Mean() const noexcept {
+    const uint64_t count = Count();
+    return count == 0 ? 0.0 : static_cast<double>(sum_.load(std::memory_order_relaxed)) / static_cast<double>(count);
+  }
+
+  /**
+   * @brief Value at the given percentile (upper bound of the matching bucket, capped by Max()).
+   * @param percentile Percentile in [0, 100], e.g. 99.9.
+   * @return Percentile value, 0 if empty.
+   */
+  int64_t Percentile(double percentile) const noexcept {
+    const uint64_t count = Count();
+    if (count == 0) {
+      return 0;
+    }
+    const double clamped = percentile < 0.0 ? 0.0 : (percentile > 100.0 ? 100.0 : percentile);
+    uint64_t rank = static_cast<uint64_t>(clamped / 100.0 * static_cast<double>(count) + 0.5);
+    rank = rank == 0 ? 1 : rank;
+    uint64_t seen = 0;
+    for (std::size_t i = 0; i < kBucketCount; ++i) {
+      seen += buckets_[i].load(std::memory_order_relaxed);
+      if (seen >= rank) {
+        const uint64_t upper = BucketUpperBound(i);
+        const uint64_t max = max_.load(std::memory_order_relaxed);
+        return static_cast<int64_t>(upper < max ? upper : max);
+      }
+    }
+    return Max();
+  }
+
+  /// Number of samples in the given bucket.
+  uint64_t BucketCount(std::size_t index) const noexcept { return buckets_[index].load(std::memory_order_relaxed); }
+
+  /// Largest value that falls into the given bucket.
+  static constexpr uint64_t BucketUpperBound(std::size_t index) noexcept {
+    if (index < kLinearLimit) {
+      return index;
+    }
+    const std::size_t exponent = (index - kLinearLimit) / kSubBuckets + kSubBucketBits + 1;
+    const uint64_t sub = (index - kLinearLimit) % kSubBuckets;
+    const uint64_t width = uint64_t{1} << (exponent - kSubBucketBits);
+    return ((kSubBuckets + sub) << (exponent - kSubBucketBits)) + width - 1;
+  }
+
+  /// Bucket that the given value falls into.
+  static constexpr std::size_t BucketIndex(uint64_t value) noexcept {
+    if (value < kLinearLimit) {
+      return static_cast<std::size_t>(value);
+    }
+    const std::size_t exponent = 63 - static_cast<std::size_t>(__builtin_clzll(value));
+    const std::size_t sub = static_cast<std::size_t>(value >> (exponent - kSubBucketBits)) & (kSubBuckets - 1);
+    return kLinearLimit + (exponent - kSubBucketBits - 1) * kSubBuckets + sub;
+  }
+
+ private:
+  std::array<std::atomic<uint64_t>, kBucketCount> buckets_{};  // Sample counts per bucket
+  std::atomic<uint64_t> count_{0};                             // Total number of samples
+  std::atomic<uint64_t> sum_{0};                               // Sum of samples, for Mean()
+  std::atomic<uint64_t> max_{0};                               // Largest sample
+};
+
+/**
+ * @brief Summary statistics of a LatencyHistogram.
+ */
+struct LatencySummary {
+  uint64_t count = 0;  ///< Number of samples
+  double mean = 0.0;   ///< Mean (ns)
+  int64_t p50 = 0;     ///< Median (ns)
+  int64_t p99 = 0;     ///< 99th percentile (ns)
+  int64_t p999 = 0;    ///< 99.9th percentile (ns)
+  int64_t max = 0;     ///< Maximum (ns)
+};
+
+/**
+ * @brief Compute the summary statistics of a histogram.
+ */
+inline LatencySummary Summarize(const LatencyHistogram& histogram) noexcept {
+  LatencySummary summary;
+  summary.count = histogram.Count();
+  summary.mean = histogram.Mean();
+  summary.p50 = histogram.Percentile(50.0);
+  summary.p99 = histogram.Percentile(99.0);
+  summary.p999 = histogram.Percentile(99.9);
+  summary.max = histogram.Max();
+  return summary;
+}
+
+}  // namespace magic::dog
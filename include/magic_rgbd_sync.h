@@ -0,0 +1,298 @@
+#pragma once
+
+#include "magic_realtime.h"
+#include "magic_sensor.h"
+#include "magic_type.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <utility>
+
+namespace magic::dog::sensor {
+
+/************************************************************
+ *                    RGB-D synchronization                 *
+ ************************************************************/
+
+/**
+ * @brief Color and depth frames with their camera infos, matched by Header::stamp.
+ */
+struct RgbdBundle {
+  int64_t stamp = 0;                        ///< Color image stamp (ns)
+  int64_t max_skew_ns = 0;                  ///< Largest |member stamp - stamp| in the bundle
+  std::shared_ptr<Image> color;             ///< RGBD color image
+  std::shared_ptr<Image> depth;             ///< RGBD depth image
+  std::shared_ptr<CameraInfo> color_info;   ///< Color camera intrinsics
+  std::shared_ptr<CameraInfo> depth_info;   ///< Depth camera intrinsics
+};
+
+/**
+ * @brief RgbdSynchronizer options.
+ */
+struct RgbdSyncOptions {
+  int64_t tolerance_ns = 10000000;  ///< Largest stamp difference to the color frame; keep below half the frame period
+  bool match_camera_info = true;    ///< Match CameraInfo stamps too; false attaches the latest CameraInfo received
+};
+
+/**
+ * @class RgbdSynchronizer
+ * @brief Approximate-time matcher pairing RGBD color, depth and both CameraInfo streams into one bundle callback.
+ *
+ * Each stream hands its messages over through lock-free SPSC rings; whichever callback thread completes a set runs
+ * the matcher and delivers the bundle right away, so synchronization adds no queueing delay beyond waiting for the
+ * last member. Only one thread matches at a time (a try-acquire flag, never a wait); messages arriving meanwhile
+ * are picked up before that thread leaves. Matching is greedy: as soon as every stream has a staged message within
+ * tolerance of the color frame, the closest of those is taken, and a closer partner arriving later is never
+ * considered; keep the tolerance below half the frame period so at most one candidate qualifies. Messages that can
+ * no longer match are dropped and counted.
+ *
+ * Each Add*() may be called from one thread at a time; different streams may use different threads.
+ */
+class RgbdSynchronizer final : public NonCopyable {
+ public:
+  using ImagePtr = std::shared_ptr<Image>;
+  using CameraInfoPtr = std::shared_ptr<CameraInfo>;
+  using BundleCallback = std::function<void(const RgbdBundle&)>;
+
+  static constexpr std::size_t kStagingCapacity = 8;  ///< Messages held per stream while waiting for partners
+
+  /**
+   * @param callback Bundle callback, run on the SDK callback thread that completed the bundle; keep it short.
+   */
+  explicit RgbdSynchronizer(const BundleCallback& callback, const RgbdSyncOptions& options = RgbdSyncOptions())
+      : options_(options), callback_(callback) {}
+
+  /// Destructor, unsubscribes if still attached.
+  ~RgbdSynchronizer() { Detach(); }
+
+  /**
+   * @brief Subscribe to the four RGBD streams of the controller.
+   * @note Replaces any RGBD image and camera info callbacks previously registered on the controller.
+   */
+  void Attach(SensorController& controller) {
+    Detach();
+    controller_ = &controller;
+    controller.SubscribeRgbdColorCameraInfo([this](const CameraInfoPtr msg) { AddColorInfo(msg); });
+    controller.SubscribeRgbDepthCameraInfo([this](const CameraInfoPtr msg) { AddDepthInfo(msg); });
+    controller.SubscribeRgbdColorImage([this](const ImagePtr msg) { AddColor(msg); });
+    controller.SubscribeRgbdDepthImage([this](const ImagePtr msg) { AddDepth(msg); });
+  }
+
+  /**
+   * @brief Unsubscribe from the attached controller.
+   */
+  void Detach() {
+    if (controller_ != nullptr) {
+      controller_->UnsubscribeRgbdColorImage();
+      controller_->UnsubscribeRgbdDepthImage();
+      controller_->UnsubscribeRgbdColorCameraInfo();
+      controller_->UnsubscribeRgbDepthCameraInfo();
+      controller_ = nullptr;
+    }
+  }
+
+  void AddColor(const ImagePtr& msg) { Add(color_, msg); }            ///< Feed a color image
+  void AddDepth(const ImagePtr& msg) { Add(depth_, msg); }            ///< Feed a depth image
+  void AddColorInfo(const CameraInfoPtr& msg) { Add(color_info_, msg); }  ///< Feed color intrinsics
+  void AddDepthInfo(const CameraInfoPtr& msg) { Add(depth_info_, msg); }  ///< Feed depth intrinsics
+
+  /// Number of bundles delivered.
+  uint64_t GetBundleCount() const { return bundles_.load(std::memory_order_relaxed); }
+
+  /// Number of messages discarded without a partner within tolerance.
+  uint64_t GetUnmatchedCount() const { return unmatched_.load(std::memory_order_relaxed); }
+
+  /// Number of messages discarded because a stream's staging was full (a partner stream stalled).
+  uint64_t GetOverflowCount() const { return overflow_.load(std::memory_order_relaxed); }
+
+ private:
+  // Per-stream hand-over: producers fill a free slot and publish its index; the matcher moves it into staging.
+  template <typename Msg>
+  struct Stream {
+    Stream() {
+      for (uint32_t i = 0; i < kStagingCapacity; ++i) {
+        free.TryPush(i);
+      }
+    }
+
+    std::array<std::shared_ptr<Msg>, kStagingCapacity> slots;   // Messages in hand-over
+    SpscRing<uint32_t, kStagingCapacity> ready;                 // Producer -> matcher slot indices
+    SpscRing<uint32_t, kStagingCapacity> free;                  // Matcher -> producer slot indices
+    // Matcher-owned
+    std::array<std::shared_ptr<Msg>, kStagingCapacity> staged;  // Waiting messages, oldest first
+    std::size_t begin = 0;
+    std::size_t count = 0;
+    std::shared_ptr<Msg> latest;                                // Newest message of an unmatched stream
+
+    const std::shared_ptr<Msg>& At(std::size_t i) const { return staged[(begin + i) % kStagingCapacity]; }
+    int64_t StampAt(std::size_t i) const { return At(i)->header.stamp; }
+    void PopFront(std::size_t n = 1) {
+      for (std::size_t i = 0; i < n; ++i) {
+        staged[begin].reset();
+        begin = (begin + 1) % kStagingCapacity;
+      }
+      count -= n;
+    }
+  };
+
+  template <typename Msg>
+  void Add(Stream<Msg>& stream, const std::shared_ptr<Msg>& msg) {
+    if (!msg) {
+      return;
+    }
+    uint32_t slot = 0;
+    if (!stream.free.TryPop(slot)) {
+      overflow_.fetch_add(1, std::memory_order_relaxed);
+    } else {
+      stream.slots[slot] = msg;
+      stream.ready.TryPush(slot);  // Cannot fail: only kStagingCapacity slot indices exist
+    }
+    // Pairs with the fence in Run(): either this thread sees matching_ cleared or the matcher sees the push.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    Run();
+  }
+
+  // Become the matcher unless another thread is; loop while messages raced in during matching.
+  void Run() {
+    while (!matching_.exchange(true, std::memory_order_acquire)) {
+      Drain(color_, true);
+      Drain(depth_, true);
+      Drain(color_info_, options_.match_camera_info);
+      Drain(depth_info_, options_.match_camera_info);
+      Match();
+      matching_.store(false, std::memory_order_release);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (color_.ready.Size() + depth_.ready.Size() + color_info_.ready.Size() + depth_info_.ready.Size() == 0) {
+        return;
+      }
+    }
+  }
+
+  // Move handed-over messages into staging, or only keep the newest one when the stream is not matched.
+  template <typename Msg>
+  void Drain(Stream<Msg>& stream, bool stage) {
+    uint32_t slot = 0;
+    while (stream.ready.TryPop(slot)) {
+      std::shared_ptr<Msg> msg = std::move(stream.slots[slot]);
+      stream.free.TryPush(slot);
+      if (!stage) {
+        stream.latest = std::move(msg);
+        continue;
+      }
+      if (stream.count > 0 && msg->header.stamp <= stream.StampAt(stream.count - 1)) {
+        unmatched_.fetch_add(1, std::memory_order_relaxed);  // Out of order
+        continue;
+      }
+      if (stream.count == kStagingCapacity) {
+        stream.PopFront();
+        overflow_.fetch_add(1, std::memory_order_relaxed);
+      }
+      stream.staged[(stream.begin + stream.count) % kStagingCapacity] = std::move(msg);
+      ++stream.count;
+    }
+  }
+
+  enum class Candidate { FOUND, WAIT, NEVER };
+
+  // Closest staged message within tolerance of stamp, after dropping messages too old to match it.
+  template <typename Msg>
+  Candidate FindPartner(Stream<Msg>& stream, int64_t stamp, std::size_t& index) {
+    const int64_t tolerance = options_.tolerance_ns;
+    std::size_t stale = 0;
+    while (stale < stream.count && stream.StampAt(stale) < stamp - tolerance) {
+      ++stale;
+    }
+    stream.PopFront(stale);
+    unmatched_.fetch_add(stale, std::memory_order_relaxed);
+    if (stream.count == 0) {
+      return Candidate::WAIT;
+    }
+    if (stream.StampAt(0) > stamp + tolerance) {
+      return Candidate::NEVER;
+    }
+    index = 0;
+    for (std::size_t i = 1; i < stream.count && stream.StampAt(i) <= stamp + tolerance; ++i) {
+      if (std::llabs(stream.StampAt(i) - stamp) < std::llabs(stream.StampAt(index) - stamp)) {
+        index = i;
+      }
+    }
+    return Candidate::FOUND;
+  }
+
+  static Candidate Combine(Candidate a, Candidate b) {
+    if (a == Candidate::NEVER || b == Candidate::NEVER) {
+      return Candidate::NEVER;
+    }
+    return a == Candidate::WAIT || b == Candidate::WAIT ? Candidate::WAIT : Candidate::FOUND;
+  }
+
+  void Match() {
+    while (color_.count > 0) {
+      const int64_t stamp = color_.StampAt(0);
+      std::size_t depth_index = 0;
+      std::size_t color_info_index = 0;
+      std::size_t depth_info_index = 0;
+      Candidate state = FindPartner(depth_, stamp, depth_index);
+      if (options_.match_camera_info) {
+        state = Combine(state, FindPartner(color_info_, stamp, color_info_index));
+        state = Combine(state, FindPartner(depth_info_, stamp, depth_info_index));
+      } else if (!color_info_.latest || !depth_info_.latest) {
+        state = Combine(state, Candidate::WAIT);
+      }
+      if (state == Candidate::WAIT) {
+        return;
+      }
+      if (state == Candidate::NEVER) {
+        color_.PopFront();
+        unmatched_.fetch_add(1, std::memory_order_relaxed);
+        continue;
+      }
+
+      RgbdBundle bundle;
+      bundle.stamp = stamp;
+      bundle.color = color_.At(0);
+      bundle.depth = depth_.At(depth_index);
+      bundle.max_skew_ns = std::llabs(bundle.depth->header.stamp - stamp);
+      color_.PopFront();
+      depth_.PopFront(depth_index + 1);
+      if (options_.match_camera_info) {
+        bundle.color_info = color_info_.At(color_info_index);
+        bundle.depth_info = depth_info_.At(depth_info_index);
+        bundle.max_skew_ns = std::max<int64_t>({bundle.max_skew_ns, std::llabs(bundle.color_info->header.stamp - stamp),
+                                                std::llabs(bundle.depth_info->header.stamp - stamp)});
+        color_info_.PopFront(color_info_index + 1);
+        depth_info_.PopFront(depth_info_index + 1);
+      } else {
+        bundle.color_info = color_info_.latest;
+        bundle.depth_info = depth_info_.latest;
+      }
+      // Skipped partner candidates were older than the chosen one and can no longer match.
+      unmatched_.fetch_add(depth_index + (options_.match_camera_info ? color_info_index + depth_info_index : 0),
+                           std::memory_order_relaxed);
+      bundles_.fetch_add(1, std::memory_order_relaxed);
+      if (callback_) {
+        callback_(bundle);
+      }
+    }
+  }
+
+  const RgbdSyncOptions options_;
+  const BundleCallback callback_;
+  SensorController* controller_ = nullptr;
+  std::atomic<bool> matching_{false};  // Held by the thread running the matcher
+  Stream<Image> color_;
+  Stream<Image> depth_;
+  Stream<CameraInfo> color_info_;
+  Stream<CameraInfo> depth_info_;
+  std::atomic<uint64_t> bundles_{0};
+  std::atomic<uint64_t> unmatched_{0};
+  std::atomic<uint64_t> overflow_{0};
+};
+
+}  // namespace magic::dog::sensor
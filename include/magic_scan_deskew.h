@@ -0,0 +1,469 @@
+#pragma once
+
+#include "magic_frame_pool.h"
+#include "magic_laser_scan.h"
+#include "magic_odometry_buffer.h"
+#include "magic_realtime.h"
+#include "magic_sensor.h"
+#include "magic_type.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace magic::dog::sensor {
+
+/************************************************************
+ *                        IMU buffer                        *
+ ************************************************************/
+
+/**
+ * @brief Gyro sample kept by ImuBuffer.
+ */
+struct ImuSample {
+  int64_t stamp = 0;                         ///< Imu::timestamp (ns)
+  std::array<double, 3> angular_velocity{};  ///< Angular velocity (rad/s), body frame
+};
+
+/**
+ * @class ImuBuffer
+ * @brief Lock-free history of IMU angular velocity for rotation integration.
+ */
+class ImuBuffer final : public NonCopyable {
+ public:
+  /**
+   * @param capacity Samples kept, rounded up to a power of two (default ~2 s at 1 kHz).
+   */
+  explicit ImuBuffer(std::size_t capacity = 2048) : ring_(capacity) {}
+
+  /// Destructor, unsubscribes if still attached.
+  ~ImuBuffer() { Detach(); }
+
+  /**
+   * @brief Subscribe to IMU data on the given controller and feed this buffer.
+   * @param controller Initialized sensor controller, must outlive the attachment.
+   * @note Replaces any IMU callback previously registered on the controller.
+   */
+  void Attach(SensorController& controller) {
+    Detach();
+    controller_ = &controller;
+    controller.SubscribeImu([this](const std::shared_ptr<Imu> msg) {
+      if (msg) {
+        Update(*msg);
+      }
+    });
+  }
+
+  /**
+   * @brief Unsubscribe from the attached controller.
+   */
+  void Detach() {
+    if (controller_ != nullptr) {
+      controller_->UnsubscribeImu();
+      controller_ = nullptr;
+    }
+  }
+
+  /**
+   * @brief Append a sample (single writer, normally the subscription callback).
+   * @return false if the timestamp does not increase.
+   */
+  bool Update(const Imu& imu) noexcept { return ring_.Push(ImuSample{imu.timestamp, imu.angular_velocity}); }
+
+  /// @copydoc Update(const Imu&)
+  bool Update(const ImuSample& sample) noexcept { return ring_.Push(sample); }
+
+  /**
+   * @brief Integrate the angular velocity into the rotation of the body at each of a series of times.
+   * @param stamps Increasing times (ns); the rotation at stamps[0] is the identity.
+   * @param count Number of stamps.
+   * @param rotations Output rotation quaternions (w, x, y, z) of the body at each stamp relative to stamps[0].
+   * @param max_gap_ns Longest time to hold the newest sample past its stamp.
+   * @return RtErrorCode::OK; NO_DATA if empty; OUT_OF_RANGE if the samples do not cover the times.
+   */
+  RtErrorCode IntegrateRotations(const int64_t* stamps, std::size_t count, std::array<double, 4>* rotations,
+                                 int64_t max_gap_ns) const noexcept {
+    if (count == 0) {
+      return RtErrorCode::OK;
+    }
+    uint64_t index = 0;
+    uint64_t head = 0;
+    const RtErrorCode code = ring_.Find(stamps[0], index, head);
+    if (code != RtErrorCode::OK) {
+      return code;
+    }
+    ImuSample current;
+    ImuSample next;
+    if (!ring_.Read(index, current)) {
+      return RtErrorCode::OUT_OF_RANGE;
+    }
+    bool has_next = index + 1 < head && ring_.Read(index + 1, next);
+    std::array<double, 4> q{1.0, 0.0, 0.0, 0.0};
+    int64_t t = stamps[0];
+    rotations[0] = q;
+    for (std::size_t k = 1; k < count; ++k) {
+      // Zero-order hold of each sample until the next one.
+      while (has_next && next.stamp <= stamps[k]) {
+        Rotate(q, current.angular_velocity, next.stamp - t);
+        t = next.stamp;
+        current = next;
+        ++index;
+        has_next = index + 1 < head && ring_.Read(index + 1, next);
+      }
+      if (!has_next && stamps[k] - current.stamp > max_gap_ns) {
+        return RtErrorCode::OUT_OF_RANGE;
+      }
+      Rotate(q, current.angular_velocity, stamps[k] - t);
+      t = stamps[k];
+      rotations[k] = q;
+    }
+    return RtErrorCode::OK;
+  }
+
+  /// Number of samples appended so far.
+  uint64_t GetSampleCount() const noexcept { return ring_.GetHead(); }
+
+ private:
+  // q = q * exp(omega * dt / 2)
+  static void Rotate(std::array<double, 4>& q, const std::array<double, 3>& omega, int64_t dt_ns) noexcept {
+    const double dt = static_cast<double>(dt_ns) * 1e-9;
+    const double angle = std::sqrt(omega[0] * omega[0] + omega[1] * omega[1] + omega[2] * omega[2]) * dt;
+    if (angle <= 0.0) {
+      return;
+    }
+    const double half = 0.5 * angle;
+    const double s = std::sin(half) / angle * dt;
+    const std::array<double, 4> d{std::cos(half), omega[0] * s, omega[1] * s, omega[2] * s};
+    q = {q[0] * d[0] - q[1] * d[1] - q[2] * d[2] - q[3] * d[3], q[0] * d[1] + q[1] * d[0] + q[2] * d[3] - q[3] * d[2],
+         q[0] * d[2] - q[1] * d[3] + q[2] * d[0] + q[3] * d[1], q[0] * d[3] + q[1] * d[2] - q[2] * d[1] + q[3] * d[0]};
+  }
+
+  StampedRing<ImuSample> ring_;             // Sample history
+  SensorController* controller_ = nullptr;
+};
+
+/************************************************************
+ *                       Scan deskewing                     *
+ ************************************************************/
+
+/// Time the deskewed points refer to.
+enum class DeskewReference {
+  FIRST_BEAM = 0,  ///< Header stamp
+  LAST_BEAM = 1,   ///< Header stamp + (count - 1) * time_increment, the newest beam
+};
+
+/**
+ * @brief ScanDeskewer options.
+ */
+struct ScanDeskewOptions {
+  LaserScanUnits units;                                 ///< Units of the LaserScan header fields
+  DeskewReference reference = DeskewReference::LAST_BEAM;
+  std::array<double, 3> laser_position{};              ///< Laser origin in the body frame (m)
+  std::array<double, 4> laser_orientation{1, 0, 0, 0};  ///< Laser orientation in the body frame (w, x, y, z)
+  std::size_t knots = 16;                               ///< Motion samples per scan; beams in between are interpolated
+  int64_t imu_max_gap_ns = 20000000;                    ///< Longest IMU dropout bridged at the end of a scan
+  std::size_t pool_size = 4;                            ///< Pooled output scans for the subscription stage
+};
+
+/**
+ * @brief Motion-compensated scan points.
+ */
+struct DeskewedScan {
+  Header header;                     ///< Frame of the source scan, stamp = reference time
+  LaserScanGeometry geometry;        ///< Beam geometry of the source scan
+  AlignedVector<float> x;            ///< x (m) in the laser frame at the reference time, NaN for invalid beams
+  AlignedVector<float> y;            ///< y (m)
+  AlignedVector<float> z;            ///< z (m), non-zero when the body pitches or rolls during the scan
+  AlignedVector<float> intensities;  ///< Intensities of the source scan
+  bool compensated = false;          ///< false if no motion data covered the scan; points are the raw geometry
+  bool imu_rotation = false;         ///< Rotation came from IMU integration rather than odometry
+};
+
+namespace detail {
+
+// Rotation matrix (row-major) of a unit quaternion (w, x, y, z).
+inline std::array<double, 9> QuaternionToMatrix(const std::array<double, 4>& q) noexcept {
+  const double w = q[0], x = q[1], y = q[2], z = q[3];
+  return {1 - 2 * (y * y + z * z), 2 * (x * y - w * z),     2 * (x * z + w * y),
+          2 * (x * y + w * z),     1 - 2 * (x * x + z * z), 2 * (y * z - w * x),
+          2 * (x * z - w * y),     2 * (y * z + w * x),     1 - 2 * (x * x + y * y)};
+}
+
+// c = a * b for row-major 3x3 matrices.
+inline std::array<double, 9> MatMul(const std::array<double, 9>& a, const std::array<double, 9>& b) noexcept {
+  std::array<double, 9> c{};
+  for (int r = 0; r < 3; ++r) {
+    for (int col = 0; col < 3; ++col) {
+      c[r * 3 + col] = a[r * 3] * b[col] + a[r * 3 + 1] * b[3 + col] + a[r * 3 + 2] * b[6 + col];
+    }
+  }
+  return c;
+}
+
+inline std::array<double, 9> Transpose(const std::array<double, 9>& a) noexcept {
+  return {a[0], a[3], a[6], a[1], a[4], a[7], a[2], a[5], a[8]};
+}
+
+inline std::array<double, 3> MatVec(const std::array<double, 9>& a, const std::array<double, 3>& v) noexcept {
+  return {a[0] * v[0] + a[1] * v[1] + a[2] * v[2], a[3] * v[0] + a[4] * v[1] + a[5] * v[2],
+          a[6] * v[0] + a[7] * v[1] + a[8] * v[2]};
+}
+
+}  // namespace detail
+
+/**
+ * @class ScanDeskewer
+ * @brief Removes the motion smear from laser scans using buffered odometry and, optionally, IMU angular velocity.
+ *
+ * Each beam i is taken at stamp + i * time_increment (scan_time / count if time_increment is 0). The body motion
+ * between each beam time and the reference time is sampled at `knots` times per scan: translation from odometry,
+ * rotation from integrated gyro (or odometry without an IMU buffer). Per-beam transforms are interpolated between
+ * knots, so a scan costs `knots` buffer lookups plus a handful of multiply-adds per beam.
+ *
+ * Use Process() directly, or Attach() to make it a SensorController laser-scan stage with its own callback.
+ */
+class ScanDeskewer final : public NonCopyable {
+ public:
+  using DeskewedScanPtr = std::shared_ptr<DeskewedScan>;
+  using DeskewedScanCallback = std::function<void(const DeskewedScanPtr)>;
+
+  /**
+   * @param odometry Odometry history, must outlive the deskewer.
+   * @param imu Optional IMU history for rotation, must outlive the deskewer.
+   */
+  explicit ScanDeskewer(const slam::OdometryBuffer& odometry, const ImuBuffer* imu = nullptr,
+                        const ScanDeskewOptions& options = ScanDeskewOptions())
+      : options_(options), odometry_(odometry), imu_(imu), pool_(options.pool_size) {
+    if (options_.knots < 1) {
+      options_.knots = 1;
+    }
+    laser_rotation_ = detail::QuaternionToMatrix(options_.laser_orientation);
+    knot_index_.resize(options_.knots + 1);
+    knot_stamp_.resize(options_.knots + 1);
+    knot_position_.resize(options_.knots + 1);
+    knot_rotation_.resize(options_.knots + 1);
+    imu_rotation_.resize(options_.knots + 1);
+    knot_transform_.resize(options_.knots + 1);
+  }
+
+  /// Destructor, unsubscribes if still attached.
+  ~ScanDeskewer() { Detach(); }
+
+  /**
+   * @brief Subscribe to laser scans and deliver deskewed scans to a callback, on the SDK callback thread.
+   * @note Replaces any laser scan callback previously registered on the controller.
+   */
+  void Attach(SensorController& controller, const DeskewedScanCallback& callback) {
+    Detach();
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      callback_ = callback;
+    }
+    controller_ = &controller;
+    controller.SubscribeLaserScan([this](const std::shared_ptr<LaserScan> msg) {
+      if (msg) {
+        OnLaserScan(*msg);
+      }
+    });
+  }
+
+  /**
+   * @brief Unsubscribe from the attached controller.
+   */
+  void Detach() {
+    if (controller_ != nullptr) {
+      controller_->UnsubscribeLaserScan();
+      controller_ = nullptr;
+    }
+  }
+
+  /**
+   * @brief Deskew one scan. Not thread-safe: one caller at a time.
+   * @param scan Source scan.
+   * @param out Deskewed points; with missing motion data the raw points are returned and compensated is false.
+   * @return RtErrorCode::OK, or the odometry lookup error that prevented compensation.
+   */
+  RtErrorCode Process(const LaserScan& scan, DeskewedScan& out) {
+    ToCompactLaserScan(scan, compact_, options_.units);
+    ScanToCartesian(compact_, table_, points_);
+    out.header.frame_id = scan.header.frame_id;
+    out.geometry = compact_.geometry;
+    out.intensities.assign(compact_.intensities.begin(), compact_.intensities.end());
+    const std::size_t count = points_.x.size();
+    out.x.resize(count);
+    out.y.resize(count);
+    out.z.resize(count);
+    out.compensated = false;
+    out.imu_rotation = false;
+
+    double beam_dt = static_cast<double>(out.geometry.time_increment) * 1e9;
+    if (beam_dt <= 0.0 && count > 0) {
+      beam_dt = static_cast<double>(out.geometry.scan_time) * 1e9 / static_cast<double>(count);
+    }
+    const int64_t first_stamp = scan.header.stamp;
+    const int64_t last_stamp = first_stamp + static_cast<int64_t>(std::llround(beam_dt * (count > 0 ? count - 1 : 0)));
+    out.header.stamp = options_.reference == DeskewReference::FIRST_BEAM ? first_stamp : last_stamp;
+
+    const RtErrorCode code =
+        count < 2 || beam_dt <= 0.0 ? RtErrorCode::NO_DATA : ComputeKnots(count, first_stamp, beam_dt, out);
+    if (code != RtErrorCode::OK) {
+      std::copy(points_.x.begin(), points_.x.end(), out.x.begin());
+      std::copy(points_.y.begin(), points_.y.end(), out.y.begin());
+      std::fill(out.z.begin(), out.z.end(), 0.0f);
+      return code;
+    }
+    ApplyKnots(out);
+    out.compensated = true;
+    return RtErrorCode::OK;
+  }
+
+  /// Number of scans delivered with compensation by the subscription stage.
+  uint64_t GetCompensatedCount() const { return compensated_.load(std::memory_order_relaxed); }
+
+  /// Number of scans delivered without compensation (missing motion data) by the subscription stage.
+  uint64_t GetUncompensatedCount() const { return uncompensated_.load(std::memory_order_relaxed); }
+
+  /// Number of scans dropped by the subscription stage because every pooled output scan was still in use.
+  uint64_t GetDroppedCount() const { return dropped_.load(std::memory_order_relaxed); }
+
+  /// Output scan pool of the subscription stage, for statistics.
+  const FramePool<DeskewedScan>& GetPool() const { return pool_; }
+
+ private:
+  // Laser-frame transform from beam time to reference time at each knot, as rows [r00 r01 r02 t0 r10 ...].
+  using Transform = std::array<float, 12>;
+
+  void OnLaserScan(const LaserScan& scan) {
+    DeskewedScanCallback callback;
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      callback = callback_;
+    }
+    if (!callback) {
+      return;
+    }
+    auto out = pool_.Acquire();
+    if (!out) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    const bool compensated = Process(scan, *out) == RtErrorCode::OK;
+    (compensated ? compensated_ : uncompensated_).fetch_add(1, std::memory_order_relaxed);
+    callback(out);
+  }
+
+  RtErrorCode ComputeKnots(std::size_t count, int64_t first_stamp, double beam_dt, DeskewedScan& out) {
+    const std::size_t knots = options_.knots;
+    for (std::size_t k = 0; k <= knots; ++k) {
+      knot_index_[k] = k * (count - 1) / knots;
+      knot_stamp_[k] = first_stamp + static_cast<int64_t>(std::llround(beam_dt * static_cast<double>(knot_index_[k])));
+    }
+    const std::size_t ref = options_.reference == DeskewReference::FIRST_BEAM ? 0 : knots;
+
+    // Body poses at the knots.
+    slam::OdometrySample pose;
+    for (std::size_t k = 0; k <= knots; ++k) {
+      const RtErrorCode code = odometry_.Lookup(knot_stamp_[k], pose);
+      if (code != RtErrorCode::OK) {
+        return code;
+      }
+      knot_position_[k] = pose.position;
+      knot_rotation_[k] = detail::QuaternionToMatrix(pose.orientation);
+    }
+    // Gyro rotation relative to the first knot replaces the odometry rotation, in the odometry frame of knot 0.
+    if (imu_ != nullptr && imu_->IntegrateRotations(knot_stamp_.data(), knots + 1, imu_rotation_.data(),
+                                                    options_.imu_max_gap_ns) == RtErrorCode::OK) {
+      const std::array<double, 9> first = knot_rotation_[0];
+      for (std::size_t k = 0; k <= knots; ++k) {
+        knot_rotation_[k] = detail::MatMul(first, detail::QuaternionToMatrix(imu_rotation_[k]));
+      }
+      out.imu_rotation = true;
+    }
+
+    // Laser-frame transform beam time -> reference time: L^-1 * B_ref^-1 * B_k * L
+    const std::array<double, 9> ref_inv = detail::Transpose(knot_rotation_[ref]);
+    const std::array<double, 9> laser_inv = detail::Transpose(laser_rotation_);
+    for (std::size_t k = 0; k <= knots; ++k) {
+      const std::array<double, 9> body = detail::MatMul(ref_inv, knot_rotation_[k]);
+      std::array<double, 3> delta{};
+      for (int i = 0; i < 3; ++i) {
+        delta[i] = knot_position_[k][i] - knot_position_[ref][i];
+      }
+      const std::array<double, 3> body_t = detail::MatVec(ref_inv, delta);
+      // Laser point l -> body b = R_L l + t_L -> reference body R b + t -> laser R_L^T (. - t_L)
+      const std::array<double, 9> rotation = detail::MatMul(laser_inv, detail::MatMul(body, laser_rotation_));
+      const std::array<double, 3> moved = detail::MatVec(body, options_.laser_position);
+      std::array<double, 3> translation{};
+      for (int i = 0; i < 3; ++i) {
+        translation[i] = moved[i] + body_t[i] - options_.laser_position[i];
+      }
+      translation = detail::MatVec(laser_inv, translation);
+      Transform& m = knot_transform_[k];
+      for (int r = 0; r < 3; ++r) {
+        m[r * 4] = static_cast<float>(rotation[r * 3]);
+        m[r * 4 + 1] = static_cast<float>(rotation[r * 3 + 1]);
+        m[r * 4 + 2] = static_cast<float>(rotation[r * 3 + 2]);
+        m[r * 4 + 3] = static_cast<float>(translation[r]);
+      }
+    }
+    return RtErrorCode::OK;
+  }
+
+  // Interpolate knot transforms per beam and apply them to the planar laser points (z = 0).
+  void ApplyKnots(DeskewedScan& out) const {
+    const float* px = points_.x.data();
+    const float* py = points_.y.data();
+    float* ox = out.x.data();
+    float* oy = out.y.data();
+    float* oz = out.z.data();
+    const std::size_t knots = options_.knots;
+    for (std::size_t k = 0; k < knots; ++k) {
+      const std::size_t begin = knot_index_[k];
+      const std::size_t end = k + 1 == knots ? knot_index_[k + 1] + 1 : knot_index_[k + 1];
+      const Transform& a = knot_transform_[k];
+      const Transform& b = knot_transform_[k + 1];
+      const float span = static_cast<float>(knot_index_[k + 1] - begin);
+      const float inv_span = span > 0.0f ? 1.0f / span : 0.0f;
+      // Rows use columns 0, 1 and 3 only: the scan plane has z = 0. Plain loop, vectorized by the compiler.
+      for (std::size_t i = begin; i < end; ++i) {
+        const float f = static_cast<float>(i - begin) * inv_span;
+        const float x = px[i];
+        const float y = py[i];
+        ox[i] = (a[0] + f * (b[0] - a[0])) * x + (a[1] + f * (b[1] - a[1])) * y + (a[3] + f * (b[3] - a[3]));
+        oy[i] = (a[4] + f * (b[4] - a[4])) * x + (a[5] + f * (b[5] - a[5])) * y + (a[7] + f * (b[7] - a[7]));
+        oz[i] = (a[8] + f * (b[8] - a[8])) * x + (a[9] + f * (b[9] - a[9])) * y + (a[11] + f * (b[11] - a[11]));
+      }
+    }
+  }
+
+  ScanDeskewOptions options_;
+  const slam::OdometryBuffer& odometry_;         // Translation (and rotation without IMU)
+  const ImuBuffer* imu_;                         // Optional gyro rotation
+  FramePool<DeskewedScan> pool_;                 // Output scans of the subscription stage
+  SensorController* controller_ = nullptr;
+  std::mutex mutex_;                             // Guards callback_
+  DeskewedScanCallback callback_;
+  std::atomic<uint64_t> compensated_{0};
+  std::atomic<uint64_t> uncompensated_{0};
+  std::atomic<uint64_t> dropped_{0};
+  // Process() scratch, reused across scans
+  std::array<double, 9> laser_rotation_{};
+  CompactLaserScan compact_;
+  ScanTrigTable table_;
+  LaserPoints points_;
+  std::vector<std::size_t> knot_index_;
+  std::vector<int64_t> knot_stamp_;
+  std::vector<std::array<double, 3>> knot_position_;
+  std::vector<std::array<double, 9>> knot_rotation_;
+  std::vector<std::array<double, 4>> imu_rotation_;
+  std::vector<Transform> knot_transform_;
+};
+
+}  // namespace magic::dog::sensor
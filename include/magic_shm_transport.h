@@ -0,0 +1,555 @@
+#pragma once
+
+#include "magic_type.h"
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <string>
+#include <type_traits>
+
+namespace magic::dog::shm {
+
+/************************************************************
+ *                 Shared-memory topic rings                *
+ ************************************************************/
+
+constexpr uint32_t kShmRingMagic = 0x4D444753;  ///< "MDGS"
+constexpr uint32_t kShmRingVersion = 2;         ///< Layout version
+constexpr std::size_t kShmAlignment = 64;       ///< Alignment of header and slots
+
+/**
+ * @brief Options for creating a shared-memory topic.
+ */
+struct ShmTopicOptions {
+  std::string name;           ///< POSIX shm name, e.g. "/magicdog_leg_state"
+  uint32_t slot_count = 4;    ///< Number of messages kept in the ring
+  uint32_t slot_size = 4096;  ///< Maximum payload bytes per message
+  mode_t mode = 0600;         ///< Permissions of the shm object; widen (e.g. 0660) only for trusted reader groups
+};
+
+/**
+ * @brief Ring header at the start of the mapping (layout shared between processes).
+ */
+struct ShmRingHeader {
+  std::atomic<uint32_t> magic;                               ///< kShmRingMagic once initialized
+  uint32_t version;                                          ///< kShmRingVersion
+  uint32_t slot_count;                                       ///< Number of slots
+  uint32_t slot_size;                                        ///< Payload bytes per slot
+  std::atomic<uint64_t> generation;                          ///< Topic incarnation; bumped when a writer retires the ring
+  alignas(kShmAlignment) std::atomic<uint64_t> write_count;  ///< Number of committed messages
+  std::atomic<uint32_t> notify_seq;                          ///< Futex word, bumped on commits that have waiters
+  std::atomic<uint32_t> waiters;                             ///< Readers blocked in WaitForData()
+};
+
+/**
+ * @brief Slot header in front of each payload.
+ */
+struct alignas(kShmAlignment) ShmSlotHeader {
+  std::atomic<uint64_t> seq;  ///< 2 * index + 1 while writing message index, 2 * index + 2 once committed
+  uint64_t size;              ///< Payload size in bytes
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free,
+              "shared-memory rings need address-free atomics");
+
+namespace detail {
+
+inline std::size_t AlignUp(std::size_t value) { return (value + kShmAlignment - 1) / kShmAlignment * kShmAlignment; }
+
+inline std::size_t SlotStride(uint32_t slot_size) { return sizeof(ShmSlotHeader) + AlignUp(slot_size); }
+
+inline std::size_t MappingSize(uint32_t slot_count, uint32_t slot_size) {
+  return AlignUp(sizeof(ShmRingHeader)) + static_cast<std::size_t>(slot_count) * SlotStride(slot_size);
+}
+
+inline void FutexWake(std::atomic<uint32_t>* word) {
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE, INT32_MAX, nullptr, nullptr, 0);
+}
+
+inline void FutexWait(std::atomic<uint32_t>* word, uint32_t expected, int timeout_ms) {
+  timespec ts;
+  ts.tv_sec = timeout_ms / 1000;
+  ts.tv_nsec = static_cast<long>(timeout_ms % 1000) * 1000000;
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT, expected, timeout_ms >= 0 ? &ts : nullptr, nullptr, 0);
+}
+
+inline Status Errno(const std::string& what) { return {ErrorCode::INTERNAL_ERROR, what + ": " + std::strerror(errno)}; }
+
+}  // namespace detail
+
+/**
+ * @brief Common mapping handling of ShmTopicWriter and ShmTopicReader.
+ */
+class ShmTopicBase : public NonCopyable {
+ public:
+  /**
+   * @brief Unmap the topic.
+   */
+  void Close() {
+    if (base_ != nullptr) {
+      munmap(base_, size_);
+      base_ = nullptr;
+      header_ = nullptr;
+      size_ = 0;
+    }
+  }
+
+  /// Whether the topic is mapped.
+  bool IsOpen() const { return header_ != nullptr; }
+
+  /// Maximum payload bytes per message.
+  uint32_t GetSlotSize() const { return header_ != nullptr ? header_->slot_size : 0; }
+
+ protected:
+  ShmTopicBase() = default;
+  ~ShmTopicBase() { Close(); }
+
+  ShmSlotHeader* Slot(uint64_t index) const {
+    auto* first = static_cast<uint8_t*>(base_) + detail::AlignUp(sizeof(ShmRingHeader));
+    return reinterpret_cast<ShmSlotHeader*>(first + (index % header_->slot_count) * detail::SlotStride(header_->slot_size));
+  }
+
+  static uint8_t* Payload(ShmSlotHeader* slot) { return reinterpret_cast<uint8_t*>(slot) + sizeof(ShmSlotHeader); }
+
+  void* base_ = nullptr;             // Mapping start
+  std::size_t size_ = 0;             // Mapping size
+  ShmRingHeader* header_ = nullptr;  // Ring header inside the mapping
+};
+
+/**
+ * @class ShmTopicWriter
+ * @brief Single writer of a shared-memory topic ring.
+ *
+ * Messages are written in place into mmap-backed slots (BeginWrite/CommitWrite), so a producer can decode
+ * straight into shared memory and same-host readers consume without copies or socket syscalls.
+ */
+class ShmTopicWriter final : public ShmTopicBase {
+ public:
+  /**
+   * @brief Create (or re-create) the topic and map it.
+   *
+   * A ring left by a previous writer (e.g. before a restart) is never reinitialized under its readers: it is
+   * retired by bumping its generation, which fails their reads and wakes blocked ones (see
+   * ShmTopicReader::IsRetired()), then unlinked, and a fresh object is created under the same name.
+   * @param options Topic name, ring geometry and permissions.
+   * @return Operation status, INTERNAL_ERROR if the name is held by an object this process cannot replace.
+   */
+  Status Create(const ShmTopicOptions& options) {
+    Close();
+    if (options.name.empty() || options.slot_count == 0 || options.slot_size == 0) {
+      return {ErrorCode::INTERNAL_ERROR, "invalid shared-memory topic options"};
+    }
+    const uint64_t retired = RetireExisting(options.name);
+    shm_unlink(options.name.c_str());
+    const int fd = shm_open(options.name.c_str(), O_CREAT | O_EXCL | O_RDWR, options.mode);
+    if (fd < 0) {
+      return detail::Errno("shm_open " + options.name);
+    }
+    const std::size_t size = detail::MappingSize(options.slot_count, options.slot_size);
+    // fchmod: shm_open applies the process umask to the mode
+    if (fchmod(fd, options.mode) != 0 || ftruncate(fd, static_cast<off_t>(size)) != 0) {
+      auto status = detail::Errno("configure " + options.name);
+      close(fd);
+      shm_unlink(options.name.c_str());
+      return status;
+    }
+    void* base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+      auto status = detail::Errno("mmap " + options.name);
+      shm_unlink(options.name.c_str());
+      return status;
+    }
+    base_ = base;
+    size_ = size;
+    header_ = new (base) ShmRingHeader();  // Fresh object, already zero-filled
+    header_->version = kShmRingVersion;
+    header_->slot_count = options.slot_count;
+    header_->slot_size = options.slot_size;
+    header_->generation.store(retired + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    header_->magic.store(kShmRingMagic, std::memory_order_release);
+    name_ = options.name;
+    return {ErrorCode::OK, ""};
+  }
+
+  /**
+   * @brief Remove the topic name from the system. Mapped readers keep working until they close.
+   */
+  void Unlink() {
+    if (!name_.empty()) {
+      shm_unlink(name_.c_str());
+    }
+  }
+
+  /**
+   * @brief Reserve the next slot for in-place writing.
+   * @param size Payload size that will be written.
+   * @return Pointer to size writable bytes, nullptr if not open or size exceeds the slot size.
+   */
+  uint8_t* BeginWrite(std::size_t size) {
+    if (header_ == nullptr || size > header_->slot_size) {
+      return nullptr;
+    }
+    const uint64_t index = header_->write_count.load(std::memory_order_relaxed);
+    ShmSlotHeader* slot = Slot(index);
+    slot->seq.store(2 * index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot->size = size;
+    return Payload(slot);
+  }
+
+  /**
+   * @brief Commit the slot reserved by BeginWrite() and wake blocked readers, if any.
+   */
+  void CommitWrite() {
+    const uint64_t index = header_->write_count.load(std::memory_order_relaxed);
+    Slot(index)->seq.store(2 * index + 2, std::memory_order_release);
+    header_->write_count.store(index + 1, std::memory_order_release);
+    // Pairs with the fence in WaitForData(): either the reader sees the new count or this writer sees it waiting,
+    // so the futex syscall is only paid when a reader actually blocks.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (header_->waiters.load(std::memory_order_relaxed) != 0) {
+      header_->notify_seq.fetch_add(1, std::memory_order_release);
+      detail::FutexWake(&header_->notify_seq);
+    }
+  }
+
+  /**
+   * @brief Copy a message into the ring.
+   * @return Operation status.
+   */
+  Status Write(const void* data, std::size_t size) {
+    uint8_t* out = BeginWrite(size);
+    if (out == nullptr) {
+      return {ErrorCode::INTERNAL_ERROR, "shared-memory topic not open or message too large"};
+    }
+    std::memcpy(out, data, size);
+    CommitWrite();
+    return {ErrorCode::OK, ""};
+  }
+
+ private:
+  // Bump the generation of a live ring under this name and wake its readers; returns that generation (0 if none).
+  static uint64_t RetireExisting(const std::string& name) {
+    const int fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0) {
+      return 0;
+    }
+    uint64_t generation = 0;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && static_cast<std::size_t>(st.st_size) >= sizeof(ShmRingHeader)) {
+      void* base = mmap(nullptr, sizeof(ShmRingHeader), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      if (base != MAP_FAILED) {
+        auto* header = static_cast<ShmRingHeader*>(base);
+        if (header->magic.load(std::memory_order_acquire) == kShmRingMagic && header->version == kShmRingVersion) {
+          generation = header->generation.fetch_add(1, std::memory_order_acq_rel) + 1;
+          header->notify_seq.fetch_add(1, std::memory_order_release);
+          detail::FutexWake(&header->notify_seq);
+        }
+        munmap(base, sizeof(ShmRingHeader));
+      }
+    }
+    close(fd);
+    return generation;
+  }
+
+  std::string name_;  // Topic name, for Unlink()
+};
+
+/**
+ * @class ShmTopicReader
+ * @brief Reader of a shared-memory topic ring, any number per topic.
+ *
+ * Payloads are handed to the visitor in place. Because a slow reader may be lapped by the writer, every read is
+ * validated after the visitor returns: the result is false (and the visitor's output must be discarded) if the
+ * slot was overwritten meanwhile. Visitors should therefore only copy or parse the bytes, not act on them.
+ *
+ * When the writer re-creates the topic (e.g. after a restart), this mapping is retired: reads and waits return
+ * false and IsRetired() becomes true; call Open() again to follow the new ring.
+ */
+class ShmTopicReader final : public ShmTopicBase {
+ public:
+  /**
+   * @brief Map an existing topic created by a ShmTopicWriter.
+   * @param name Topic name.
+   * @return Operation status, SERVICE_NOT_READY if the writer has not created it yet.
+   */
+  Status Open(const std::string& name) {
+    Close();
+    const int fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0) {
+      return {ErrorCode::SERVICE_NOT_READY, "shm_open " + name + ": " + std::strerror(errno)};
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < sizeof(ShmRingHeader)) {
+      close(fd);
+      return {ErrorCode::SERVICE_NOT_READY, "shared-memory topic " + name + " not initialized"};
+    }
+    const auto size = static_cast<std::size_t>(st.st_size);
+    void* base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+      return detail::Errno("mmap " + name);
+    }
+    auto* header = static_cast<ShmRingHeader*>(base);
+    if (header->magic.load(std::memory_order_acquire) != kShmRingMagic || header->version != kShmRingVersion ||
+        detail::MappingSize(header->slot_count, header->slot_size) > size) {
+      munmap(base, size);
+      return {ErrorCode::SERVICE_NOT_READY, "shared-memory topic " + name + " has an incompatible layout"};
+    }
+    base_ = base;
+    size_ = size;
+    header_ = header;
+    generation_ = header_->generation.load(std::memory_order_acquire);
+    next_ = header_->write_count.load(std::memory_order_acquire);
+    return {ErrorCode::OK, ""};
+  }
+
+  /**
+   * @brief Whether the writer has re-created the topic since Open(), so this mapping no longer receives messages.
+   */
+  bool IsRetired() const {
+    return header_ != nullptr && header_->generation.load(std::memory_order_acquire) != generation_;
+  }
+
+  /**
+   * @brief Visit the most recently committed message.
+   * @param visitor Callable (const uint8_t* data, std::size_t size).
+   * @return true if a message was visited and is consistent.
+   */
+  template <typename Visitor>
+  bool ReadLatest(Visitor&& visitor) {
+    if (header_ == nullptr || IsRetired()) {
+      return false;
+    }
+    const uint64_t count = header_->write_count.load(std::memory_order_acquire);
+    if (count == 0) {
+      return false;
+    }
+    next_ = count;
+    return Visit(count - 1, visitor);
+  }
+
+  /**
+   * @brief Visit the next unread message in order, skipping messages the writer has already overwritten.
+   * @param visitor Callable (const uint8_t* data, std::size_t size).
+   * @return true if a message was visited and is consistent.
+   */
+  template <typename Visitor>
+  bool ReadNext(Visitor&& visitor) {
+    if (header_ == nullptr || IsRetired()) {
+      return false;
+    }
+    const uint64_t count = header_->write_count.load(std::memory_order_acquire);
+    while (next_ < count) {
+      if (count - next_ > header_->slot_count) {
+        dropped_ += count - next_ - header_->slot_count;
+        next_ = count - header_->slot_count;
+      }
+      const uint64_t index = next_++;
+      if (Visit(index, visitor)) {
+        return true;
+      }
+      ++dropped_;
+    }
+    return false;
+  }
+
+  /**
+   * @brief Block until a message newer than the last read one is committed.
+   * @param timeout_ms Timeout in milliseconds, negative waits forever.
+   * @return true if unread messages are available, false on timeout or once the ring is retired.
+   */
+  bool WaitForData(int timeout_ms) {
+    if (header_ == nullptr || IsRetired()) {
+      return false;
+    }
+    if (header_->write_count.load(std::memory_order_acquire) > next_) {
+      return true;
+    }
+    // Register as a waiter so the writer issues a futex wake; pairs with the fence in CommitWrite().
+    header_->waiters.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const uint32_t seen = header_->notify_seq.load(std::memory_order_acquire);
+    if (header_->write_count.load(std::memory_order_acquire) <= next_ && !IsRetired()) {
+      detail::FutexWait(&header_->notify_seq, seen, timeout_ms);
+    }
+    header_->waiters.fetch_sub(1, std::memory_order_relaxed);
+    return !IsRetired() && header_->write_count.load(std::memory_order_acquire) > next_;
+  }
+
+  /**
+   * @brief Number of messages this reader missed because the writer lapped it.
+   */
+  uint64_t GetDroppedCount() const { return dropped_; }
+
+ private:
+  template <typename Visitor>
+  bool Visit(uint64_t index, Visitor& visitor) {
+    ShmSlotHeader* slot = Slot(index);
+    const uint64_t committed = 2 * index + 2;
+    if (slot->seq.load(std::memory_order_acquire) != committed) {
+      return false;
+    }
+    const std::size_t size = std::min<std::size_t>(slot->size, header_->slot_size);
+    visitor(static_cast<const uint8_t*>(Payload(slot)), size);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot->seq.load(std::memory_order_relaxed) == committed;
+  }
+
+  uint64_t generation_ = 0;  // Ring generation at Open()
+  uint64_t next_ = 0;        // Index of the next unread message
+  uint64_t dropped_ = 0;     // Messages lapped by the writer
+};
+
+/************************************************************
+ *                     Typed topic helpers                  *
+ ************************************************************/
+
+/**
+ * @brief Write a trivially copyable message (e.g. LegState, Imu) into a topic.
+ */
+template <typename T>
+Status WriteMessage(ShmTopicWriter& writer, const T& message) {
+  static_assert(std::is_trivially_copyable_v<T>, "use a dedicated encoder for non-trivial messages");
+  return writer.Write(&message, sizeof(T));
+}
+
+/**
+ * @brief Read the latest trivially copyable message from a topic.
+ * @return true if a consistent message was copied into message.
+ */
+template <typename T>
+bool ReadLatestMessage(ShmTopicReader& reader, T& message) {
+  static_assert(std::is_trivially_copyable_v<T>, "use a dedicated decoder for non-trivial messages");
+  T copy;
+  bool sized = false;
+  const bool ok = reader.ReadLatest([&](const uint8_t* data, std::size_t size) {
+    sized = size == sizeof(T);
+    if (sized) {
+      std::memcpy(static_cast<void*>(&copy), data, sizeof(T));
+    }
+  });
+  if (ok && sized) {
+    message = copy;
+    return true;
+  }
+  return false;
+}
+
+/**
+ * @brief Read the next unread trivially copyable message from a topic, in order.
+ * @return true if a consistent message was copied into message; see ShmTopicReader::GetDroppedCount() for lapped ones.
+ */
+template <typename T>
+bool ReadNextMessage(ShmTopicReader& reader, T& message) {
+  static_assert(std::is_trivially_copyable_v<T>, "use a dedicated decoder for non-trivial messages");
+  T copy;
+  bool sized = false;
+  const bool ok = reader.ReadNext([&](const uint8_t* data, std::size_t size) {
+    sized = size == sizeof(T);
+    if (sized) {
+      std::memcpy(static_cast<void*>(&copy), data, sizeof(T));
+    }
+  });
+  if (ok && sized) {
+    message = copy;
+    return true;
+  }
+  return false;
+}
+
+/**
+ * @brief Fixed-size image header stored in front of the pixel data in an image topic.
+ */
+struct ShmImageHeader {
+  int64_t stamp;        ///< Header::stamp (ns)
+  int32_t height;       ///< Image height (pixels)
+  int32_t width;        ///< Image width (pixels)
+  int32_t step;         ///< Bytes per row
+  uint8_t is_bigendian;  ///< Image::is_bigendian
+  char encoding[19];     ///< Image::encoding, NUL terminated
+  char frame_id[64];     ///< Header::frame_id, NUL terminated
+  uint64_t data_size;    ///< Pixel bytes following this header
+};
+
+/**
+ * @brief Zero-copy view of an image stored in a topic slot, valid only inside the read visitor.
+ */
+struct ShmImageView {
+  const ShmImageHeader* header = nullptr;  ///< Image metadata
+  const uint8_t* data = nullptr;           ///< Pixel bytes (header->data_size)
+};
+
+/**
+ * @brief Slot size needed for images of the given geometry.
+ * @return Slot size, or 0 (rejected by ShmTopicWriter::Create()) if the geometry is negative or the slot would not
+ *         fit the 32-bit slot size.
+ */
+constexpr uint32_t ShmImageSlotSize(int32_t width, int32_t height, int32_t bytes_per_pixel) {
+  if (width < 0 || height < 0 || bytes_per_pixel < 0) {
+    return 0;
+  }
+  const std::size_t size = sizeof(ShmImageHeader) + static_cast<std::size_t>(width) * static_cast<std::size_t>(height) *
+                                                        static_cast<std::size_t>(bytes_per_pixel);
+  return size <= std::numeric_limits<uint32_t>::max() ? static_cast<uint32_t>(size) : 0;
+}
+
+/**
+ * @brief Write an image into an image topic.
+ */
+inline Status WriteImage(ShmTopicWriter& writer, const Image& image) {
+  uint8_t* out = writer.BeginWrite(sizeof(ShmImageHeader) + image.data.size());
+  if (out == nullptr) {
+    return {ErrorCode::INTERNAL_ERROR, "shared-memory topic not open or image too large"};
+  }
+  ShmImageHeader header{};
+  header.stamp = image.header.stamp;
+  header.height = image.height;
+  header.width = image.width;
+  header.step = image.step;
+  header.is_bigendian = image.is_bigendian ? 1 : 0;
+  image.encoding.copy(header.encoding, sizeof(header.encoding) - 1);
+  image.header.frame_id.copy(header.frame_id, sizeof(header.frame_id) - 1);
+  header.data_size = image.data.size();
+  std::memcpy(out, &header, sizeof(header));
+  std::memcpy(out + sizeof(header), image.data.data(), image.data.size());
+  writer.CommitWrite();
+  return {ErrorCode::OK, ""};
+}
+
+/**
+ * @brief Visit the next image of an image topic in place.
+ * @param visitor Callable (const ShmImageView&).
+ * @return true if an image was visited and is consistent.
+ */
+template <typename Visitor>
+bool ReadNextImage(ShmTopicReader& reader, Visitor&& visitor) {
+  return reader.ReadNext([&](const uint8_t* data, std::size_t size) {
+    if (size < sizeof(ShmImageHeader)) {
+      return;
+    }
+    ShmImageView view;
+    view.header = reinterpret_cast<const ShmImageHeader*>(data);
+    view.data = data + sizeof(ShmImageHeader);
+    if (view.header->data_size <= size - sizeof(ShmImageHeader)) {
+      visitor(view);
+    }
+  });
+}
+
+}  // namespace magic::dog::shm
@@ -0,0 +1,523 @@
+#pragma once
+
+#include "magic_laser_scan.h"
+#include "magic_realtime.h"
+#include "magic_type.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace magic::dog::sim {
+
+constexpr double kPi = 3.14159265358979323846;
+
+/**
+ * @brief Stream rates and sizes of VirtualRobot. Defaults follow the rates of the real robot.
+ */
+struct VirtualRobotOptions {
+  double leg_state_rate_hz = 500.0;  ///< LegState rate
+  double imu_rate_hz = 500.0;        ///< Imu rate
+  double odometry_rate_hz = 50.0;    ///< Odometry rate
+  double laser_scan_rate_hz = 10.0;  ///< LaserScan rate
+  double image_rate_hz = 30.0;       ///< RGBD color and depth image rate
+  double audio_rate_hz = 50.0;       ///< Voice data chunk rate
+  double nav_rate_hz = 50.0;         ///< Navigation simulation step rate, 0 disables navigation
+
+  int32_t laser_scan_points = 1440;  ///< Beams per scan (360 deg / 0.25 deg)
+  int32_t image_width = 640;         ///< Color and depth image width
+  int32_t image_height = 480;        ///< Color and depth image height
+  int32_t audio_chunk_bytes = 640;   ///< Bytes per voice data chunk (16 kHz, 16 bit, 20 ms)
+
+  int gait_transition_ms = 300;      ///< Delay before GetGait() reports a gait set by SetGait()
+  double nav_speed = 1.0;            ///< Straight-line driving speed towards the navigation target (m/s)
+};
+
+/**
+ * @class VirtualRobot
+ * @brief In-process stand-in for the robot, for load tests and benchmarks on a plain Linux box.
+ *
+ * Publishes synthetic LegState, Imu, Odometry, LaserScan, color/depth Image and voice data streams at their real
+ * rates, each from its own thread, and accepts leg commands, gait changes and navigation targets. Subscription and
+ * command functions mirror the signatures of the SDK controllers (shared_ptr callbacks, Status results), and the
+ * Make*() adapters return the sink and source functions that RealtimeLegCommandPublisher, GaitWatcher,
+ * NavStatusWatcher and NavMission accept in place of a controller. Leg joints follow the last command with a simple
+ * first-order response, gaits take effect after gait_transition_ms, and navigation drives a planar pose straight to
+ * the target at nav_speed, so closed loops and missions behave plausibly.
+ *
+ * @note This is not a network service: it does not speak the gRPC/LCM protocol of the robot and cannot be used
+ *       with MagicRobot::Initialize().
+ */
+class VirtualRobot final : public NonCopyable {
+ public:
+  using LegStateCallback = std::function<void(const std::shared_ptr<LegState>)>;
+  using ImuCallback = std::function<void(const std::shared_ptr<Imu>)>;
+  using OdometryCallback = std::function<void(const std::shared_ptr<Odometry>)>;
+  using LaserScanCallback = std::function<void(const std::shared_ptr<LaserScan>)>;
+  using ImageCallback = std::function<void(const std::shared_ptr<Image>)>;
+  using ByteMultiArrayCallback = std::function<void(const std::shared_ptr<ByteMultiArray>)>;
+
+  explicit VirtualRobot(const VirtualRobotOptions& options = VirtualRobotOptions()) : options_(options) {}
+
+  /// Destructor, stops all stream threads.
+  ~VirtualRobot() { Shutdown(); }
+
+  /**
+   * @brief Start all stream threads.
+   * @return false if already running.
+   */
+  bool Initialize() {
+    if (running_.exchange(true)) {
+      return false;
+    }
+    AddStream(options_.leg_state_rate_hz, [this](uint64_t) { PublishLegState(); });
+    AddStream(options_.imu_rate_hz, [this](uint64_t) { PublishImu(); });
+    AddStream(options_.odometry_rate_hz, [this](uint64_t) { PublishOdometry(); });
+    AddStream(options_.laser_scan_rate_hz, [this](uint64_t seq) { PublishLaserScan(seq); });
+    AddStream(options_.image_rate_hz, [this](uint64_t seq) { PublishImages(seq); });
+    AddStream(options_.audio_rate_hz, [this](uint64_t seq) { PublishVoice(seq); });
+    AddStream(options_.nav_rate_hz, [this](uint64_t) { StepNavigation(); });
+    return true;
+  }
+
+  /**
+   * @brief Stop all stream threads.
+   */
+  void Shutdown() {
+    running_ = false;
+    for (auto& thread : threads_) {
+      if (thread.joinable()) {
+        thread.join();
+      }
+    }
+    threads_.clear();
+  }
+
+  // === Subscriptions, same callback signatures as the SDK controllers ===
+
+  void SubscribeLegState(LegStateCallback callback) { Set(leg_state_cb_, std::move(callback)); }
+  void UnsubscribeLegState() { Set(leg_state_cb_, nullptr); }
+  void SubscribeImu(ImuCallback callback) { Set(imu_cb_, std::move(callback)); }
+  void UnsubscribeImu() { Set(imu_cb_, nullptr); }
+  void SubscribeOdometry(OdometryCallback callback) { Set(odometry_cb_, std::move(callback)); }
+  void UnsubscribeOdometry() { Set(odometry_cb_, nullptr); }
+  void SubscribeLaserScan(LaserScanCallback callback) { Set(laser_scan_cb_, std::move(callback)); }
+  void UnsubscribeLaserScan() { Set(laser_scan_cb_, nullptr); }
+  void SubscribeRgbdColorImage(ImageCallback callback) { Set(color_image_cb_, std::move(callback)); }
+  void UnsubscribeRgbdColorImage() { Set(color_image_cb_, nullptr); }
+  void SubscribeRgbdDepthImage(ImageCallback callback) { Set(depth_image_cb_, std::move(callback)); }
+  void UnsubscribeRgbdDepthImage() { Set(depth_image_cb_, nullptr); }
+  void SubscribeOriginVoiceData(ByteMultiArrayCallback callback) { Set(voice_cb_, std::move(callback)); }
+  void UnsubscribeOriginVoiceData() { Set(voice_cb_, nullptr); }
+
+  // === Commands ===
+
+  /**
+   * @brief Accept a leg joint command, mirrors LowLevelMotionController::PublishLegCommand.
+   */
+  Status PublishLegCommand(const LegJointCommand& command) {
+    last_command_.Store(command);
+    commands_received_.fetch_add(1, std::memory_order_relaxed);
+    return {ErrorCode::OK, ""};
+  }
+
+  /**
+   * @brief Set the gait, mirrors HighLevelMotionController::SetGait. GetGait() reports it after gait_transition_ms.
+   */
+  Status SetGait(const GaitMode gait_mode, int timeout_ms = 5000) {
+    (void)timeout_ms;
+    std::lock_guard<std::mutex> guard(state_mutex_);
+    gait_ = CurrentGait();
+    pending_gait_ = gait_mode;
+    gait_ready_ns_ = SteadyNowNs() + static_cast<int64_t>(options_.gait_transition_ms) * 1000000;
+    return {ErrorCode::OK, ""};
+  }
+
+  /**
+   * @brief Get the gait, mirrors HighLevelMotionController::GetGait.
+   */
+  Status GetGait(GaitMode& gait_mode, int timeout_ms = 5000) {
+    (void)timeout_ms;
+    gait_queries_.fetch_add(1, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> guard(state_mutex_);
+    gait_mode = CurrentGait();
+    return {ErrorCode::OK, ""};
+  }
+
+  /**
+   * @brief Start driving to a navigation target, mirrors SlamNavController::SetNavTarget.
+   */
+  Status SetNavTarget(const NavTarget& goal) {
+    if (options_.nav_rate_hz <= 0.0) {
+      return {ErrorCode::SERVICE_NOT_READY, "virtual robot navigation is disabled"};
+    }
+    std::lock_guard<std::mutex> guard(state_mutex_);
+    if (nav_status_.status == NavStatusType::END_SUCCESS && nav_arrival_ns_ > 0) {
+      nav_idle_.Record(SteadyNowNs() - nav_arrival_ns_);
+    }
+    nav_target_ = goal;
+    nav_status_ = {goal.id, NavStatusType::RUNNING, ""};
+    nav_arrival_ns_ = 0;
+    ++nav_targets_received_;
+    return {ErrorCode::OK, ""};
+  }
+
+  /**
+   * @brief Pause the navigation task, mirrors SlamNavController::PauseNavTask.
+   */
+  Status PauseNavTask() { return ChangeNavStatus(NavStatusType::RUNNING, NavStatusType::PAUSE); }
+
+  /**
+   * @brief Resume the navigation task, mirrors SlamNavController::ResumeNavTask.
+   */
+  Status ResumeNavTask() { return ChangeNavStatus(NavStatusType::PAUSE, NavStatusType::RUNNING); }
+
+  /**
+   * @brief Cancel the navigation task, mirrors SlamNavController::CancelNavTask.
+   */
+  Status CancelNavTask() {
+    std::lock_guard<std::mutex> guard(state_mutex_);
+    ++nav_cancels_received_;
+    if (nav_status_.status == NavStatusType::RUNNING || nav_status_.status == NavStatusType::PAUSE) {
+      nav_status_.status = NavStatusType::CANCEL;
+    }
+    return {ErrorCode::OK, ""};
+  }
+
+  /**
+   * @brief Get the navigation task status, mirrors SlamNavController::GetNavTaskStatus.
+   */
+  Status GetNavTaskStatus(NavStatus& status) {
+    nav_status_queries_.fetch_add(1, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> guard(state_mutex_);
+    status = nav_status_;
+    return {ErrorCode::OK, ""};
+  }
+
+  /**
+   * @brief Get the simulated map pose, mirrors SlamNavController::GetCurrentLocalizationInfo.
+   */
+  Status GetCurrentLocalizationInfo(LocalizationInfo& localization_info) {
+    std::lock_guard<std::mutex> guard(state_mutex_);
+    localization_info.is_localization = true;
+    localization_info.pose.position = {nav_pose_[0], nav_pose_[1], 0.0};
+    localization_info.pose.orientation = {0.0, 0.0, nav_pose_[2]};
+    return {ErrorCode::OK, ""};
+  }
+
+  // === Adapters for the controller-independent consumers ===
+
+  /// Leg command sink, e.g. for RealtimeLegCommandPublisher.
+  std::function<Status(const LegJointCommand&)> MakeLegCommandSink() {
+    return [this](const LegJointCommand& command) { return PublishLegCommand(command); };
+  }
+
+  /// Gait source, e.g. for GaitWatcher.
+  std::function<Status(GaitMode&)> MakeGaitSource() {
+    return [this](GaitMode& gait_mode) { return GetGait(gait_mode); };
+  }
+
+  /// Navigation status source, e.g. for NavStatusWatcher.
+  std::function<Status(NavStatus&)> MakeNavStatusSource() {
+    return [this](NavStatus& status) { return GetNavTaskStatus(status); };
+  }
+
+  /// Localization source, e.g. for NavStatusWatcher.
+  std::function<Status(LocalizationInfo&)> MakeLocalizationSource() {
+    return [this](LocalizationInfo& info) { return GetCurrentLocalizationInfo(info); };
+  }
+
+  /// Navigation target sink, e.g. for NavMission.
+  std::function<Status(const NavTarget&)> MakeNavTargetSink() {
+    return [this](const NavTarget& goal) { return SetNavTarget(goal); };
+  }
+
+  /// Navigation cancel sink, e.g. for NavMission.
+  std::function<Status()> MakeNavCancelSink() {
+    return [this] { return CancelNavTask(); };
+  }
+
+  // === Load statistics ===
+
+  /**
+   * @brief Number of leg commands received so far.
+   */
+  uint64_t GetCommandCount() const { return commands_received_.load(std::memory_order_relaxed); }
+
+  /// Number of GetGait() calls, i.e. gait RPCs a real robot would have served.
+  uint64_t GetGaitQueryCount() const { return gait_queries_.load(std::memory_order_relaxed); }
+
+  /// Number of GetNavTaskStatus() calls.
+  uint64_t GetNavStatusQueryCount() const { return nav_status_queries_.load(std::memory_order_relaxed); }
+
+  /// Number of SetNavTarget() calls.
+  uint64_t GetNavTargetCount() const {
+    std::lock_guard<std::mutex> guard(state_mutex_);
+    return nav_targets_received_;
+  }
+
+  /// Number of CancelNavTask() calls.
+  uint64_t GetNavCancelCount() const {
+    std::lock_guard<std::mutex> guard(state_mutex_);
+    return nav_cancels_received_;
+  }
+
+  /**
+   * @brief Time the robot stood at a reached target before the next SetNavTarget() (ns).
+   */
+  const LatencyHistogram& GetNavIdleTime() const { return nav_idle_; }
+
+ private:
+  template <typename Callback>
+  using CallbackSlot = std::shared_ptr<const Callback>;
+
+  template <typename Callback>
+  void Set(CallbackSlot<Callback>& target, std::type_identity_t<Callback> callback) {
+    auto slot = callback ? std::make_shared<const Callback>(std::move(callback)) : nullptr;
+    std::lock_guard<std::mutex> guard(callback_mutex_);
+    target = std::move(slot);
+  }
+
+  // Snapshot of the current callback, empty if unsubscribed. Callbacks are never invoked under the lock.
+  template <typename Callback>
+  CallbackSlot<Callback> Get(const CallbackSlot<Callback>& source) {
+    std::lock_guard<std::mutex> guard(callback_mutex_);
+    return source;
+  }
+
+  // Gait reported by GetGait(), caller holds state_mutex_.
+  GaitMode CurrentGait() const {
+    return SteadyNowNs() >= gait_ready_ns_ ? pending_gait_ : gait_;
+  }
+
+  Status ChangeNavStatus(NavStatusType from, NavStatusType to) {
+    std::lock_guard<std::mutex> guard(state_mutex_);
+    if (nav_status_.status != from) {
+      return {ErrorCode::SERVICE_ERROR, "no navigation task to change"};
+    }
+    nav_status_.status = to;
+    return {ErrorCode::OK, ""};
+  }
+
+  void StepNavigation() {
+    std::lock_guard<std::mutex> guard(state_mutex_);
+    if (nav_status_.status != NavStatusType::RUNNING) {
+      return;
+    }
+    const auto& goal = nav_target_.goal;
+    const double dx = goal.position[0] - nav_pose_[0];
+    const double dy = goal.position[1] - nav_pose_[1];
+    const double distance = std::hypot(dx, dy);
+    const double step = options_.nav_speed / options_.nav_rate_hz;
+    if (distance <= step) {
+      nav_pose_ = {goal.position[0], goal.position[1], goal.orientation[2]};
+      nav_status_.status = NavStatusType::END_SUCCESS;
+      nav_arrival_ns_ = SteadyNowNs();
+      return;
+    }
+    nav_pose_[0] += dx / distance * step;
+    nav_pose_[1] += dy / distance * step;
+    nav_pose_[2] = std::atan2(dy, dx);
+  }
+
+  static int64_t SystemNowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+  }
+
+  void AddStream(double rate_hz, std::function<void(uint64_t)> produce) {
+    if (rate_hz <= 0.0) {
+      return;
+    }
+    const auto period = std::chrono::nanoseconds(static_cast<int64_t>(1e9 / rate_hz));
+    threads_.emplace_back([this, period, produce = std::move(produce)]() {
+      auto next = std::chrono::steady_clock::now();
+      for (uint64_t seq = 0; running_.load(std::memory_order_acquire); ++seq) {
+        produce(seq);
+        next += period;
+        std::this_thread::sleep_until(next);
+      }
+    });
+  }
+
+  void PublishLegState() {
+    // First-order response of every joint towards the commanded position.
+    LegJointCommand command;
+    uint64_t version = 0;
+    const bool has_command = last_command_.Load(command, version) == RtErrorCode::OK;
+    const double dt = 1.0 / options_.leg_state_rate_hz;
+    auto state = std::make_shared<LegState>();
+    state->timestamp = SystemNowNs();
+    for (std::size_t i = 0; i < kLegJointNum; ++i) {
+      auto& joint = joints_[i];
+      double tau = 0.0;
+      if (has_command) {
+        const auto& cmd = command.cmd[i];
+        tau = cmd.kp * (cmd.q_des - joint.q) + cmd.kd * (cmd.dq_des - joint.dq) + cmd.tau_des;
+      }
+      joint.dq = (joint.dq + tau * dt) * 0.9;
+      joint.q += joint.dq * dt;
+      joint.tau_est = tau;
+      state->state[i] = joint;
+    }
+    if (auto callback = Get(leg_state_cb_)) {
+      (*callback)(state);
+    }
+  }
+
+  void PublishImu() {
+    auto imu = std::make_shared<Imu>();
+    imu->timestamp = SystemNowNs();
+    imu->orientation = {1.0, 0.0, 0.0, 0.0};
+    imu->angular_velocity = {0.0, 0.0, 0.1};
+    imu->linear_acceleration = {0.0, 0.0, 9.81};
+    imu->temperature = 40.0;
+    if (auto callback = Get(imu_cb_)) {
+      (*callback)(imu);
+    }
+  }
+
+  void PublishOdometry() {
+    // Slow circle of 1 m radius.
+    const double t = static_cast<double>(SystemNowNs()) * 1e-9;
+    const double yaw = 0.1 * t;
+    auto odometry = std::make_shared<Odometry>();
+    odometry->header.stamp = SystemNowNs();
+    odometry->header.frame_id = "odom";
+    odometry->child_frame_id = "base_link";
+    odometry->position = {std::cos(yaw), std::sin(yaw), 0.0};
+    odometry->orientation = {std::cos(0.5 * (yaw + 0.5 * kPi)), 0.0, 0.0, std::sin(0.5 * (yaw + 0.5 * kPi))};
+    odometry->linear_velocity = {0.1, 0.0, 0.0};
+    odometry->angular_velocity = {0.0, 0.0, 0.1};
+    if (auto callback = Get(odometry_cb_)) {
+      (*callback)(odometry);
+    }
+  }
+
+  void PublishLaserScan(uint64_t seq) {
+    auto callback = Get(laser_scan_cb_);
+    if (!callback) {
+      return;
+    }
+    // Geometry in the default LaserScanUnits: beam i at 2 pi i / points, one turn per scan period, stamped at the
+    // first beam.
+    const sensor::LaserScanUnits units;
+    const auto points = static_cast<std::size_t>(options_.laser_scan_points);
+    const double increment = 2.0 * kPi / static_cast<double>(points);
+    const double scan_time = 1.0 / options_.laser_scan_rate_hz;
+    auto scan = std::make_shared<LaserScan>();
+    scan->header.frame_id = "laser";
+    scan->angle_min = 0;
+    scan->angle_max = static_cast<int32_t>(std::lround((2.0 * kPi - increment) / units.angle));
+    scan->angle_increment = static_cast<int32_t>(std::lround(increment / units.angle));
+    scan->time_increment = static_cast<int32_t>(std::lround(scan_time / static_cast<double>(points) / units.time));
+    scan->scan_time = static_cast<int32_t>(std::lround(scan_time / units.time));
+    scan->range_min = static_cast<int32_t>(std::lround(0.05 / units.range));
+    scan->range_max = static_cast<int32_t>(std::lround(30.0 / units.range));
+    scan->header.stamp = SystemNowNs() - std::llround(scan_time * 1e9);
+    scan->ranges.resize(points);
+    scan->intensities.resize(points);
+    for (std::size_t i = 0; i < points; ++i) {
+      // Square room of 4 m with a little motion between scans.
+      const double angle = 2.0 * kPi * static_cast<double>(i) / static_cast<double>(points);
+      const double c = std::max(std::abs(std::cos(angle)), std::abs(std::sin(angle)));
+      scan->ranges[i] = 2.0 / c + 0.01 * static_cast<double>(seq % 10);
+      scan->intensities[i] = 100.0;
+    }
+    (*callback)(scan);
+  }
+
+  void PublishImages(uint64_t seq) {
+    const int64_t stamp = SystemNowNs();
+    const auto width = options_.image_width;
+    const auto height = options_.image_height;
+    if (auto callback = Get(color_image_cb_)) {
+      auto image = std::make_shared<Image>();
+      image->header.stamp = stamp;
+      image->header.frame_id = "camera_color_optical_frame";
+      image->height = height;
+      image->width = width;
+      image->encoding = "rgb8";
+      image->is_bigendian = false;
+      image->step = width * 3;
+      image->data.resize(static_cast<std::size_t>(image->step) * static_cast<std::size_t>(height));
+      for (std::size_t i = 0; i < image->data.size(); ++i) {
+        image->data[i] = static_cast<uint8_t>(i + seq);
+      }
+      (*callback)(image);
+    }
+    if (auto callback = Get(depth_image_cb_)) {
+      auto image = std::make_shared<Image>();
+      image->header.stamp = stamp;
+      image->header.frame_id = "camera_depth_optical_frame";
+      image->height = height;
+      image->width = width;
+      image->encoding = "16UC1";
+      image->is_bigendian = false;
+      image->step = width * 2;
+      image->data.resize(static_cast<std::size_t>(image->step) * static_cast<std::size_t>(height));
+      auto* depth = reinterpret_cast<uint16_t*>(image->data.data());
+      for (int32_t v = 0; v < height; ++v) {
+        for (int32_t u = 0; u < width; ++u) {
+          depth[v * width + u] = static_cast<uint16_t>(1000 + v);  // Tilted floor, millimeters
+        }
+      }
+      (*callback)(image);
+    }
+  }
+
+  void PublishVoice(uint64_t seq) {
+    auto callback = Get(voice_cb_);
+    if (!callback) {
+      return;
+    }
+    auto voice = std::make_shared<ByteMultiArray>();
+    voice->layout.dim_size = 0;
+    voice->layout.data_offset = 0;
+    voice->data.resize(static_cast<std::size_t>(options_.audio_chunk_bytes));
+    for (std::size_t i = 0; i < voice->data.size(); ++i) {
+      voice->data[i] = static_cast<uint8_t>((i + seq) & 0xFF);
+    }
+    (*callback)(voice);
+  }
+
+  VirtualRobotOptions options_;                          // Stream configuration
+  std::atomic_bool running_{false};                      // Whether streams are running
+  std::vector<std::thread> threads_;                     // One thread per stream
+  std::mutex callback_mutex_;                            // Guards the callbacks below
+  CallbackSlot<LegStateCallback> leg_state_cb_;
+  CallbackSlot<ImuCallback> imu_cb_;
+  CallbackSlot<OdometryCallback> odometry_cb_;
+  CallbackSlot<LaserScanCallback> laser_scan_cb_;
+  CallbackSlot<ImageCallback> color_image_cb_;
+  CallbackSlot<ImageCallback> depth_image_cb_;
+  CallbackSlot<ByteMultiArrayCallback> voice_cb_;
+  SeqLock<LegJointCommand> last_command_;               // Latest leg command
+  std::atomic<uint64_t> commands_received_{0};           // Number of leg commands
+  std::atomic<uint64_t> gait_queries_{0};                // Number of GetGait() calls
+  std::atomic<uint64_t> nav_status_queries_{0};          // Number of GetNavTaskStatus() calls
+  mutable std::mutex state_mutex_;                       // Guards gait and navigation state below
+  GaitMode gait_ = GaitMode::GAIT_PASSIVE;               // Gait before the last SetGait() took effect
+  GaitMode pending_gait_ = GaitMode::GAIT_PASSIVE;       // Gait of the last SetGait()
+  int64_t gait_ready_ns_ = 0;                            // When pending_gait_ takes effect
+  NavTarget nav_target_;                                 // Current navigation target
+  NavStatus nav_status_{-1, NavStatusType::NONE, ""};    // Current navigation status
+  std::array<double, 3> nav_pose_{};                     // Map pose (x, y, yaw)
+  int64_t nav_arrival_ns_ = 0;                           // When the current target was reached
+  uint64_t nav_targets_received_ = 0;                    // Number of SetNavTarget() calls
+  uint64_t nav_cancels_received_ = 0;                    // Number of CancelNavTask() calls
+  LatencyHistogram nav_idle_;                            // Idle time at reached targets (ns)
+  std::array<SingleLegJointState, kLegJointNum> joints_{};  // Simulated joints, leg state thread only
+};
+
+}  // namespace magic::dog::sim